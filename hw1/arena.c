@@ -0,0 +1,178 @@
+#define _GNU_SOURCE
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+// block 開頭的 header：payload 在 ARENA_HDR 之後
+typedef struct {
+    uint32_t cls;  // block 大小是 2^(cls + ARENA_MIN_SHIFT)
+    uint32_t pad;
+    uint64_t next; // 在 free list 上時：下一個 block 的 offset + 1
+} arena_hdr_t;
+
+static arena_hdr_t *arena_hdr(arena_t *arena, uint64_t block)
+{
+    return (arena_hdr_t *)(arena->data + block);
+}
+
+static uint64_t class_bytes(int cls)
+{
+    return (uint64_t)1 << (cls + ARENA_MIN_SHIFT);
+}
+
+// 放得下 len byte payload (加上 header) 的最小 class；太大回傳 -1
+static int class_of(size_t len)
+{
+    for (int cls = 0; cls < ARENA_CLASSES; cls++)
+        if (len + ARENA_HDR <= class_bytes(cls))
+            return cls;
+    return -1;
+}
+
+arena_t *arena_create(key_t key, size_t size, place_t *place)
+{
+    if (size == 0)
+        size = ARENA_BYTES;
+    size = (size + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1);
+    int fresh;
+    arena_t *arena = shm_join(key, sizeof(arena_t) + size, ARENA_MAGIC, place, &fresh);
+    //pop 只能有一個人做 (見 arena.h)
+    if (!fresh)
+    {
+        fprintf(stderr, "Another sender is already using this arena\n");
+        exit(1);
+    }
+    arena->size = size;
+    arena->top = 0;
+    atomic_store_explicit(&arena->live, 0, memory_order_relaxed);
+    fevent_init(&arena->free_ev);
+    for (int i = 0; i < ARENA_CLASSES; i++)
+        atomic_store_explicit(&arena->list[i].head, 0, memory_order_relaxed);
+    atomic_store_explicit(&arena->magic, ARENA_MAGIC, memory_order_release);
+    return arena;
+}
+
+arena_t *arena_attach(key_t key)
+{
+    return shm_wait(key, ARENA_MAGIC);
+}
+
+void arena_detach(arena_t *arena)
+{
+    shmdt(arena);
+}
+
+void arena_destroy(key_t key)
+{
+    int shmid = shmget(key, 0, 0666);
+    if (shmid != -1)
+        shmctl(shmid, IPC_RMID, NULL);
+}
+
+// 只有 sender 會呼叫：push 的人再多，head 換掉之前讀到的 next 都還是對的 (block 不會被別人 pop 走)
+static uint64_t list_pop(arena_t *arena, int cls)
+{
+    _Atomic uint64_t *head = &arena->list[cls].head;
+    uint64_t h = atomic_load_explicit(head, memory_order_acquire);
+    while (h != 0 && !atomic_compare_exchange_weak_explicit(head, &h, arena_hdr(arena, h - 1)->next,
+                                                            memory_order_acquire, memory_order_acquire))
+        ;
+    return h == 0 ? ARENA_NONE : h - 1;
+}
+
+static void list_push(arena_t *arena, int cls, uint64_t block)
+{
+    _Atomic uint64_t *head = &arena->list[cls].head;
+    arena_hdr_t *hdr = arena_hdr(arena, block);
+    uint64_t h = atomic_load_explicit(head, memory_order_relaxed);
+    do
+        hdr->next = h;
+    while (!atomic_compare_exchange_weak_explicit(head, &h, block + 1, memory_order_release, memory_order_relaxed));
+}
+
+// 從還沒切過的部分切一塊 class cls 的 block；block 從 0 開始依照大小對齊，切之前先把對齊的空隙還到 free list
+static uint64_t carve(arena_t *arena, int cls)
+{
+    uint64_t bytes = class_bytes(cls);
+    uint64_t top = arena->top;
+    while (top & (bytes - 1))
+    {
+        //top 目前對齊到的最大 class 那一塊拿去當 free block，直到對齊 bytes
+        int gap = __builtin_ctzll(top) - ARENA_MIN_SHIFT;
+        if (top + class_bytes(gap) > arena->size)
+            return ARENA_NONE;
+        arena_hdr(arena, top)->cls = (uint32_t)gap;
+        list_push(arena, gap, top);
+        top += class_bytes(gap);
+        arena->top = top;
+    }
+    if (top + bytes > arena->size)
+        return ARENA_NONE;
+    arena->top = top + bytes;
+    arena_hdr(arena, top)->cls = (uint32_t)cls;
+    return top;
+}
+
+// 一個 block 都沒有配出去：free list 整個丟掉，從頭開始切 (碎片也跟著清掉)
+static void arena_reset(arena_t *arena)
+{
+    for (int i = 0; i < ARENA_CLASSES; i++)
+        atomic_store_explicit(&arena->list[i].head, 0, memory_order_relaxed);
+    arena->top = 0;
+}
+
+typedef struct {
+    arena_t *arena;
+    int cls;
+} arena_wait_t;
+
+// sender 等待的條件：class >= cls 的 free list 有東西，或是全部都還回來了
+static int arena_can_alloc(void *arg)
+{
+    arena_wait_t *w = arg;
+    if (atomic_load_explicit(&w->arena->live, memory_order_acquire) == 0)
+        return 1;
+    for (int i = w->cls; i < ARENA_CLASSES; i++)
+        if (atomic_load_explicit(&w->arena->list[i].head, memory_order_acquire) != 0)
+            return 1;
+    return 0;
+}
+
+uint64_t arena_alloc(arena_t *arena, size_t len, spin_t *spin)
+{
+    int cls = class_of(len);
+    if (cls == -1 || class_bytes(cls) > arena->size)
+        return ARENA_NONE;
+    for (;;)
+    {
+        uint64_t block = list_pop(arena, cls);
+        if (block == ARENA_NONE)
+            block = carve(arena, cls);
+        //更大的 block 也可以用 (還回來時回到自己的 class)
+        for (int i = cls + 1; block == ARENA_NONE && i < ARENA_CLASSES; i++)
+            block = list_pop(arena, i);
+        if (block != ARENA_NONE)
+        {
+            atomic_fetch_add_explicit(&arena->live, 1, memory_order_relaxed);
+            return block + ARENA_HDR;
+        }
+        if (atomic_load_explicit(&arena->live, memory_order_acquire) == 0)
+        {
+            arena_reset(arena);
+            continue;
+        }
+        arena_wait_t w = {arena, cls};
+        fevent_await(&arena->free_ev, spin, arena_can_alloc, &w);
+    }
+}
+
+void arena_free(arena_t *arena, uint64_t off)
+{
+    uint64_t block = off - ARENA_HDR;
+    list_push(arena, (int)arena_hdr(arena, block)->cls, block);
+    atomic_fetch_sub_explicit(&arena->live, 1, memory_order_release);
+    fevent_notify(&arena->free_ev);
+}
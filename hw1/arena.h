@@ -0,0 +1,61 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "ring.h"
+
+/*
+    arena：一大塊 shared memory，sender 直接在裡面配置「剛好放得下這則訊息」的 block，
+    把內容寫在 block 裡，mailbox 只送 block 的 offset (FRAME_ARENA，見 mailbox_send_alloc())
+    receiver 用 offset 直接讀，處理完再把 block 還給 arena (mailbox_release())，內容完全不經過 mailbox 的 buffer
+
+    slab 式的配置：block 大小是 2 的次方 (64 B 起跳，含 16 byte header)，每種大小一條 free list
+        配置：先拿同大小的 free list；沒有就從 top 切一塊新的；top 也用完了就拿更大的 free list
+        還是沒有就等 receiver 還 block (free_ev)；所有 block 都還回來了 (live == 0) 就整個重來 (top = 0)，不會卡在碎片上
+    free list 是 Treiber stack (offset 串起來，CAS 換 head)：
+        只有一個 sender 會 pop，push (receiver free) 可以很多個同時做；只有一個 pop 的一方不會有 ABA 問題
+    sender 建立 (同時只能有一個 sender)，receiver 收到第一個 FRAME_ARENA 才掛載，最後離開的 receiver 移除區段
+*/
+#define ARENA_MAGIC 0x4152454eu // "AREN"
+#define ARENA_PROJ_ID 70        // ftok() 的編號，和 BCAST_PROJ_ID 69 分開
+#define ARENA_BYTES (64u << 20) // 預設 data 區大小
+#define ARENA_MIN_SHIFT 6       // 最小的 block 64 B
+#define ARENA_CLASSES 32        // block 大小 2^6 .. 2^37
+#define ARENA_HDR 16            // block 開頭的 header，payload 從這裡之後開始 (16 byte 對齊)
+#define ARENA_NONE UINT64_MAX
+
+typedef struct arena arena_t;
+
+struct arena {
+    _Alignas(CACHE_LINE) _Atomic uint32_t magic;
+    uint64_t size;                               // data 區大小
+    uint64_t top;                                // 還沒切過的部分從這裡開始，只有 sender 會動
+    _Alignas(CACHE_LINE) _Atomic uint64_t live;  // 配出去還沒還回來的 block 數
+    _Alignas(CACHE_LINE) fevent_t free_ev;       // sender 等「有 block 還回來」
+    struct {
+        _Alignas(CACHE_LINE) _Atomic uint64_t head; // free list 第一個 block 的 offset + 1，0 = 空的
+    } list[ARENA_CLASSES];
+    _Alignas(CACHE_LINE) char data[];
+};
+
+// sender: 建立 data 區 size byte 的 arena (0 = ARENA_BYTES)；place: huge page / NUMA node
+arena_t *arena_create(key_t key, size_t size, place_t *place);
+// receiver: 掛載 sender 建好的 arena
+arena_t *arena_attach(key_t key);
+void arena_detach(arena_t *arena);
+void arena_destroy(key_t key);
+
+// 配置 len byte，回傳 payload 的 offset；arena 暫時滿了會等 receiver 還 block，len 比整個 arena 還大回傳 ARENA_NONE
+uint64_t arena_alloc(arena_t *arena, size_t len, spin_t *spin);
+// 把 arena_alloc() 回傳的 block 還回去 (任何一個掛載的 process 都可以)
+void arena_free(arena_t *arena, uint64_t off);
+
+static inline char *arena_ptr(arena_t *arena, uint64_t off)
+{
+    return arena->data + off;
+}
+
+#endif
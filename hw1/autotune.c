@@ -0,0 +1,369 @@
+#define _POSIX_C_SOURCE 200809L
+#include "autotune.h"
+#include "transport.h"
+#include "stats.h"
+
+#define BLUE "\033[1;34m"
+#define RESET "\033[0m"
+
+#define AUTO_RECV_BATCH 64
+
+int auto_parse(const char *arg, unsigned *candidates)
+{
+    if (strncmp(arg, "auto", 4) != 0 || (arg[4] != '\0' && arg[4] != ':'))
+        return -1;
+    unsigned set = 0;
+    if (arg[4] == ':')
+    {
+        //逗號分開的 mode 編號，不合法的直接拒絕
+        const char *p = arg + 5;
+        while (*p)
+        {
+            char *end;
+            long m = strtol(p, &end, 10);
+            if (end == p || mailbox_mode_name((int)m) == NULL || (*end != ',' && *end != '\0'))
+                return -1;
+            set |= 1u << m;
+            p = *end ? end + 1 : end;
+        }
+        if (set == 0)
+            return -1;
+    }
+    if (candidates)
+        *candidates = set;
+    return 0;
+}
+
+void auto_init(autotune_t *at, const mailbox_t *config, int role, unsigned candidates, const char *key_path)
+{
+    memset(at, 0, sizeof(*at));
+    at->config = *config;
+    at->role = role;
+    at->key_path = key_path;
+    for (int m = 1; m < MAILBOX_MODES; m++)
+        if (mailbox_mode_name(m) && (candidates == 0 || (candidates & (1u << m))))
+            at->candidates |= 1u << m;
+    //ring 沒有東西可以壓 (見 sender.c 的 -L)
+    if (config->compress_min)
+        at->candidates &= ~(1u << SHM_RING);
+
+    mailbox_t tmp = *config;
+    tmp.key_path = key_path;
+    tmp.lane = 0;
+    at->ctl_key = mailbox_key(&tmp, AUTO_PROJ_ID);
+    if (role == MAILBOX_SENDER)
+    {
+        int fresh;
+        at->ctl = shm_join(at->ctl_key, sizeof(auto_ctl_t), AUTO_MAGIC, NULL, &fresh);
+        if (fresh)
+        {
+            atomic_store(&at->ctl->seq, 0);
+            atomic_store(&at->ctl->acked, 0);
+            atomic_store(&at->ctl->ready, 0);
+            fevent_init(&at->ctl->posted);
+            fevent_init(&at->ctl->done);
+            atomic_store_explicit(&at->ctl->magic, AUTO_MAGIC, memory_order_release);
+        }
+        at->seq = atomic_load(&at->ctl->seq);
+    }
+    else
+    {
+        at->ctl = shm_wait(at->ctl_key, AUTO_MAGIC);
+        at->seq = atomic_load(&at->ctl->acked);
+        atomic_store_explicit(&at->ctl->ready, 1, memory_order_release);
+        fevent_notify(&at->ctl->done);
+    }
+}
+
+void auto_close(autotune_t *at)
+{
+    shmdt(at->ctl);
+    if (at->role == MAILBOX_RECEIVER)
+    {
+        int shmid = shmget(at->ctl_key, 0, 0666);
+        if (shmid != -1)
+            shmctl(shmid, IPC_RMID, NULL);
+    }
+    free(at->sample);
+    at->sample = NULL;
+    at->ctl = NULL;
+}
+
+/* ============================ 控制區段的交握 ============================ */
+
+static int acked(void *arg)
+{
+    autotune_t *at = arg;
+    return atomic_load_explicit(&at->ctl->acked, memory_order_acquire) == at->seq;
+}
+
+static int ready(void *arg)
+{
+    autotune_t *at = arg;
+    return atomic_load_explicit(&at->ctl->ready, memory_order_acquire);
+}
+
+static int posted(void *arg)
+{
+    autotune_t *at = arg;
+    return atomic_load_explicit(&at->ctl->seq, memory_order_acquire) != at->seq;
+}
+
+//sender：等上一個 step 做完再貼下一個
+static void post(autotune_t *at, uint32_t step, int mode)
+{
+    fevent_await(&at->ctl->done, &at->config.spin, acked, at);
+    at->ctl->step = step;
+    at->ctl->mode = mode;
+    at->seq++;
+    atomic_store_explicit(&at->ctl->seq, at->seq, memory_order_release);
+    fevent_notify(&at->ctl->posted);
+}
+
+static void ack(autotune_t *at)
+{
+    atomic_store_explicit(&at->ctl->acked, at->seq, memory_order_release);
+    fevent_notify(&at->ctl->done);
+}
+
+//probe 的 mailbox：設定和正式的一樣，只是換一條 lane、不計數
+static void probe_box(autotune_t *at, mailbox_t *box, int mode, int role)
+{
+    *box = at->config;
+    box->lane = AUTO_LANE;
+    box->telemetry = 0;
+    mailbox_open(box, mode, role, at->key_path);
+}
+
+//和 sender.c 結束時一樣：每個 receiver 一個 exit，各自一個 transfer
+static void send_exit(mailbox_t *mailbox_ptr)
+{
+    mailbox_flush(mailbox_ptr);
+    long keys[PEERS_MAX];
+    int n = mailbox_finish(mailbox_ptr, keys, PEERS_MAX);
+    message_t msg = {0};
+    msg.msgText = "exit";
+    msg.msgLen = 4;
+    for (int i = 0; i < n; i++)
+    {
+        msg.mType = keys[i];
+        mailbox_send(mailbox_ptr, &msg);
+        mailbox_flush(mailbox_ptr);
+    }
+}
+
+//正式的 mailbox 換掉之前：total_time 留下來，最後印總和
+static void close_run(autotune_t *at, mailbox_t *mailbox_ptr)
+{
+    at->run_time += mailbox_ptr->total_time;
+    mailbox_close(mailbox_ptr);
+    at->mode = 0;
+}
+
+/* ================================ sender ================================ */
+
+static void sample_reset(autotune_t *at)
+{
+    if (at->sample == NULL && (at->sample = malloc(AUTO_SAMPLE_BYTES)) == NULL)
+    {
+        perror("malloc failed");
+        exit(1);
+    }
+    at->samples = 0;
+    at->sample_off[0] = 0;
+}
+
+//樣本滿了回傳 -1；放不下的一行只有第一行會截斷放進去
+static int sample_add(autotune_t *at, const char *data, size_t len)
+{
+    size_t off = at->sample_off[at->samples];
+    if (at->samples == AUTO_SAMPLE || (at->samples > 0 && off + len > AUTO_SAMPLE_BYTES))
+        return -1;
+    if (len > AUTO_SAMPLE_BYTES - off)
+        len = AUTO_SAMPLE_BYTES - off;
+    memcpy(at->sample + off, data, len);
+    at->sample_off[++at->samples] = off + len;
+    return 0;
+}
+
+//input 檔開頭的幾行，切法和 readahead 一樣 ('\n' 不算在內)；讀不到就用一則空的
+static void sample_file(autotune_t *at, const char *path)
+{
+    sample_reset(at);
+    FILE *fp = fopen(path, "r");
+    if (fp)
+    {
+        char *line = NULL;
+        size_t cap = 0;
+        ssize_t n;
+        while ((n = getline(&line, &cap, fp)) != -1)
+        {
+            if (n > 0 && line[n - 1] == '\n')
+                n--;
+            if (sample_add(at, line, (size_t)n) == -1)
+                break;
+        }
+        free(line);
+        fclose(fp);
+    }
+    if (at->samples == 0)
+        sample_add(at, "", 0);
+}
+
+/*
+    量一個 mode：貼 PROBE，送 count 則樣本和 exit，等 receiver 收完關掉 ack
+    run 不是 NULL 時 (重新量的第一個 mode)：貼了 PROBE 之後才在正式的 mailbox 送 exit 並關掉，
+    receiver 收到那個 exit 時一定看得到新的 seq
+*/
+static double probe(autotune_t *at, int mode, int count, mailbox_t *run)
+{
+    post(at, AUTO_PROBE, mode);
+    if (run)
+    {
+        send_exit(run);
+        close_run(at, run);
+    }
+    mailbox_t box;
+    probe_box(at, &box, mode, MAILBOX_SENDER);
+    message_t msg = {0};
+    msg.mType = at->config.route;
+    uint64_t start = stats_now();
+    for (int i = 0; i < count; i++)
+    {
+        int s = i % at->samples;
+        msg.msgText = at->sample + at->sample_off[s];
+        msg.msgLen = at->sample_off[s + 1] - at->sample_off[s];
+        mailbox_send(&box, &msg);
+    }
+    send_exit(&box);
+    mailbox_close(&box);
+    fevent_await(&at->ctl->done, &at->config.spin, acked, at);
+    double secs = (stats_now() - start) / 1e9;
+    return secs > 0 ? count / secs : 0;
+}
+
+//每個候選的 mode 量一次，回傳要用的 mode；run 是目前正式的 mailbox (第一次量的時候是 NULL)
+static int calibrate(autotune_t *at, mailbox_t *run)
+{
+    at->size = (double)at->sample_off[at->samples] / at->samples;
+    double count = AUTO_PROBE_BYTES / (at->size + FRAME_HDR_SIZE);
+    count = count < AUTO_PROBE_MIN ? AUTO_PROBE_MIN : count > AUTO_PROBE_MAX ? AUTO_PROBE_MAX : count;
+    printf(BLUE "Auto: calibrating %d-line sample (avg %.0f bytes), %d messages per mode\n" RESET, at->samples,
+           at->size, (int)count);
+
+    int best = 0, current = at->mode;
+    for (int m = 1; m < MAILBOX_MODES; m++)
+    {
+        if (!(at->candidates & (1u << m)))
+            continue;
+        at->rate[m] = probe(at, m, (int)count, at->mode ? run : NULL);
+        printf("  %d %-28s %12.0f msgs/s\n", m, mailbox_mode_name(m), at->rate[m]);
+        if (best == 0 || at->rate[m] > at->rate[best])
+            best = m;
+    }
+    //目前的 mode 沒有差太多就不換
+    if (current && (at->candidates & (1u << current)) && at->rate[best] < at->rate[current] * AUTO_MARGIN)
+        best = current;
+    at->calibrated_at = stats_now();
+    at->window_msgs = at->window_bytes = 0;
+    return best;
+}
+
+static void start_run(autotune_t *at, mailbox_t *mailbox_ptr, int mode)
+{
+    post(at, AUTO_RUN, mode);
+    *mailbox_ptr = at->config;
+    mailbox_open(mailbox_ptr, mode, MAILBOX_SENDER, at->key_path);
+    at->mode = mode;
+    printf(BLUE "Auto: using %s\n" RESET, mailbox_mode_name(mode));
+}
+
+void auto_start(autotune_t *at, mailbox_t *mailbox_ptr, const char *path)
+{
+    if (at->candidates == 0)
+    {
+        fprintf(stderr, "No mode to calibrate\n");
+        exit(1);
+    }
+    sample_file(at, path);
+    fevent_await(&at->ctl->done, &at->config.spin, ready, at);
+    start_run(at, mailbox_ptr, calibrate(at, NULL));
+}
+
+void auto_check(autotune_t *at, mailbox_t *mailbox_ptr, const message_t *message)
+{
+    //存新的樣本：存滿 (或放不下) 就重新量，已經送出的訊息都在正式的 mailbox 裡，exit 排在它們後面
+    if (at->capture)
+    {
+        if (sample_add(at, message->msgText, message->msgLen) == -1 || --at->capture == 0)
+        {
+            at->capture = 0;
+            int old = at->mode;
+            int mode = calibrate(at, mailbox_ptr);
+            if (mode != old)
+                at->switches++;
+            start_run(at, mailbox_ptr, mode);
+        }
+        return;
+    }
+
+    double avg = (double)at->window_bytes / at->window_msgs;
+    at->window_msgs = at->window_bytes = 0;
+    int drift = avg + 1 > (at->size + 1) * AUTO_DRIFT || (avg + 1) * AUTO_DRIFT < at->size + 1;
+    int due = stats_now() - at->calibrated_at > AUTO_RECHECK_S * 1000000000ull;
+    if (drift || due)
+    {
+        sample_reset(at);
+        at->capture = AUTO_SAMPLE;
+    }
+}
+
+/* =============================== receiver =============================== */
+
+//probe：收到 exit 為止，內容不看
+static void drain(autotune_t *at, int mode)
+{
+    mailbox_t box;
+    message_t messages[AUTO_RECV_BATCH] = {0};
+    probe_box(at, &box, mode, MAILBOX_RECEIVER);
+    int done = 0;
+    while (!done)
+    {
+        int n = mailbox_recv_batch(&box, messages, AUTO_RECV_BATCH);
+        for (int i = 0; i < n; i++)
+        {
+            done = done || (messages[i].msgLen == 4 && memcmp(message_data(&messages[i]), "exit", 4) == 0);
+            mailbox_release(&box, &messages[i]);
+        }
+    }
+    mailbox_close(&box);
+    for (int i = 0; i < AUTO_RECV_BATCH; i++)
+        free(messages[i].msgText);
+}
+
+void auto_next(autotune_t *at, mailbox_t *mailbox_ptr)
+{
+    if (at->mode)
+        close_run(at, mailbox_ptr);
+    for (;;)
+    {
+        fevent_await(&at->ctl->posted, &at->config.spin, posted, at);
+        at->seq = atomic_load_explicit(&at->ctl->seq, memory_order_acquire);
+        int mode = at->ctl->mode;
+        if (at->ctl->step == AUTO_RUN)
+        {
+            *mailbox_ptr = at->config;
+            mailbox_open(mailbox_ptr, mode, MAILBOX_RECEIVER, at->key_path);
+            at->mode = mode;
+            ack(at);
+            return;
+        }
+        drain(at, mode);
+        ack(at);
+    }
+}
+
+int auto_switching(autotune_t *at)
+{
+    return atomic_load_explicit(&at->ctl->seq, memory_order_acquire) != at->seq;
+}
@@ -0,0 +1,92 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include "mailbox.h"
+
+/*
+    auto mode (mode 參數寫 "auto")：sender / receiver 一開始先量一輪，挑這份資料最快的 transport
+    兩邊透過一塊小的控制區段 (auto_ctl_t) 對話，sender 一次貼一個 step，receiver 做完就 ack：
+        AUTO_PROBE  兩邊在 AUTO_LANE 開一個 mode 的 mailbox，sender 送 count 則樣本再送 exit，receiver 收完關掉
+                    sender 從開始送到收到 ack 的時間就是這個 mode 的速率 (msgs/s)
+        AUTO_RUN    兩邊用挑中的 mode 開正式的 mailbox (lane 0)，之後和一般的 mode 一樣
+    樣本是 input 檔開頭的 AUTO_SAMPLE 行 (真的內容、真的長度分布)，輪流送
+    sender 每 AUTO_WINDOW 則看一次平均長度：和校正時差 AUTO_DRIFT 倍以上，或距離上次校正超過 AUTO_RECHECK_S 秒，
+        就把接下來的 AUTO_SAMPLE 則存成新的樣本，再量一次：
+        先貼第一個 PROBE 再在正式的 mailbox 送 exit，receiver 收到 exit 時看到 seq 變了，就知道不是結束，關掉換下一個 step
+        新的第一名要比目前的 mode 快 AUTO_MARGIN 以上才換 (量的誤差不會讓它一直換來換去)
+    一次只有一個 step 在路上：貼新的 step 之前先等上一個的 ack
+    只支援一個 sender 對一個 receiver；最後一個 exit 之後 seq 沒變，receiver 移除控制區段
+*/
+#define AUTO_MAGIC 0x4155544fu // "AUTO"
+#define AUTO_PROJ_ID 72         // ftok() 的編號，和 STATS_PROJ_ID 71 分開
+#define AUTO_LANE 200           // probe 的 mailbox 用這條 lane 的 key，和正式的 (lane 0) 分開
+#define AUTO_PROBE 1
+#define AUTO_RUN 2
+#define AUTO_SAMPLE 256              // 樣本最多幾行
+#define AUTO_SAMPLE_BYTES (1u << 20) // 樣本最多這麼多 byte (至少一行)
+#define AUTO_PROBE_BYTES (8u << 20)  // 一個 mode 大約送這麼多 byte
+#define AUTO_PROBE_MIN 2000          // 一個 mode 至少 / 最多送幾則
+#define AUTO_PROBE_MAX 20000
+#define AUTO_WINDOW 65536    // sender 每送這麼多則檢查一次
+#define AUTO_DRIFT 4         // 平均長度變成 4 倍或 1/4 就重新量
+#define AUTO_RECHECK_S 60
+#define AUTO_MARGIN 1.2
+
+typedef struct {
+    _Atomic uint32_t magic;
+    _Atomic uint32_t seq;   // sender 貼出的最後一個 step
+    _Atomic uint32_t acked; // receiver 做完的最後一個 step
+    _Atomic uint32_t ready; // receiver 掛上來了：sender 等到才開始量，receiver 晚啟動的時間不會算進第一個 mode
+    uint32_t step;          // AUTO_PROBE / AUTO_RUN (seq 之前寫好)
+    int32_t mode;
+    fevent_t posted;        // receiver 等 seq
+    fevent_t done;          // sender 等 acked
+} auto_ctl_t;
+
+typedef struct {
+    mailbox_t config;       // open 之前的設定，每次 open 都從這裡複製
+    const char *key_path;
+    int role;
+    auto_ctl_t *ctl;
+    key_t ctl_key;
+    unsigned candidates;    // sender: 要量哪些 mode (第 m 個 bit)
+    int mode;               // 正式的 mailbox 目前的 mode，0 = 還沒開
+    uint32_t seq;           // sender: 最後貼出的 step；receiver: 最後處理的 step
+    double rate[MAILBOX_MODES]; // sender: 最近一次量到的 msgs/s
+    double size;            // sender: 最近一次樣本的平均長度
+    char *sample;           // sender: 樣本一行接一行放，第 i 行是 [off[i], off[i + 1])
+    size_t sample_off[AUTO_SAMPLE + 1];
+    int samples;
+    int capture;            // sender: 接下來還要存幾則當新的樣本
+    uint64_t window_msgs;
+    uint64_t window_bytes;
+    uint64_t calibrated_at;
+    unsigned switches;      // sender: 換過幾次 mode
+    double run_time;        // 已經關掉的正式 mailbox 的 total_time 加總
+} autotune_t;
+
+// "auto" 或 "auto:1,3,8" (只量這幾個 mode)：回傳 0，*candidates 是 mode 的 bit (0 = 全部)；不是 auto 回傳 -1
+int auto_parse(const char *arg, unsigned *candidates);
+// config 是呼叫端填好、還沒 open 的 mailbox；sender 建立控制區段，receiver 等 sender 建好
+void auto_init(autotune_t *at, const mailbox_t *config, int role, unsigned candidates, const char *key_path);
+// sender：取 path 開頭的樣本、量每個 mode，挑最快的開在 mailbox_ptr
+void auto_start(autotune_t *at, mailbox_t *mailbox_ptr, const char *path);
+// sender：每送出一則呼叫，需要的話在這裡重新量、換掉 mailbox_ptr
+void auto_check(autotune_t *at, mailbox_t *mailbox_ptr, const message_t *message);
+// receiver：關掉目前的正式 mailbox (有的話)，做 sender 貼的 probe，直到下一個 RUN 開在 mailbox_ptr
+void auto_next(autotune_t *at, mailbox_t *mailbox_ptr);
+// receiver 收到 exit 時：sender 已經貼了新的 step (要換 mode) 回傳 1，真的結束了回傳 0
+int auto_switching(autotune_t *at);
+// 正式的 mailbox 關掉之後呼叫：detach，receiver 移除控制區段
+void auto_close(autotune_t *at);
+
+// 熱路徑上只加兩個計數器
+static inline void auto_observe(autotune_t *at, mailbox_t *mailbox_ptr, const message_t *message)
+{
+    at->window_msgs++;
+    at->window_bytes += message->msgLen;
+    if (at->capture || at->window_msgs >= AUTO_WINDOW)
+        auto_check(at, mailbox_ptr, message);
+}
+
+#endif
@@ -0,0 +1,242 @@
+#include "copy.h"
+#include <string.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <sys/sysctl.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define COPY_X86 1
+#endif
+
+static void copy_memcpy(void *dst, const void *src, size_t n)
+{
+    memcpy(dst, src, n);
+}
+
+#ifdef COPY_X86
+//16 byte 一次，最後一段和前面重疊；不到 16 byte 的 (ipcbench -K 會直接呼叫) 用 copy_small()
+static void copy_sse2(void *dst, const void *src, size_t n)
+{
+    if (n < 16)
+    {
+        copy_small(dst, src, n);
+        return;
+    }
+    char *d = dst;
+    const char *s = src;
+    __m128i tail = _mm_loadu_si128((const __m128i *)(s + n - 16));
+    char *end = d + n - 16;
+    for (; n >= 64; n -= 64, d += 64, s += 64)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)s);
+        __m128i b = _mm_loadu_si128((const __m128i *)(s + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *)(s + 32));
+        __m128i e = _mm_loadu_si128((const __m128i *)(s + 48));
+        _mm_storeu_si128((__m128i *)d, a);
+        _mm_storeu_si128((__m128i *)(d + 16), b);
+        _mm_storeu_si128((__m128i *)(d + 32), c);
+        _mm_storeu_si128((__m128i *)(d + 48), e);
+    }
+    for (; n > 16; n -= 16, d += 16, s += 16)
+        _mm_storeu_si128((__m128i *)d, _mm_loadu_si128((const __m128i *)s));
+    _mm_storeu_si128((__m128i *)end, tail);
+}
+
+//non-temporal：先用一般的 store 把 dst 補到 16 byte 對齊，中間 stream，最後一段一般 store
+static void copy_sse2_nt(void *dst, const void *src, size_t n)
+{
+    if (n < 64)
+    {
+        copy_sse2(dst, src, n);
+        return;
+    }
+    char *d = dst;
+    const char *s = src;
+    __m128i tail = _mm_loadu_si128((const __m128i *)(s + n - 16));
+    char *end = d + n - 16;
+    _mm_storeu_si128((__m128i *)d, _mm_loadu_si128((const __m128i *)s));
+    size_t skip = 16 - ((uintptr_t)d & 15);
+    d += skip;
+    s += skip;
+    n -= skip;
+    for (; n >= 64; n -= 64, d += 64, s += 64)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)s);
+        __m128i b = _mm_loadu_si128((const __m128i *)(s + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *)(s + 32));
+        __m128i e = _mm_loadu_si128((const __m128i *)(s + 48));
+        _mm_stream_si128((__m128i *)d, a);
+        _mm_stream_si128((__m128i *)(d + 16), b);
+        _mm_stream_si128((__m128i *)(d + 32), c);
+        _mm_stream_si128((__m128i *)(d + 48), e);
+    }
+    for (; n > 16; n -= 16, d += 16, s += 16)
+        _mm_stream_si128((__m128i *)d, _mm_loadu_si128((const __m128i *)s));
+    //stream store 是 weakly ordered：publish (release store) 之前一定要 sfence
+    _mm_sfence();
+    _mm_storeu_si128((__m128i *)end, tail);
+}
+
+//AVX2 的函式用 target attribute 編，其他檔案不用加 -mavx2；只有 CPU 支援時才會被選到
+__attribute__((target("avx2"))) static void copy_avx2(void *dst, const void *src, size_t n)
+{
+    if (n < 32)
+    {
+        copy_sse2(dst, src, n);
+        return;
+    }
+    char *d = dst;
+    const char *s = src;
+    __m256i tail = _mm256_loadu_si256((const __m256i *)(s + n - 32));
+    char *end = d + n - 32;
+    for (; n >= 128; n -= 128, d += 128, s += 128)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)s);
+        __m256i b = _mm256_loadu_si256((const __m256i *)(s + 32));
+        __m256i c = _mm256_loadu_si256((const __m256i *)(s + 64));
+        __m256i e = _mm256_loadu_si256((const __m256i *)(s + 96));
+        _mm256_storeu_si256((__m256i *)d, a);
+        _mm256_storeu_si256((__m256i *)(d + 32), b);
+        _mm256_storeu_si256((__m256i *)(d + 64), c);
+        _mm256_storeu_si256((__m256i *)(d + 96), e);
+    }
+    for (; n > 32; n -= 32, d += 32, s += 32)
+        _mm256_storeu_si256((__m256i *)d, _mm256_loadu_si256((const __m256i *)s));
+    _mm256_storeu_si256((__m256i *)end, tail);
+}
+
+__attribute__((target("avx2"))) static void copy_avx2_nt(void *dst, const void *src, size_t n)
+{
+    if (n < 128)
+    {
+        copy_avx2(dst, src, n);
+        return;
+    }
+    char *d = dst;
+    const char *s = src;
+    __m256i tail = _mm256_loadu_si256((const __m256i *)(s + n - 32));
+    char *end = d + n - 32;
+    _mm256_storeu_si256((__m256i *)d, _mm256_loadu_si256((const __m256i *)s));
+    size_t skip = 32 - ((uintptr_t)d & 31);
+    d += skip;
+    s += skip;
+    n -= skip;
+    for (; n >= 128; n -= 128, d += 128, s += 128)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)s);
+        __m256i b = _mm256_loadu_si256((const __m256i *)(s + 32));
+        __m256i c = _mm256_loadu_si256((const __m256i *)(s + 64));
+        __m256i e = _mm256_loadu_si256((const __m256i *)(s + 96));
+        _mm256_stream_si256((__m256i *)d, a);
+        _mm256_stream_si256((__m256i *)(d + 32), b);
+        _mm256_stream_si256((__m256i *)(d + 64), c);
+        _mm256_stream_si256((__m256i *)(d + 96), e);
+    }
+    for (; n > 32; n -= 32, d += 32, s += 32)
+        _mm256_stream_si256((__m256i *)d, _mm256_loadu_si256((const __m256i *)s));
+    _mm_sfence();
+    _mm256_storeu_si256((__m256i *)end, tail);
+}
+#endif
+
+static const copy_kernel_t kernels[] = {
+    {"memcpy", copy_memcpy},
+#ifdef COPY_X86
+    {"sse2", copy_sse2},
+    {"sse2-nt", copy_sse2_nt},
+    {"avx2", copy_avx2},
+    {"avx2-nt", copy_avx2_nt},
+#endif
+};
+
+static int avx2_ok(void)
+{
+#ifdef COPY_X86
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return 0;
+#endif
+}
+
+//程式一開始 (main() 之前、還沒有任何 thread) 就依照 CPU 選好，之後只有 copy_select() 會改
+//stripe 的 lane thread、pool 的 worker 第一次複製時只讀，不會同時寫這兩個 pointer
+copy_fn_t copy_simd_fn = copy_memcpy;
+copy_fn_t copy_large_fn = copy_memcpy;
+static const char *selected = "memcpy";
+static size_t cache_bytes = COPY_CACHE_DEFAULT;
+
+__attribute__((constructor)) static void copy_init(void)
+{
+    copy_select("auto");
+#if defined(_SC_LEVEL2_CACHE_SIZE)
+    long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (l2 > 0)
+        cache_bytes = (size_t)l2;
+#elif defined(__APPLE__)
+    uint64_t l2 = 0;
+    size_t len = sizeof(l2);
+    if (sysctlbyname("hw.l2cachesize", &l2, &len, NULL, 0) == 0 && l2 > 0)
+        cache_bytes = (size_t)l2;
+#endif
+}
+
+int copy_select(const char *name)
+{
+    if (strcmp(name, "auto") == 0)
+#ifdef COPY_X86
+        name = avx2_ok() ? "avx2" : "sse2";
+#else
+        name = "memcpy";
+#endif
+
+    //和 copy_kernels() 一樣：CPU 沒有 AVX2 就沒有 avx2 這一組
+    if (strcmp(name, "avx2") == 0 && !avx2_ok())
+        return -1;
+
+    if (strcmp(name, "memcpy") == 0)
+    {
+        copy_simd_fn = copy_memcpy;
+        copy_large_fn = copy_memcpy;
+    }
+#ifdef COPY_X86
+    else if (strcmp(name, "sse2") == 0)
+    {
+        copy_simd_fn = copy_sse2;
+        copy_large_fn = copy_sse2_nt;
+    }
+    else if (strcmp(name, "avx2") == 0)
+    {
+        copy_simd_fn = copy_avx2;
+        copy_large_fn = copy_avx2_nt;
+    }
+#endif
+    else
+        return -1;
+    selected = name;
+    return 0;
+}
+
+const char *copy_selected(void)
+{
+    return selected;
+}
+
+size_t copy_cache_bytes(void)
+{
+    return cache_bytes;
+}
+
+size_t copy_nt_min(size_t region)
+{
+    return region > cache_bytes ? COPY_NT_CHUNK : 0;
+}
+
+int copy_kernels(const copy_kernel_t **list)
+{
+    *list = kernels;
+    int n = (int)(sizeof(kernels) / sizeof(kernels[0]));
+    //沒有 AVX2 的 CPU：avx2 / avx2-nt 在最後面，直接不算
+    return avx2_ok() ? n : (n > 1 ? n - 2 : n);
+}
@@ -0,0 +1,101 @@
+#ifndef COPY_H
+#define COPY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+    payload 複製 (sender 寫進共享記憶體、receiver 從共享記憶體讀出來) 依照長度選不同的做法：
+        <= COPY_SMALL        inline 的小複製：最多兩次重疊的 load / store，沒有迴圈也沒有函式呼叫
+        <= COPY_SIMD_MAX     自己的 SIMD 迴圈 (AVX2 32 byte / SSE2 16 byte 一次，最後一段重疊)，沒有 memcpy 的分派成本
+        更長                 libc 的 memcpy：glibc 會依照 CPU 用 AVX-512 / rep movsb，中等大小比自己寫的迴圈快 (ipcbench -K)
+    non-temporal store (stream，不經過 cache 直接寫進記憶體) 只給 sender 寫進共享區用 (copy_to_shared())：
+        整塊共享區 (ring / cell / arena) 比 sender 的 L2 大的時候，ring 繞一圈回來寫的 line 早就不在 cache 裡，
+        一般的 store 要先把舊的 line 讀進來 (RFO)、再把 sender 自己的資料擠掉；stream 兩個都省掉
+        共享區放得進 L2 時，consumer 直接從 sender 的 cache 拿最快，不用 stream
+        receiver 讀出來、組回訊息的 copy (馬上就要用) 一律用 copy_bytes()，留在 cache 裡
+    用哪一組 kernel 在程式啟動時 (constructor) 依照 CPU 支援的指令集決定 (__builtin_cpu_supports)，
+    也可以在開 thread 之前用 copy_select() 指定
+    x86 以外的平台 (例如 arm64 的 macOS) 全部用 memcpy
+*/
+#define COPY_SMALL 16
+#define COPY_SIMD_MAX 256
+#define COPY_NT_CHUNK 4096           // 共享區比 L2 大時，一次寫這麼多以上才 stream (sfence 的成本分攤得掉)
+#define COPY_CACHE_DEFAULT (1u << 20) // 查不到 L2 大小時的假設
+
+typedef void (*copy_fn_t)(void *dst, const void *src, size_t n);
+
+extern copy_fn_t copy_simd_fn;  // COPY_SMALL < n <= COPY_SIMD_MAX
+extern copy_fn_t copy_large_fn; // copy_to_shared() 的 n >= nt_min
+
+// n <= COPY_SMALL：頭尾各一次 (可能重疊的) load / store
+static inline void copy_small(void *dst, const void *src, size_t n)
+{
+    char *d = dst;
+    const char *s = src;
+    if (n >= 8)
+    {
+        uint64_t a, b;
+        memcpy(&a, s, 8);
+        memcpy(&b, s + n - 8, 8);
+        memcpy(d, &a, 8);
+        memcpy(d + n - 8, &b, 8);
+    }
+    else if (n >= 4)
+    {
+        uint32_t a, b;
+        memcpy(&a, s, 4);
+        memcpy(&b, s + n - 4, 4);
+        memcpy(d, &a, 4);
+        memcpy(d + n - 4, &b, 4);
+    }
+    else if (n > 0)
+    {
+        d[0] = s[0];
+        d[n / 2] = s[n / 2];
+        d[n - 1] = s[n - 1];
+    }
+}
+
+// 和 memcpy 一樣 (dst / src 不能重疊)，依照長度選 kernel
+static inline void copy_bytes(void *dst, const void *src, size_t n)
+{
+    if (n <= COPY_SMALL)
+        copy_small(dst, src, n);
+    else if (n <= COPY_SIMD_MAX)
+        copy_simd_fn(dst, src, n);
+    else
+        memcpy(dst, src, n);
+}
+
+// sender 寫進共享區：n >= nt_min 用 stream (結尾有 sfence，之後 publish 就看得到)，其他和 copy_bytes() 一樣
+// nt_min 是 copy_nt_min() 依照共享區大小算好的，0 = 不用 stream
+static inline void copy_to_shared(void *dst, const void *src, size_t n, size_t nt_min)
+{
+    if (nt_min && n >= nt_min)
+        copy_large_fn(dst, src, n);
+    else
+        copy_bytes(dst, src, n);
+}
+
+// sender 寫的共享區總共 region byte：比 L2 大回傳 COPY_NT_CHUNK，放得進去回傳 0 (open 時算一次存起來)
+size_t copy_nt_min(size_t region);
+// 這台機器每個 core 的 L2 大小 (查不到是 COPY_CACHE_DEFAULT)
+size_t copy_cache_bytes(void);
+
+// "auto" (依照 CPU 選最好的)、"memcpy"、"sse2"、"avx2"：換掉 simd / large 兩個 kernel
+// CPU 不支援 (沒有 AVX2 的 avx2) 或不認得的名字回傳 -1，原本的設定不變；要在開 thread 之前呼叫
+int copy_select(const char *name);
+// 目前用的是哪一組 ("avx2"、"sse2"、"memcpy")
+const char *copy_selected(void);
+
+// benchmark 用：一個一個 kernel 單獨拿出來比 (不依照長度切換)
+typedef struct {
+    const char *name;
+    copy_fn_t fn;
+} copy_kernel_t;
+// 這台機器可以用的 kernel (第一個是 memcpy)，回傳個數
+int copy_kernels(const copy_kernel_t **kernels);
+
+#endif
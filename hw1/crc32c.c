@@ -0,0 +1,204 @@
+#include "crc32c.h"
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CRC_X86 1
+#endif
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define CRC_ARM 1
+#endif
+
+#define CRC_POLY 0x82f63b78u // 0x1EDC6F41 反轉過的 (LSB first)
+
+/*
+    下面的 kernel 都是「沒有取反」的 CRC：crc32c() 進來先 ~、出去再 ~
+    沒有取反的 CRC 是線性的：A 後面接 B 的 CRC = shift(crc(A), len(B)) ^ crc(B 從 0 開始算)
+    shift(c, n) = c * x^(8n) mod P，三段交錯算完就是用這個合併
+*/
+typedef uint32_t (*crc_fn_t)(uint32_t crc, const unsigned char *p, size_t n);
+
+// slicing-by-8：table[k][b] = byte b 後面再接 k 個 0 byte 的 CRC，一次查 8 個表處理 8 byte
+static uint32_t table[8][256];
+
+static void build_table(void)
+{
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++)
+            c = c & 1 ? (c >> 1) ^ CRC_POLY : c >> 1;
+        table[0][i] = c;
+    }
+    for (int i = 0; i < 256; i++)
+        for (int k = 1; k < 8; k++)
+            table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xff];
+}
+
+static uint32_t crc_sw(uint32_t crc, const unsigned char *p, size_t n)
+{
+    for (; n > 0 && ((uintptr_t)p & 7); n--)
+        crc = (crc >> 8) ^ table[0][(crc ^ *p++) & 0xff];
+    for (; n >= 8; n -= 8, p += 8)
+    {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        w ^= crc;
+        crc = table[7][w & 0xff] ^ table[6][(w >> 8) & 0xff] ^ table[5][(w >> 16) & 0xff] ^
+              table[4][(w >> 24) & 0xff] ^ table[3][(w >> 32) & 0xff] ^ table[2][(w >> 40) & 0xff] ^
+              table[1][(w >> 48) & 0xff] ^ table[0][w >> 56];
+    }
+    for (; n > 0; n--)
+        crc = (crc >> 8) ^ table[0][(crc ^ *p++) & 0xff];
+    return crc;
+}
+
+#ifdef CRC_X86
+/*
+    crc32 指令一個接一個做只能 3 cycle 一個 (等上一個的結果)：長的資料切成三段同時算，每 cycle 都有一個在做
+    段落長度兩種：CRC_LONG 用在很長的資料 (合併的成本攤得更薄)，剩下的用 CRC_SHORT
+    合併用的常數 x^(8n - 33) mod P 在選 kernel 時算好：PCLMULQDQ 的乘積多了一個 x，crc32(0, v) 又乘了 x^32
+*/
+#define CRC_LONG 4096
+#define CRC_SHORT 256
+static uint32_t k_long[2], k_short[2]; // [0] = 移過一段，[1] = 移過兩段
+
+// x^n mod P (反轉過的表示法：bit 31 是 x^0)
+static uint32_t xpow(size_t n)
+{
+    uint32_t p = 0x80000000u;
+    while (n--)
+        p = p & 1 ? (p >> 1) ^ CRC_POLY : p >> 1;
+    return p;
+}
+
+__attribute__((target("sse4.2,pclmul"))) static uint32_t crc_shift(uint32_t crc, uint32_t k)
+{
+    __m128i prod = _mm_clmulepi64_si128(_mm_cvtsi32_si128((int)crc), _mm_cvtsi32_si128((int)k), 0);
+    return (uint32_t)_mm_crc32_u64(0, (uint64_t)_mm_cvtsi128_si64(prod));
+}
+
+// 三段 block byte 一起算，回傳三段接起來的 CRC
+__attribute__((target("sse4.2,pclmul"))) static uint32_t crc_3way(uint32_t crc, const unsigned char *p, size_t block,
+                                                                  const uint32_t *k)
+{
+    uint64_t a = crc, b = 0, c = 0;
+    for (size_t i = 0; i < block; i += 8)
+    {
+        uint64_t x, y, z;
+        memcpy(&x, p + i, 8);
+        memcpy(&y, p + block + i, 8);
+        memcpy(&z, p + 2 * block + i, 8);
+        a = _mm_crc32_u64(a, x);
+        b = _mm_crc32_u64(b, y);
+        c = _mm_crc32_u64(c, z);
+    }
+    return crc_shift((uint32_t)a, k[1]) ^ crc_shift((uint32_t)b, k[0]) ^ (uint32_t)c;
+}
+
+__attribute__((target("sse4.2,pclmul"))) static uint32_t crc_sse42(uint32_t crc, const unsigned char *p, size_t n)
+{
+    for (; n > 0 && ((uintptr_t)p & 7); n--)
+        crc = _mm_crc32_u8(crc, *p++);
+    for (; n >= 3 * CRC_LONG; n -= 3 * CRC_LONG, p += 3 * CRC_LONG)
+        crc = crc_3way(crc, p, CRC_LONG, k_long);
+    for (; n >= 3 * CRC_SHORT; n -= 3 * CRC_SHORT, p += 3 * CRC_SHORT)
+        crc = crc_3way(crc, p, CRC_SHORT, k_short);
+    uint64_t c = crc;
+    for (; n >= 8; n -= 8, p += 8)
+    {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        c = _mm_crc32_u64(c, w);
+    }
+    crc = (uint32_t)c;
+    for (; n > 0; n--)
+        crc = _mm_crc32_u8(crc, *p++);
+    return crc;
+}
+
+static int sse42_ok(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("pclmul");
+}
+#endif
+
+#ifdef CRC_ARM
+static uint32_t crc_armv8(uint32_t crc, const unsigned char *p, size_t n)
+{
+    for (; n > 0 && ((uintptr_t)p & 7); n--)
+        crc = __crc32cb(crc, *p++);
+    for (; n >= 8; n -= 8, p += 8)
+    {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        crc = __crc32cd(crc, w);
+    }
+    for (; n > 0; n--)
+        crc = __crc32cb(crc, *p++);
+    return crc;
+}
+#endif
+
+//第一次呼叫時才決定 (和 copy.c 一樣)；兩個 thread 同時進來也只是算一樣的表、寫一樣的值
+static uint32_t crc_resolve(uint32_t crc, const unsigned char *p, size_t n);
+static crc_fn_t crc_fn = crc_resolve;
+static const char *selected = "auto";
+
+static uint32_t crc_resolve(uint32_t crc, const unsigned char *p, size_t n)
+{
+    crc32c_select("auto");
+    return crc_fn(crc, p, n);
+}
+
+int crc32c_select(const char *name)
+{
+    if (strcmp(name, "auto") == 0)
+    {
+        name = "sw";
+#ifdef CRC_X86
+        if (sse42_ok())
+            name = "sse4.2";
+#endif
+#ifdef CRC_ARM
+        name = "armv8";
+#endif
+    }
+
+    if (strcmp(name, "sw") == 0)
+    {
+        build_table();
+        crc_fn = crc_sw;
+    }
+#ifdef CRC_X86
+    else if (strcmp(name, "sse4.2") == 0 && sse42_ok())
+    {
+        k_long[0] = xpow(8 * CRC_LONG - 33);
+        k_long[1] = xpow(16 * CRC_LONG - 33);
+        k_short[0] = xpow(8 * CRC_SHORT - 33);
+        k_short[1] = xpow(16 * CRC_SHORT - 33);
+        crc_fn = crc_sse42;
+    }
+#endif
+#ifdef CRC_ARM
+    else if (strcmp(name, "armv8") == 0)
+        crc_fn = crc_armv8;
+#endif
+    else
+        return -1;
+    selected = name;
+    return 0;
+}
+
+const char *crc32c_selected(void)
+{
+    if (strcmp(selected, "auto") == 0)
+        crc32c_select("auto");
+    return selected;
+}
+
+uint32_t crc32c(uint32_t crc, const void *data, size_t len)
+{
+    return ~crc_fn(~crc, data, len);
+}
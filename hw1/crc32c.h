@@ -0,0 +1,24 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+    CRC32C (Castagnoli，iSCSI / ext4 用的多項式 0x1EDC6F41)：mailbox 開 integrity 時每則訊息都算一次 (見 FRAME_CRC)
+    依照 CPU 選 kernel，第一次呼叫時決定 (__builtin_cpu_supports)，也可以用 crc32c_select() 指定：
+        "sse4.2"   crc32 指令一次 8 byte；長的資料切成三段交錯算 (crc32 的 latency 是 3 cycle、throughput 1 cycle)，
+                   三段的結果再用 PCLMULQDQ 乘上 x^(8n) 合併成一個
+        "armv8"    arm64 的 crc32cx 指令 (編譯時有 __ARM_FEATURE_CRC32 才有，例如 Apple M 系列)
+        "sw"       slicing-by-8 查表，任何平台都可以用
+*/
+
+// 接著 crc 繼續算 len byte (第一次傳 0)：crc32c(crc32c(0, a), b) == a 和 b 接起來的 CRC
+uint32_t crc32c(uint32_t crc, const void *data, size_t len);
+
+// "auto"、"sw"、"sse4.2"、"armv8"：CPU 不支援或不認得的名字回傳 -1，原本的設定不變
+int crc32c_select(const char *name);
+// 目前用的是哪一個
+const char *crc32c_selected(void);
+
+#endif
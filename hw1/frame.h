@@ -0,0 +1,50 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+    每一則訊息在傳輸時都會包成一個或多個 frame：
+        [frame_hdr_t][payload (len bytes)][補到 8 byte 對齊]
+    payload 可以是任意 binary 資料，長度由 header 決定，不再依賴 '\0'
+    超過 transport 單次能搬的大小時，會拆成多個 frame，除了最後一個都帶 FRAME_MORE
+*/
+typedef struct {
+    uint32_t len;   // 這個 frame 的 payload 長度 (byte)
+    uint32_t flags; // FRAME_*
+} frame_hdr_t;
+
+#define FRAME_ALIGN 8
+#define FRAME_MORE 0x1 // 同一則訊息後面還有片段
+#define FRAME_PAD  0x2 // ring 尾端的填充，receiver 直接跳過
+#define FRAME_FILE 0x4 // payload 是要共享的檔案路徑，receiver 收到就 mmap 它 (見 mailbox_share_file())
+#define FRAME_REF  0x8 // payload 是 frame_ref_t：內容不在 frame 裡，在共享的檔案 mapping 裡
+#define FRAME_ARENA 0x20 // payload 是 frame_ref_t：內容在共享的 arena 裡 (見 arena.h)，receiver 用完要還回去
+#define FRAME_WAKE 0x10 // 空的 frame，只是叫醒睡在 bulk mailbox 上的 receiver 回頭去收 urgent (見 mailbox_send_prio())
+#define FRAME_CRC  0x80 // 訊息的第一個 frame：payload 前 FRAME_CRC_SIZE byte 是整則訊息內容的 CRC32C，後面才是內容 (見 mailbox_t 的 integrity)
+#define FRAME_CRC_SIZE 8 // CRC32C 4 byte + 4 byte 填充，後面的內容保持 8 byte 對齊
+#define FRAME_ABORT 0x40 // 空的 frame：前一個 sender 掛在訊息中間，receiver 收到一半的片段要丟掉 (見 ring.h 的 persist)
+#define FRAME_LZ   0x100 // transfer 裡唯一的 frame：payload 是壓縮過的整個 batch，前 FRAME_LZ_SIZE byte 是原本的長度 (見 lz.h)
+#define FRAME_LZ_SIZE 8  // 原本的長度 (uint64_t)
+
+// FRAME_REF / FRAME_ARENA 的 payload：訊息內容在共享檔案 (arena) 裡的位置，只有這 16 byte 會經過 mailbox
+typedef struct {
+    uint64_t off;
+    uint64_t len;
+} frame_ref_t;
+
+#define FRAME_HDR_SIZE sizeof(frame_hdr_t)
+
+// 整個 frame (header + 對齊後的 payload) 佔用的 byte 數
+static inline size_t frame_size(size_t len)
+{
+    return FRAME_HDR_SIZE + ((len + FRAME_ALIGN - 1) & ~(size_t)(FRAME_ALIGN - 1));
+}
+
+static inline char *frame_payload(frame_hdr_t *hdr)
+{
+    return (char *)(hdr + 1);
+}
+
+#endif
@@ -0,0 +1,78 @@
+#include "hist.h"
+#include <string.h>
+
+void hist_init(hist_t *hist)
+{
+    memset(hist, 0, sizeof(*hist));
+    hist->min = UINT64_MAX;
+}
+
+//value < HIST_SUB 直接對應一個 bucket
+//其他的：最高位元 msb 決定在哪一組，msb 後面的 HIST_SUB_BITS 個 bit 決定組內第幾個
+static unsigned bucket_of(uint64_t value)
+{
+    if (value < HIST_SUB)
+        return (unsigned)value;
+    unsigned msb = 63 - __builtin_clzll(value);
+    unsigned shift = msb - HIST_SUB_BITS;
+    return (shift + 1) * HIST_SUB + (unsigned)((value >> shift) & (HIST_SUB - 1));
+}
+
+//bucket 裡最大的值
+static uint64_t bucket_upper(unsigned idx)
+{
+    if (idx < HIST_SUB)
+        return idx;
+    unsigned shift = idx / HIST_SUB - 1;
+    uint64_t lower = (uint64_t)(HIST_SUB + idx % HIST_SUB) << shift;
+    return lower + ((uint64_t)1 << shift) - 1;
+}
+
+void hist_record(hist_t *hist, uint64_t value)
+{
+    hist->buckets[bucket_of(value)]++;
+    hist->count++;
+    hist->sum += (double)value;
+    if (value < hist->min)
+        hist->min = value;
+    if (value > hist->max)
+        hist->max = value;
+}
+
+uint64_t hist_percentile(const hist_t *hist, double q)
+{
+    if (hist->count == 0)
+        return 0;
+    //第 rank 個樣本 (從 1 開始數) 落在哪個 bucket
+    uint64_t rank = (uint64_t)(q / 100.0 * (double)hist->count + 0.5);
+    if (rank < 1)
+        rank = 1;
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < HIST_BUCKETS; i++)
+    {
+        seen += hist->buckets[i];
+        if (seen >= rank)
+        {
+            uint64_t upper = bucket_upper(i);
+            return upper < hist->max ? upper : hist->max;
+        }
+    }
+    return hist->max;
+}
+
+double hist_mean(const hist_t *hist)
+{
+    return hist->count ? hist->sum / (double)hist->count : 0.0;
+}
+
+void hist_merge(hist_t *dst, const hist_t *src)
+{
+    for (unsigned i = 0; i < HIST_BUCKETS; i++)
+        dst->buckets[i] += src->buckets[i];
+    dst->count += src->count;
+    dst->sum += src->sum;
+    if (src->min < dst->min)
+        dst->min = src->min;
+    if (src->max > dst->max)
+        dst->max = src->max;
+}
@@ -0,0 +1,32 @@
+#ifndef HIST_H
+#define HIST_H
+
+#include <stdint.h>
+
+/*
+    log-linear latency histogram (單位 ns)
+    每個 2 的次方區間再切成 HIST_SUB 個等寬的 bucket，誤差最多 1/HIST_SUB (約 3%)
+    bucket 數固定，記錄一次只要幾個 shift，不需要 malloc，可以整個丟進 pipe 傳回 parent
+*/
+
+#define HIST_SUB_BITS 5
+#define HIST_SUB (1 << HIST_SUB_BITS)              // 32
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS + 1) * HIST_SUB) // 1920，涵蓋整個 uint64_t
+
+typedef struct {
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    double sum;
+    uint64_t buckets[HIST_BUCKETS];
+} hist_t;
+
+void hist_init(hist_t *hist);
+void hist_record(hist_t *hist, uint64_t value);
+// 第 q 百分位數 (0 < q <= 100)，回傳所在 bucket 的上界
+uint64_t hist_percentile(const hist_t *hist, double q);
+double hist_mean(const hist_t *hist);
+// 把 src 的樣本加進 dst (例如好幾個 receiver 的 latency 合在一起看)
+void hist_merge(hist_t *dst, const hist_t *src);
+
+#endif
@@ -0,0 +1,590 @@
+#define _GNU_SOURCE
+#include "mailbox.h"
+#include "hist.h"
+#include "ring.h"
+#include "stripe.h"
+#include "copy.h"
+#include "crc32c.h"
+#include <sys/wait.h>
+#include <errno.h>
+
+/*
+    ipcbench: 量測每種 transport 的 end-to-end latency 和 throughput
+    每一組 (mode, payload 大小) 都開一對新的 sender / receiver：
+        parent 是 sender，每則訊息開頭放送出當下的 CLOCK_MONOTONIC 時間
+        fork 出來的 child 是 receiver，收到時 latency = 現在 - 訊息裡的時間，記在 hist_t
+        child 收完之後把 histogram 和收訊時間經由 pipe 傳回 parent
+    key 用 mkdtemp() 建的暫存目錄產生，不會和同目錄下正在跑的 sender / receiver 撞到
+    SHM_BCAST 可以用 -r 開好幾個 receiver (subscriber)：latency 合在一起算，throughput 是每個 subscriber 收到的速率
+    -H / -N / -c 控制共享區段和兩個 process 放在哪裡 (見 place.h)，實際的結果也印在每一列
+    -k 指定 payload 用哪一組 copy kernel (見 copy.h)；-K 不跑 IPC，只比較每個 copy kernel 和 memcpy 的速度
+    -l 改成量 stripe (見 stripe.h)：一整塊資料切成 payload 大小的 chunk 分散到 N 條 lane，只量 throughput (latency 欄位是 0)
+    -I 開 integrity (每則訊息的 CRC32C，見 crc32c.h)；both = 每一組都開和不開各跑一次，crc 欄位是 off 或用的 kernel
+    -L 壓縮這麼大以上的 batch (見 lz.h)，lz 欄位是門檻 (0 = 不壓縮)；payload 是重複的 a-z，壓縮率比一般的文字好很多
+*/
+
+#define DEFAULT_COUNT 10000
+#define DEFAULT_WARMUP 1000
+#define MAX_READERS 32
+#define STRIPE_BENCH_MAX (256u << 20) // -l: 一次最多送這麼多 byte (size * count 比這個大時)
+
+//每則訊息 payload 的開頭
+typedef struct {
+    uint64_t send_ns;  // sender 呼叫 mailbox_send() 前的時間
+    uint32_t seq;
+    uint32_t last;     // 1 = 最後一則，receiver 收到就結束
+} bench_hdr_t;
+
+//child 透過 pipe 傳回來的結果
+typedef struct {
+    hist_t hist;
+    uint64_t first_ns;  // 第一則 (warmup 之後) 訊息送出的時間
+    uint64_t last_ns;   // 最後一則收到的時間
+    uint64_t received;
+    uint64_t out_of_order;
+} bench_result_t;
+
+typedef struct {
+    int count;
+    int warmup;
+    size_t batch_bytes;
+    long batch_timeout_us;
+    unsigned window;
+    int readers;  // SHM_BCAST 的 receiver 數，其他模式固定 1 個
+    int lanes;    // -l: stripe 的 lane 數，0 = 一般的訊息 benchmark
+    int integrity; // 這一次跑要不要加 CRC32C (-I)
+    size_t compress_min; // -L：sender 壓縮這麼大以上的 batch，0 = 不壓縮
+    size_t ring_bytes;
+    place_t place;     // sender 的設定：huge page、NUMA node、sender CPU
+    int receiver_cpu;  // receiver 跑在哪個 CPU，-1 = 不 pin
+    spin_t spin;
+} bench_opts_t;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+//"1,2,3" -> {1,2,3}，回傳有幾個
+static int parse_list(const char *arg, long *out, int max)
+{
+    int n = 0;
+    const char *p = arg;
+    while (*p && n < max)
+    {
+        char *end;
+        long v = strtol(p, &end, 10);
+        if (end == p || v <= 0)
+            return -1;
+        out[n++] = v;
+        p = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',')
+            return -1;
+    }
+    return n;
+}
+
+static void write_all(int fd, const void *buf, size_t len)
+{
+    const char *p = buf;
+    while (len > 0)
+    {
+        ssize_t n = write(fd, p, len);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            perror("write failed");
+            _exit(1);
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+}
+
+static int read_all(int fd, void *buf, size_t len)
+{
+    char *p = buf;
+    while (len > 0)
+    {
+        ssize_t n = read(fd, p, len);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+//child: receiver 端，收到 last 為止
+static void run_receiver(int mode, const char *key_path, const bench_opts_t *opts, int fd)
+{
+    static bench_result_t result;
+    message_t messages[64] = {0};
+    mailbox_t mailbox = {0};
+    mailbox.spin = opts->spin;
+    place_init(&mailbox.place);
+    mailbox.place.cpu = opts->receiver_cpu;
+    mailbox_open(&mailbox, mode, MAILBOX_RECEIVER, key_path);
+
+    hist_init(&result.hist);
+    uint32_t expect = 0;
+    int running = 1;
+    while (running)
+    {
+        int n = mailbox_recv_batch(&mailbox, messages, 64);
+        uint64_t now = now_ns();
+        for (int i = 0; i < n; i++)
+        {
+            bench_hdr_t hdr;
+            memcpy(&hdr, messages[i].msgText, sizeof(hdr));
+            if (hdr.seq != expect)
+                result.out_of_order++;
+            expect = hdr.seq + 1;
+            if (hdr.seq >= (uint32_t)opts->warmup)
+            {
+                if (result.received == 0)
+                    result.first_ns = hdr.send_ns;
+                hist_record(&result.hist, now - hdr.send_ns);
+                result.received++;
+            }
+            if (hdr.last)
+            {
+                running = 0;
+                break;
+            }
+        }
+        result.last_ns = now;
+    }
+
+    mailbox_close(&mailbox);
+    for (int i = 0; i < 64; i++)
+        free(messages[i].msgText);
+    write_all(fd, &result, sizeof(result));
+}
+
+//child: stripe 的 receiver，chunk 一定依照 seq 的順序進來
+static void count_chunk(uint64_t seq, const char *data, size_t len, void *arg)
+{
+    bench_result_t *result = arg;
+    (void)data;
+    (void)len;
+    if (seq != result->received)
+        result->out_of_order++;
+    result->received++;
+}
+
+static void run_stripe_receiver(int mode, const char *key_path, const bench_opts_t *opts, int fd)
+{
+    static bench_result_t result;
+    mailbox_t mailbox = {0};
+    mailbox.spin = opts->spin;
+    mailbox.lanes = opts->lanes;
+    place_init(&mailbox.place);
+    mailbox.place.cpu = opts->receiver_cpu;
+    mailbox_open(&mailbox, mode, MAILBOX_RECEIVER, key_path);
+    hist_init(&result.hist);
+    stripe_recv(&mailbox, count_chunk, &result);
+    result.last_ns = now_ns();
+    mailbox_close(&mailbox);
+    write_all(fd, &result, sizeof(result));
+}
+
+//parent: stripe 的 sender：size * count byte (最多 STRIPE_BENCH_MAX) 切成 size 大小的 chunk
+static void send_striped(mailbox_t *mailbox_ptr, size_t size, const bench_opts_t *opts, bench_result_t *result)
+{
+    size_t total = size * (size_t)opts->count;
+    if (total > STRIPE_BENCH_MAX)
+        total = STRIPE_BENCH_MAX < size ? size : STRIPE_BENCH_MAX;
+    char *data = malloc(total);
+    if (data == NULL)
+    {
+        perror("malloc failed");
+        exit(1);
+    }
+    //先碰過每個 page，page fault 不算在時間裡
+    for (size_t i = 0; i < total; i++)
+        data[i] = (char)('a' + i % 26);
+    result->first_ns = now_ns();
+    stripe_send(mailbox_ptr, data, total, size);
+    free(data);
+}
+
+//-K: 每個 copy kernel 在每個大小各複製 COPY_BENCH_BYTES 個 byte，和 memcpy 比
+//"auto" 是 mailbox 實際用的 copy_bytes() (依照長度切換)
+#define COPY_BENCH_BYTES (1ull << 30)
+static void copy_bench(const long *sizes, int nsizes, int json, FILE *out)
+{
+    const copy_kernel_t *kernels;
+    int nkernels = copy_kernels(&kernels);
+    if (json)
+        fprintf(out, "[\n");
+    else
+        fprintf(out, "kernel,size,gb_per_sec,vs_memcpy\n");
+    int first = 1;
+    for (int s = 0; s < nsizes; s++)
+    {
+        size_t size = (size_t)sizes[s];
+        char *src = malloc(size), *dst = malloc(size);
+        if (src == NULL || dst == NULL)
+        {
+            perror("malloc failed");
+            exit(1);
+        }
+        memset(src, 'a', size);
+        memset(dst, 0, size);
+        uint64_t iters = COPY_BENCH_BYTES / size ? COPY_BENCH_BYTES / size : 1;
+        double base = 0;
+        for (int k = 0; k <= nkernels; k++)
+        {
+            const char *name = k < nkernels ? kernels[k].name : "auto";
+            uint64_t start = now_ns();
+            for (uint64_t i = 0; i < iters; i++)
+            {
+                if (k < nkernels)
+                    kernels[k].fn(dst, src, size);
+                else
+                    copy_bytes(dst, src, size);
+                //不然 compiler 可能把重複的複製合併掉
+                __asm__ volatile("" : : "r"(dst) : "memory");
+            }
+            double secs = (double)(now_ns() - start) / 1e9;
+            double gbps = secs > 0 ? (double)size * (double)iters / secs / 1e9 : 0.0;
+            if (k == 0)
+                base = gbps;
+            if (json)
+                fprintf(out, "%s  {\"kernel\": \"%s\", \"size\": %zu, \"gb_per_sec\": %.2f, \"vs_memcpy\": %.2f}",
+                        first ? "" : ",\n", name, size, gbps, base > 0 ? gbps / base : 0.0);
+            else
+                fprintf(out, "%s,%zu,%.2f,%.2f\n", name, size, gbps, base > 0 ? gbps / base : 0.0);
+            first = 0;
+        }
+        free(src);
+        free(dst);
+    }
+    if (json)
+        fprintf(out, "\n]\n");
+}
+
+//parent: sender 端；回傳 0 = 成功，*placed 是共享區段實際的配置 (有沒有拿到 huge page、有沒有綁上 node)
+static int run_one(int mode, size_t size, const bench_opts_t *opts, bench_result_t *result, place_t *placed)
+{
+    char key_path[] = "/tmp/ipcbench.XXXXXX";
+    if (mkdtemp(key_path) == NULL)
+    {
+        perror("mkdtemp failed");
+        exit(1);
+    }
+
+    //每個 receiver 一條 pipe：結果比 PIPE_BUF 大，共用一條會交錯
+    int readers = mode == SHM_BCAST ? opts->readers : 1;
+    int fds[MAX_READERS];
+    pid_t pids[MAX_READERS];
+    for (int r = 0; r < readers; r++)
+    {
+        int p[2];
+        if (pipe(p) == -1)
+        {
+            perror("pipe failed");
+            exit(1);
+        }
+        fflush(NULL);
+        pids[r] = fork();
+        if (pids[r] == -1)
+        {
+            perror("fork failed");
+            exit(1);
+        }
+        if (pids[r] == 0)
+        {
+            close(p[0]);
+            if (opts->lanes)
+                run_stripe_receiver(mode, key_path, opts, p[1]);
+            else
+                run_receiver(mode, key_path, opts, p[1]);
+            _exit(0);
+        }
+        close(p[1]);
+        fds[r] = p[0];
+    }
+
+    //先 fork 再 open：有些 transport (FIFO、socket) 的 open 要等另一端也打開才會回來
+    mailbox_t mailbox = {0};
+    mailbox.spin = opts->spin;
+    mailbox.batch_bytes = opts->batch_bytes;
+    mailbox.batch_timeout_us = opts->batch_timeout_us;
+    mailbox.window = opts->window;
+    mailbox.subscribers = (unsigned)readers;
+    mailbox.ring_bytes = opts->ring_bytes;
+    mailbox.place = opts->place;
+    mailbox.lanes = opts->lanes;
+    mailbox.integrity = opts->integrity;
+    mailbox.compress_min = opts->compress_min;
+    mailbox_open(&mailbox, mode, MAILBOX_SENDER, key_path);
+    *placed = mailbox.place;
+
+    uint64_t stripe_start = 0;
+    if (opts->lanes)
+    {
+        send_striped(&mailbox, size, opts, result);
+        stripe_start = result->first_ns;
+    }
+
+    char *payload = malloc(size);
+    if (payload == NULL)
+    {
+        perror("malloc failed");
+        exit(1);
+    }
+    for (size_t i = 0; i < size; i++)
+        payload[i] = (char)('a' + i % 26);
+
+    message_t msg = {.mType = 1, .msgLen = size, .msgText = payload};
+    int total = opts->lanes ? 0 : opts->warmup + opts->count;
+    for (int i = 0; i < total; i++)
+    {
+        bench_hdr_t hdr = {.seq = (uint32_t)i, .last = i == total - 1};
+        hdr.send_ns = now_ns();
+        memcpy(payload, &hdr, sizeof(hdr));
+        mailbox_send(&mailbox, &msg);
+    }
+    if (!opts->lanes)
+        mailbox_flush(&mailbox);
+    free(payload);
+
+    //多個 subscriber：latency 全部合在一起，時間取最早送出到最後收到，received / out_of_order 取最差的那個
+    static bench_result_t one;
+    int failed = 0;
+    for (int r = 0; r < readers; r++)
+    {
+        bench_result_t *dst = r == 0 ? result : &one;
+        int status;
+        if (read_all(fds[r], dst, sizeof(*dst)) == -1)
+            failed = 1;
+        close(fds[r]);
+        waitpid(pids[r], &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            failed = 1;
+        if (r == 0 || failed)
+            continue;
+        hist_merge(&result->hist, &one.hist);
+        if (one.first_ns < result->first_ns)
+            result->first_ns = one.first_ns;
+        if (one.last_ns > result->last_ns)
+            result->last_ns = one.last_ns;
+        if (one.received < result->received)
+            result->received = one.received;
+        if (one.out_of_order > result->out_of_order)
+            result->out_of_order = one.out_of_order;
+    }
+    if (opts->lanes)
+        result->first_ns = stripe_start; // child 不知道 sender 什麼時候開始
+    mailbox_close(&mailbox);
+    rmdir(key_path);
+    return failed ? -1 : 0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-m modes] [-z sizes] [-n count] [-w warmup] [-b batch_bytes] [-t batch_timeout_us]\n"
+            "          [-W window] [-r readers] [-s spins|auto] [-f csv|json] [-o output]\n"
+            "          [-H] [-N node] [-c sender_cpu,receiver_cpu] [-R ring_bytes] [-l lanes] [-k auto|memcpy|sse2|avx2] [-K]\n"
+            "          [-I off|on|both] [-x auto|sw|sse4.2|armv8] [-L min_batch_bytes]\n"
+            "  modes / sizes are comma separated, e.g. -m 1,3 -z 64,4096\n",
+            prog);
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    long modes[MAILBOX_MODES];
+    int nmodes = 0;
+    long sizes[32] = {16, 64, 256, 1024, 4096, 16384, 65536};
+    int nsizes = 7;
+    bench_opts_t opts = {.count = DEFAULT_COUNT, .warmup = DEFAULT_WARMUP, .batch_timeout_us = 1000, .readers = 1};
+    const char *format = "csv";
+    int kernel_bench = 0;
+    int checks[2] = {0, 1};
+    int nchecks = 1;
+    FILE *out = stdout;
+    spin_init(&opts.spin, -1);
+    place_init(&opts.place);
+    opts.receiver_cpu = -1;
+    long cpus[2];
+    //預設跑這個平台上所有的 transport
+    for (int m = 1; m < MAILBOX_MODES; m++)
+        if (mailbox_mode_name(m))
+            modes[nmodes++] = m;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:z:n:w:b:t:W:r:s:f:o:HN:c:R:l:k:KI:x:L:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'm':
+            nmodes = parse_list(optarg, modes, MAILBOX_MODES);
+            break;
+        case 'z':
+            nsizes = parse_list(optarg, sizes, 32);
+            break;
+        case 'n':
+            opts.count = atoi(optarg);
+            break;
+        case 'w':
+            opts.warmup = atoi(optarg);
+            break;
+        case 'b':
+            opts.batch_bytes = strtoul(optarg, NULL, 10);
+            break;
+        case 't':
+            opts.batch_timeout_us = atol(optarg);
+            break;
+        case 'W':
+            opts.window = (unsigned)atoi(optarg);
+            break;
+        case 'r':
+            opts.readers = atoi(optarg);
+            break;
+        case 'H':
+            opts.place.huge = 1;
+            break;
+        case 'N':
+            if ((opts.place.node = place_parse_int(optarg)) == -1)
+                usage(argv[0]);
+            break;
+        case 'c':
+            //"2,3" = sender 在 CPU 2、receiver 在 CPU 3 (parse_list 不收 0，所以自己切)
+            //先檢查：pin 失敗時 sender 已經 fork 出 receiver，會留下一個等不到 sender 的 child
+            if (sscanf(optarg, "%ld,%ld", &cpus[0], &cpus[1]) != 2 || !place_cpu_ok((int)cpus[0]) || !place_cpu_ok((int)cpus[1]))
+                usage(argv[0]);
+            opts.place.cpu = (int)cpus[0];
+            opts.receiver_cpu = (int)cpus[1];
+            break;
+        case 'R':
+            opts.ring_bytes = strtoul(optarg, NULL, 10);
+            if (!ring_bytes_valid(opts.ring_bytes))
+                usage(argv[0]);
+            break;
+        case 'k':
+            //fork 出來的 receiver 也用同一組
+            if (copy_select(optarg) == -1)
+                usage(argv[0]);
+            break;
+        case 'K':
+            kernel_bench = 1;
+            break;
+        case 'I':
+            //checks[] 是每一組要跑的設定：off = {0}、on = {1}、both = {0, 1}
+            if (strcmp(optarg, "off") != 0 && strcmp(optarg, "on") != 0 && strcmp(optarg, "both") != 0)
+                usage(argv[0]);
+            nchecks = strcmp(optarg, "both") == 0 ? 2 : 1;
+            checks[0] = strcmp(optarg, "on") == 0;
+            checks[1] = 1;
+            break;
+        case 'x':
+            if (crc32c_select(optarg) == -1)
+                usage(argv[0]);
+            break;
+        case 'L':
+            opts.compress_min = strtoul(optarg, NULL, 10);
+            break;
+        case 'l':
+            opts.lanes = atoi(optarg);
+            if (opts.lanes < 1 || opts.lanes > STRIPE_LANES_MAX)
+                usage(argv[0]);
+            break;
+        case 's':
+            if (spin_parse(&opts.spin, optarg) == -1)
+                usage(argv[0]);
+            break;
+        case 'f':
+            format = optarg;
+            break;
+        case 'o':
+            out = fopen(optarg, "w");
+            if (out == NULL)
+            {
+                perror("Cannot open output file.");
+                exit(1);
+            }
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    int json = strcmp(format, "json") == 0;
+    if (nmodes <= 0 || nsizes <= 0 || opts.count <= 0 || opts.warmup < 0 || opts.readers <= 0 || opts.readers > MAX_READERS || (!json && strcmp(format, "csv") != 0))
+        usage(argv[0]);
+    for (int i = 0; i < nmodes; i++)
+        if (mailbox_mode_name((int)modes[i]) == NULL)
+            usage(argv[0]);
+
+    if (kernel_bench)
+    {
+        copy_bench(sizes, nsizes, json, out);
+        if (out != stdout)
+            fclose(out);
+        return 0;
+    }
+
+    if (json)
+        fprintf(out, "[\n");
+    else
+        fprintf(out, "mode,name,size,count,batch_bytes,window,readers,lanes,copy,crc,lz,huge,node,sender_cpu,receiver_cpu,msgs_per_sec,mb_per_sec,mean_ns,p50_ns,p90_ns,p99_ns,p999_ns,max_ns\n");
+
+    int first = 1;
+    for (int m = 0; m < nmodes; m++)
+    {
+        for (int s = 0; s < nsizes * nchecks; s++)
+        {
+            //payload 至少要放得下 bench_hdr_t；-I both 時每個大小先跑不檢查、再跑檢查
+            size_t size = (size_t)sizes[s / nchecks] < sizeof(bench_hdr_t) ? sizeof(bench_hdr_t) : (size_t)sizes[s / nchecks];
+            opts.integrity = checks[s % nchecks];
+            const char *crc = opts.integrity ? crc32c_selected() : "off";
+            static bench_result_t r;
+            place_t placed;
+            if (run_one((int)modes[m], size, &opts, &r, &placed) == -1)
+            {
+                fprintf(stderr, "mode %ld size %zu: receiver failed\n", modes[m], size);
+                exit(1);
+            }
+            if (r.out_of_order)
+                fprintf(stderr, "mode %ld size %zu: %llu messages out of order\n",
+                        modes[m], size, (unsigned long long)r.out_of_order);
+
+            double secs = (double)(r.last_ns - r.first_ns) / 1e9;
+            double rate = secs > 0 ? (double)r.received / secs : 0.0;
+            double mbps = rate * (double)size / 1e6;
+            const char *name = mailbox_mode_name((int)modes[m]);
+            int readers = modes[m] == SHM_BCAST ? opts.readers : 1;
+            unsigned long long p50 = hist_percentile(&r.hist, 50), p90 = hist_percentile(&r.hist, 90);
+            unsigned long long p99 = hist_percentile(&r.hist, 99), p999 = hist_percentile(&r.hist, 99.9);
+
+            if (json)
+                fprintf(out,
+                        "%s  {\"mode\": %ld, \"name\": \"%s\", \"size\": %zu, \"count\": %llu, \"batch_bytes\": %zu, \"window\": %u, \"readers\": %d, \"lanes\": %d, \"copy\": \"%s\", \"crc\": \"%s\", \"lz\": %zu, "
+                        "\"huge\": %d, \"node\": %d, \"sender_cpu\": %d, \"receiver_cpu\": %d, "
+                        "\"msgs_per_sec\": %.1f, \"mb_per_sec\": %.2f, \"mean_ns\": %.0f, "
+                        "\"p50_ns\": %llu, \"p90_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu, \"max_ns\": %llu}",
+                        first ? "" : ",\n", modes[m], name, size, (unsigned long long)r.received, opts.batch_bytes, opts.window ? opts.window : 1,
+                        readers, opts.lanes ? opts.lanes : 1, copy_selected(), crc, opts.compress_min, placed.huge_ok, placed.node, opts.place.cpu, opts.receiver_cpu, rate, mbps, hist_mean(&r.hist), p50, p90, p99, p999, (unsigned long long)r.hist.max);
+            else
+                fprintf(out, "%ld,%s,%zu,%llu,%zu,%u,%d,%d,%s,%s,%zu,%d,%d,%d,%d,%.1f,%.2f,%.0f,%llu,%llu,%llu,%llu,%llu\n",
+                        modes[m], name, size, (unsigned long long)r.received, opts.batch_bytes, opts.window ? opts.window : 1,
+                        readers, opts.lanes ? opts.lanes : 1, copy_selected(), crc, opts.compress_min, placed.huge_ok, placed.node, opts.place.cpu, opts.receiver_cpu, rate, mbps, hist_mean(&r.hist), p50, p90, p99, p999, (unsigned long long)r.hist.max);
+            fflush(out);
+            first = 0;
+        }
+    }
+    if (json)
+        fprintf(out, "\n]\n");
+
+    if (out != stdout)
+        fclose(out);
+    return 0;
+}
@@ -0,0 +1,262 @@
+#define _GNU_SOURCE
+#include "mailbox.h"
+#include "transport.h"
+#include "stats.h"
+#include <errno.h>
+
+/*
+    ipcstat: 掛上 sender / receiver 發佈的 stats 區段 (見 stats.h)，每隔一段時間印一次速率
+    只讀共享區段，不會碰 mailbox 本身，也不會拖慢 sender / receiver
+    每一次印一列 sender、一列 receiver (同一個角色的 process / lane 加在一起)：
+        procs       幾個 slot 有人 (stripe 的每條 lane、priority 的每個 class 各算一個)
+        msgs/s MB/s 這段時間的速率 (FRAME_REF / FRAME_ARENA 算內容的長度)
+        batch       平均一個 batch 幾則 (sender: 一次 flush；receiver: 一次 recv_batch())
+        wait% xfer% 等對方 / 搬資料的時間佔這段時間的比例 (每個 slot 平均)，還沒等完的那一次也算進去
+        wait p50/p99  一次等待多久 (2 的次方分桶，印的是 bucket 的上限)
+        hold p50/p99  sender：batch 的第一則放進去到交出去多久 (抽樣)
+    再一列 in flight：sender 放進去、receiver 還沒收到的訊息數，以及從 wait% 判斷瓶頸在哪一邊
+    區段不存在時先等；sender / receiver 重新啟動建了新的區段時自動重新掛上 (-n 的次數照算)
+*/
+
+#define ROLES 2
+
+//一個 slot 某個時間點的值
+typedef struct {
+    int32_t pid;
+    int32_t role;
+    int32_t mode;
+    uint64_t msgs, bytes, batches, waits, wait_ns, xfer_ns;
+    uint64_t waiting;   // 正在等的這一次到現在等了多久
+    uint64_t wait_hist[STATS_BUCKETS];
+    uint64_t hold_hist[STATS_BUCKETS];
+} snap_t;
+
+//同一個角色這段時間加起來
+typedef struct {
+    int procs;
+    uint64_t msgs, bytes, batches, waits, wait_ns, xfer_ns;
+    uint64_t wait_hist[STATS_BUCKETS];
+    uint64_t hold_hist[STATS_BUCKETS];
+    uint64_t total;     // 從開始到現在的 msgs (算 in flight)
+    uint64_t min_total; // receiver 裡最少的 (SHM_BCAST 每個 receiver 都收全部)
+} role_sum_t;
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-C channel] [-i interval_ms] [-n count]\n", prog);
+    exit(1);
+}
+
+static void take_snapshot(const stats_t *stats, snap_t *snap)
+{
+    uint64_t now = stats_now();
+    for (int i = 0; i < STATS_SLOTS; i++)
+    {
+        const stats_slot_t *slot = &stats->slot[i];
+        snap_t *s = &snap[i];
+        //被 kill 掉、沒有 stats_leave() 的 process 不算
+        s->pid = stats_alive(slot) ? atomic_load_explicit(&slot->pid, memory_order_acquire) : 0;
+        s->role = slot->role;
+        s->mode = slot->mode;
+        s->msgs = atomic_load_explicit(&slot->msgs, memory_order_relaxed);
+        s->bytes = atomic_load_explicit(&slot->bytes, memory_order_relaxed);
+        s->batches = atomic_load_explicit(&slot->batches, memory_order_relaxed);
+        s->waits = atomic_load_explicit(&slot->waits, memory_order_relaxed);
+        s->wait_ns = atomic_load_explicit(&slot->wait_ns, memory_order_relaxed);
+        s->xfer_ns = atomic_load_explicit(&slot->xfer_ns, memory_order_relaxed);
+        uint64_t since = atomic_load_explicit(&slot->wait_since, memory_order_relaxed);
+        s->waiting = since && since < now ? now - since : 0;
+        for (int b = 0; b < STATS_BUCKETS; b++)
+        {
+            s->wait_hist[b] = atomic_load_explicit(&slot->wait_hist[b], memory_order_relaxed);
+            s->hold_hist[b] = atomic_load_explicit(&slot->hold_hist[b], memory_order_relaxed);
+        }
+    }
+}
+
+//計數器只會變大；slot 換了主人 (或剛歸零) 時從 0 算
+static uint64_t delta(uint64_t cur, uint64_t prev)
+{
+    return cur >= prev ? cur - prev : cur;
+}
+
+static void sum_roles(const snap_t *cur, const snap_t *prev, role_sum_t *sum, int *mode)
+{
+    memset(sum, 0, sizeof(role_sum_t) * ROLES);
+    for (int r = 0; r < ROLES; r++)
+        sum[r].min_total = UINT64_MAX;
+    for (int i = 0; i < STATS_SLOTS; i++)
+    {
+        const snap_t *c = &cur[i];
+        if (c->pid == 0 || c->role < 0 || c->role >= ROLES)
+            continue;
+        static const snap_t zero;
+        const snap_t *p = prev[i].pid == c->pid ? &prev[i] : &zero;
+        role_sum_t *s = &sum[c->role];
+        s->procs++;
+        s->msgs += delta(c->msgs, p->msgs);
+        s->bytes += delta(c->bytes, p->bytes);
+        s->batches += delta(c->batches, p->batches);
+        s->waits += delta(c->waits, p->waits);
+        //等完的 + 正在等的：一次很長的等待分散到每一段時間，不會等結束時才一次出現
+        uint64_t waited = c->wait_ns + c->waiting, before = p->wait_ns + p->waiting;
+        s->wait_ns += waited > before ? waited - before : 0;
+        s->xfer_ns += delta(c->xfer_ns, p->xfer_ns);
+        for (int b = 0; b < STATS_BUCKETS; b++)
+        {
+            s->wait_hist[b] += delta(c->wait_hist[b], p->wait_hist[b]);
+            s->hold_hist[b] += delta(c->hold_hist[b], p->hold_hist[b]);
+        }
+        s->total += c->msgs;
+        if (c->msgs < s->min_total)
+            s->min_total = c->msgs;
+        *mode = c->mode;
+    }
+}
+
+//第 pct 百分位落在哪個 bucket，回傳 bucket 的上限 (ns)；沒有樣本回傳 0
+static uint64_t hist_pct(const uint64_t *hist, double pct)
+{
+    uint64_t n = 0, seen = 0;
+    for (int b = 0; b < STATS_BUCKETS; b++)
+        n += hist[b];
+    if (n == 0)
+        return 0;
+    for (int b = 0; b < STATS_BUCKETS; b++)
+    {
+        seen += hist[b];
+        if ((double)seen >= pct / 100.0 * (double)n)
+            return 2ull << b;
+    }
+    return 2ull << (STATS_BUCKETS - 1);
+}
+
+static const char *fmt_ns(uint64_t ns, char *buf, size_t size)
+{
+    if (ns == 0)
+        snprintf(buf, size, "-");
+    else if (ns < 1000)
+        snprintf(buf, size, "%lluns", (unsigned long long)ns);
+    else if (ns < 1000000)
+        snprintf(buf, size, "%.1fus", ns / 1e3);
+    else if (ns < 1000000000)
+        snprintf(buf, size, "%.1fms", ns / 1e6);
+    else
+        snprintf(buf, size, "%.1fs", ns / 1e9);
+    return buf;
+}
+
+//等待 / 搬資料的時間佔 elapsed 的幾 %，多個 slot 取平均
+static double share(uint64_t ns, int procs, uint64_t elapsed)
+{
+    return procs ? 100.0 * (double)ns / ((double)elapsed * procs) : 0;
+}
+
+static void print_role(double t, const char *name, const role_sum_t *s, uint64_t elapsed)
+{
+    char w50[16], w99[16], h50[16], h99[16];
+    double sec = elapsed / 1e9;
+    printf("%7.1f  %-8s %5d %11.0f %9.2f %7.1f %6.0f %6.0f %9s %9s %9s %9s\n", t, name, s->procs, s->msgs / sec,
+           s->bytes / sec / 1e6, s->batches ? (double)s->msgs / s->batches : 0, share(s->wait_ns, s->procs, elapsed),
+           share(s->xfer_ns, s->procs, elapsed), fmt_ns(hist_pct(s->wait_hist, 50), w50, sizeof(w50)),
+           fmt_ns(hist_pct(s->wait_hist, 99), w99, sizeof(w99)), fmt_ns(hist_pct(s->hold_hist, 50), h50, sizeof(h50)),
+           fmt_ns(hist_pct(s->hold_hist, 99), h99, sizeof(h99)));
+}
+
+//一邊大部分時間在等、另一邊幾乎不等：不等的那一邊就是瓶頸
+static const char *bottleneck(const role_sum_t *sum, uint64_t elapsed)
+{
+    double sw = share(sum[MAILBOX_SENDER].wait_ns, sum[MAILBOX_SENDER].procs, elapsed);
+    double rw = share(sum[MAILBOX_RECEIVER].wait_ns, sum[MAILBOX_RECEIVER].procs, elapsed);
+    if (sum[MAILBOX_SENDER].procs == 0 || sum[MAILBOX_RECEIVER].procs == 0)
+        return "";
+    if (sum[MAILBOX_SENDER].msgs == 0 && sum[MAILBOX_RECEIVER].msgs == 0)
+        return "idle";
+    if (sw > 50 && rw < 20)
+        return "receiver is the bottleneck";
+    if (rw > 50 && sw < 20)
+        return "sender is the bottleneck";
+    if (sw > 50 && rw > 50)
+        return "hand-off is the bottleneck (both sides wait)";
+    return "";
+}
+
+int main(int argc, char *argv[])
+{
+    mailbox_t mailbox = {.key_path = "."};
+    int interval_ms = 1000;
+    long count = 0;
+    int opt;
+    //-C: 看第幾個 channel (和 sender 的 -C 一樣)
+    //-i: 多久印一次 (毫秒，預設 1000)
+    //-n: 印幾次就結束 (預設 0 = 一直印)
+    while ((opt = getopt(argc, argv, "C:i:n:")) != -1)
+    {
+        if (opt == 'C' && atoi(optarg) >= 0 && atoi(optarg) <= 65535)
+            mailbox.channel = atoi(optarg);
+        else if (opt == 'i' && atoi(optarg) > 0)
+            interval_ms = atoi(optarg);
+        else if (opt == 'n' && atol(optarg) >= 0)
+            count = atol(optarg);
+        else
+            usage(argv[0]);
+    }
+    //和 mailbox_open() 算的是同一個 key (lane 0、同一個 channel)
+    key_t key = mailbox_key(&mailbox, STATS_PROJ_ID);
+    static snap_t prev[STATS_SLOTS], cur[STATS_SLOTS];
+    stats_t *stats = NULL;
+    int shmid = -1, told = 0;
+    uint64_t start = stats_now(), last = start;
+    for (long tick = 0; count == 0 || tick < count; tick++)
+    {
+        if (tick > 0)
+            usleep((useconds_t)interval_ms * 1000);
+        //sender / receiver 都離開時區段會被移除，之後再啟動的會建立新的區段
+        if (stats && shmget(key, 0, 0666) != shmid)
+        {
+            shmdt(stats);
+            stats = NULL;
+        }
+        if (stats == NULL)
+        {
+            if ((stats = stats_attach(key, &shmid)) == NULL)
+            {
+                if (!told)
+                    printf("Waiting for a sender or receiver (key 0x%08x)...\n", (unsigned)key);
+                fflush(stdout);
+                told = 1;
+                continue;
+            }
+            told = 0;
+            take_snapshot(stats, prev);
+            last = stats_now();
+            printf("%7s  %-8s %5s %11s %9s %7s %6s %6s %9s %9s %9s %9s\n", "time", "role", "procs", "msgs/s", "MB/s",
+                   "batch", "wait%", "xfer%", "wait_p50", "wait_p99", "hold_p50", "hold_p99");
+            continue;
+        }
+        take_snapshot(stats, cur);
+        uint64_t now = stats_now();
+        uint64_t elapsed = now - last;
+        double t = (now - start) / 1e9;
+        role_sum_t sum[ROLES];
+        int mode = 0;
+        sum_roles(cur, prev, sum, &mode);
+        print_role(t, "sender", &sum[MAILBOX_SENDER], elapsed);
+        print_role(t, "receiver", &sum[MAILBOX_RECEIVER], elapsed);
+
+        //SHM_BCAST 每個 receiver 都收全部，看最慢的那個；其他模式 receiver 分攤
+        uint64_t received = mode == SHM_BCAST ? sum[MAILBOX_RECEIVER].min_total : sum[MAILBOX_RECEIVER].total;
+        if (sum[MAILBOX_RECEIVER].procs == 0)
+            received = 0;
+        uint64_t sent = sum[MAILBOX_SENDER].total;
+        const char *hint = bottleneck(sum, elapsed);
+        printf("%7.1f  in flight %llu msgs%s%s\n", t, (unsigned long long)(sent > received ? sent - received : 0),
+               *hint ? "; " : "", hint);
+        fflush(stdout);
+        memcpy(prev, cur, sizeof(prev));
+        last = now;
+    }
+    if (stats)
+        shmdt(stats);
+    return 0;
+}
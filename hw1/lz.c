@@ -0,0 +1,195 @@
+#include "lz.h"
+#include <stdint.h>
+#include <string.h>
+
+#define LZ_HASH_BITS 12
+#define LZ_MAX_OFFSET 65535
+#define LZ_LAST_LITERALS 5 // 最後幾個 byte 一定當 literal 送：比較 match 時一次讀 8 byte 不會讀超過輸入
+#define LZ_MF_LIMIT 12     // 離結尾這麼近就不再找新的 match
+#define LZ_SKIP_SHIFT 5    // 連續 2^5 個位置找不到 match，每次就多跳一個 byte
+
+static uint32_t read32(const unsigned char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static uint64_t read64(const unsigned char *p)
+{
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static uint32_t lz_hash(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// p 和 r 開始有幾個 byte 一樣 (r 在 p 前面)，p 最多比到 limit；一次比 8 byte，第一個不一樣的 byte 用 ctz 找
+static size_t match_len(const unsigned char *p, const unsigned char *r, const unsigned char *limit)
+{
+    const unsigned char *start = p;
+    while (p + 8 <= limit)
+    {
+        uint64_t diff = read64(p) ^ read64(r);
+        if (diff)
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            return (size_t)(p - start) + (__builtin_ctzll(diff) >> 3);
+#else
+            return (size_t)(p - start) + (__builtin_clzll(diff) >> 3);
+#endif
+        p += 8;
+        r += 8;
+    }
+    while (p < limit && *p == *r)
+        p++, r++;
+    return (size_t)(p - start);
+}
+
+// 長度超過 token 的 15 的部分：每個 byte 加 0 ~ 255，255 表示後面還有；放不下回傳 NULL
+static unsigned char *put_len(unsigned char *op, unsigned char *oend, size_t len)
+{
+    for (; len >= 255; len -= 255)
+    {
+        if (op >= oend)
+            return NULL;
+        *op++ = 255;
+    }
+    if (op >= oend)
+        return NULL;
+    *op++ = (unsigned char)len;
+    return op;
+}
+
+// 寫一個 sequence：nlit 個 literal，再接 offset / mlen 的 match；mlen = 0 是最後一個 (只有 literal)
+static unsigned char *put_seq(unsigned char *op, unsigned char *oend, const unsigned char *lit, size_t nlit,
+                              size_t off, size_t mlen)
+{
+    size_t ml = mlen ? mlen - LZ_MIN_MATCH : 0;
+    if (op >= oend)
+        return NULL;
+    *op++ = (unsigned char)(((nlit < 15 ? nlit : 15) << 4) | (ml < 15 ? ml : 15));
+    if (nlit >= 15 && (op = put_len(op, oend, nlit - 15)) == NULL)
+        return NULL;
+    if ((size_t)(oend - op) < nlit)
+        return NULL;
+    memcpy(op, lit, nlit);
+    op += nlit;
+    if (mlen == 0)
+        return op;
+    if (oend - op < 2)
+        return NULL;
+    op[0] = (unsigned char)(off & 0xff);
+    op[1] = (unsigned char)(off >> 8);
+    op += 2;
+    if (ml >= 15 && (op = put_len(op, oend, ml - 15)) == NULL)
+        return NULL;
+    return op;
+}
+
+size_t lz_compress(const char *src, size_t n, char *dst, size_t cap)
+{
+    const unsigned char *base = (const unsigned char *)src;
+    const unsigned char *ip = base, *anchor = base, *end = base + n;
+    unsigned char *op = (unsigned char *)dst, *oend = op + cap;
+
+    if (n >= LZ_MF_LIMIT)
+    {
+        //table 裡是位置 (從 base 算)；一開始全部是 0，指到的內容不一樣時下面的比較會擋掉
+        uint32_t table[1 << LZ_HASH_BITS] = {0};
+        const unsigned char *mflimit = end - LZ_MF_LIMIT;
+        const unsigned char *mlimit = end - LZ_LAST_LITERALS;
+        unsigned miss = 0;
+        while (ip <= mflimit)
+        {
+            uint32_t seq = read32(ip);
+            uint32_t h = lz_hash(seq);
+            const unsigned char *ref = base + table[h];
+            table[h] = (uint32_t)(ip - base);
+            if (ref >= ip || ip - ref > LZ_MAX_OFFSET || read32(ref) != seq)
+            {
+                ip += 1 + (miss++ >> LZ_SKIP_SHIFT);
+                continue;
+            }
+            miss = 0;
+            //match 往前延伸到上一個 sequence 結束的地方
+            while (ip > anchor && ref > base && ip[-1] == ref[-1])
+                ip--, ref--;
+            size_t mlen = LZ_MIN_MATCH + match_len(ip + LZ_MIN_MATCH, ref + LZ_MIN_MATCH, mlimit);
+            if ((op = put_seq(op, oend, anchor, (size_t)(ip - anchor), (size_t)(ip - ref), mlen)) == NULL)
+                return 0;
+            ip += mlen;
+            anchor = ip;
+            //match 結尾附近也放進 table，下一個重複的片段比較容易接上
+            if (ip <= mflimit)
+                table[lz_hash(read32(ip - 2))] = (uint32_t)(ip - 2 - base);
+        }
+    }
+    if ((op = put_seq(op, oend, anchor, (size_t)(end - anchor), 0, 0)) == NULL)
+        return 0;
+    return (size_t)(op - (unsigned char *)dst);
+}
+
+// 讀 token 之後的延伸長度 byte，加到 *len；輸入不夠回傳 -1
+static int get_len(const unsigned char **ip, const unsigned char *iend, size_t *len)
+{
+    unsigned b;
+    do
+    {
+        if (*ip >= iend)
+            return -1;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return 0;
+}
+
+size_t lz_decompress(const char *src, size_t n, char *dst, size_t cap)
+{
+    const unsigned char *ip = (const unsigned char *)src, *iend = ip + n;
+    unsigned char *obase = (unsigned char *)dst, *op = obase, *oend = obase + cap;
+    for (;;)
+    {
+        if (ip >= iend)
+            return (size_t)-1;
+        unsigned token = *ip++;
+        size_t nlit = token >> 4;
+        if (nlit == 15 && get_len(&ip, iend, &nlit) == -1)
+            return (size_t)-1;
+        if ((size_t)(iend - ip) < nlit || (size_t)(oend - op) < nlit)
+            return (size_t)-1;
+        memcpy(op, ip, nlit);
+        ip += nlit;
+        op += nlit;
+        if (ip == iend)
+            return (size_t)(op - obase);
+
+        if (iend - ip < 2)
+            return (size_t)-1;
+        size_t off = (size_t)ip[0] | (size_t)ip[1] << 8;
+        ip += 2;
+        size_t mlen = token & 15;
+        if (mlen == 15 && get_len(&ip, iend, &mlen) == -1)
+            return (size_t)-1;
+        mlen += LZ_MIN_MATCH;
+        if (off == 0 || off > (size_t)(op - obase) || (size_t)(oend - op) < mlen)
+            return (size_t)-1;
+        //match 可以和自己重疊 (off < mlen 是週期 off 的 pattern)：一次搬 8 byte 要從至少 8 byte 前讀，
+        //off < 8 時改從 off 的倍數 dist (>= 8) 前讀，內容一樣；開頭 dist - off byte 還讀不到，先一個一個搬
+        const unsigned char *r = op - off;
+        size_t i = 0, dist = off;
+        if (off < 8)
+        {
+            dist = off * ((8 + off - 1) / off);
+            for (; i < dist - off && i < mlen; i++)
+                op[i] = r[i];
+        }
+        for (; i + 8 <= mlen; i += 8)
+            memcpy(op + i, op + i - dist, 8);
+        for (; i < mlen; i++)
+            op[i] = r[i];
+        op += mlen;
+    }
+}
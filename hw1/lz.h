@@ -0,0 +1,26 @@
+#ifndef LZ_H
+#define LZ_H
+
+#include <stddef.h>
+
+/*
+    很小的 LZ77 codec (和 LZ4 的 block 格式同一類)：壓縮 transfer 型 backend 的整個 batch (見 FRAME_LZ)
+    輸出是一串 sequence：
+        token (1 byte)：高 4 bit 是 literal 長度，低 4 bit 是 match 長度 - LZ_MIN_MATCH；15 = 後面還有長度 byte
+        [literal 長度的延伸 byte，每個 +0 ~ 255，遇到不是 255 的就停]
+        literal
+        offset (2 byte little endian，往回多少 byte，1 ~ 65535)
+        [match 長度的延伸 byte]
+    最後一個 sequence 只有 literal (輸入讀完就結束，沒有 offset)
+    找 match 用一張 4096 格的 hash table (4 byte 算一個 hash，只記最近一次出現的位置)，
+    一直找不到 match 時越跳越快，不壓縮的資料 (已經壓過的、亂數) 只花很少時間
+    文字類的輸入 (例如 input.txt) 大約壓到 1/3 ~ 1/5，壓縮大約 0.5 ~ 1 GB/s、解壓 2 GB/s 以上
+*/
+#define LZ_MIN_MATCH 4
+
+// 壓縮 src[0, n) 到 dst，最多寫 cap byte：回傳壓縮後的長度，放不下 cap 回傳 0
+size_t lz_compress(const char *src, size_t n, char *dst, size_t cap);
+// 解壓縮到 dst，最多寫 cap byte：回傳解壓縮後的長度，資料壞掉 (超出範圍) 回傳 (size_t)-1
+size_t lz_decompress(const char *src, size_t n, char *dst, size_t cap);
+
+#endif
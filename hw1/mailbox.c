@@ -0,0 +1,1051 @@
+#define _GNU_SOURCE
+#include "mailbox.h"
+#include "transport.h"
+#include "copy.h"
+#include "arena.h"
+#include "crc32c.h"
+#include "lz.h"
+#include "stats.h"
+#include <errno.h>
+#include <limits.h>
+#include <sys/mman.h>
+
+//mode 編號 -> transport；新增 backend 只要在這裡登記
+static const transport_t *transports[MAILBOX_MODES] = {
+    [MSG_PASSING] = &msgq_transport,
+    [SHARED_MEM] = &shm_transport,
+    [SHM_RING] = &ring_transport,
+    [FIFO_PIPE] = &fifo_transport,
+#ifdef __linux__
+    [UNIX_SOCKET] = &unix_transport,
+    [POSIX_MQ] = &mq_transport,
+    [SHM_EVENTFD] = &efd_transport,
+#endif
+    [SHM_MPMC] = &mpmc_transport,
+    [SHM_BCAST] = &bcast_transport,
+};
+
+static const transport_t *transport_of(int mode)
+{
+    if (mode <= 0 || mode >= MAILBOX_MODES)
+        return NULL;
+    return transports[mode];
+}
+
+const char *mailbox_mode_name(int mode)
+{
+    const transport_t *ops = transport_of(mode);
+    return ops ? ops->name : NULL;
+}
+
+// 建立IPC 共用Key 讓 receiver and sencer 都可以找到同一個message queue 或shared memory 
+// ftok: File to Key ：他會根據「檔案路徑+ 一個編號」產生一個獨一無二的key
+key_t mailbox_key(const mailbox_t *mailbox_ptr, int proj_id)
+{
+    key_t key = ftok(mailbox_ptr->key_path, proj_id);
+    if (key == -1)
+    {
+        perror("ftok failed");
+        exit(1);
+    }
+    //stripe 的每條 lane 是各自的 IPC：把 lane 混進 key 的第 16~23 bit (ftok 放裝置編號的那個 byte)
+    //channel 混進第 0~15 bit (inode 編號的那兩個 byte)
+    return key ^ ((key_t)mailbox_ptr->lane << 16) ^ (key_t)(mailbox_ptr->channel & 0xffff);
+}
+
+//FIFO / socket / mq 這些用名字找的 IPC，名字由 key 產生，和 ftok() 一樣只看 key_path
+void mailbox_path(const mailbox_t *mailbox_ptr, const char *prefix, const char *suffix, char *buf, size_t size)
+{
+    snprintf(buf, size, "%s%08x%s", prefix, (unsigned)mailbox_key(mailbox_ptr, MAILBOX_PROJ_ID), suffix);
+}
+
+void mailbox_add_time(mailbox_t *mailbox_ptr, const struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    mailbox_ptr->total_time += (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+    if (mailbox_ptr->stat)
+    {
+        //計時的這段裡面等對方的時間 (例如 ring 滿了等空間) 已經算在 wait，xfer 不重複算
+        uint64_t ns = (uint64_t)((end.tv_sec - start->tv_sec) * 1000000000LL + (end.tv_nsec - start->tv_nsec));
+        uint64_t from = (uint64_t)start->tv_sec * 1000000000ull + (uint64_t)start->tv_nsec;
+        spin_t *spin = &mailbox_ptr->spin;
+        if (spin->waited && spin->waited_from >= from)
+            ns -= spin->waited < ns ? spin->waited : ns;
+        spin->waited = 0;
+        stats_add(&mailbox_ptr->stat->xfer_ns, ns);
+    }
+}
+
+/*
+    建立 (sender) 或連上 (receiver) mode 對應的 IPC，細節在各個 transport 的 open()
+    呼叫前 batch / spin 等設定要先填好，這裡不會清掉
+    lanes > 1 時另外開 lane 1 .. lanes - 1，設定和自己一樣 (見 stripe.h)；兩邊的 lanes 要一樣
+    prio 時 (MSG_PASSING 以外) 再開 control / urgent 各一個 mailbox
+    doorbell 時 transport 沒有自己的 fd 的話，再和對方交換一個 eventfd doorbell (見 transport.h)
+    sender 的 arena_bytes > 0 時建立 arena (receiver 等收到 FRAME_ARENA 才掛載)
+    telemetry 時掛載 stats 區段並佔一個 slot (見 stats.h)；lane / class mailbox 用同一個區段，各佔一個 slot
+    mode 不合法時回傳 -1
+*/
+int mailbox_open(mailbox_t *mailbox_ptr, int mode, int role, const char *key_path)
+{
+    const transport_t *ops = transport_of(mode);
+    if (ops == NULL)
+        return -1;
+    mailbox_t config = *mailbox_ptr; // open 之前只有呼叫端填的設定
+    mailbox_ptr->flag = mode;
+    mailbox_ptr->ops = ops;
+    mailbox_ptr->role = role;
+    mailbox_ptr->key_path = key_path;
+    //先 pin 住再建立共享區段：page 第一次被碰到時，會配在這個 CPU 所在的 node (沒有指定 node 的話)
+    place_pin(&mailbox_ptr->place);
+    ops->open(mailbox_ptr);
+    if (mailbox_ptr->doorbell && ops->poll_fd == NULL)
+        doorbell_open(mailbox_ptr);
+    if (role == MAILBOX_SENDER && mailbox_ptr->arena_bytes)
+        mailbox_ptr->arena = arena_create(mailbox_key(mailbox_ptr, ARENA_PROJ_ID), mailbox_ptr->arena_bytes,
+                                          &mailbox_ptr->place);
+    if (mailbox_ptr->telemetry)
+    {
+        if (mailbox_ptr->stats == NULL)
+            mailbox_ptr->stats = stats_join(mailbox_key(mailbox_ptr, STATS_PROJ_ID));
+        mailbox_ptr->stat = stats_claim(mailbox_ptr->stats, role, mode, mailbox_ptr->lane);
+        mailbox_ptr->spin.stats = mailbox_ptr->stat;
+    }
+
+    //支援多個 sender / receiver 的 transport 會在 open() 裡填 peers，在共享區段裡登記自己
+    if (mailbox_ptr->peers)
+    {
+        mailbox_ptr->peer_slot = peers_join(mailbox_ptr->peers, role == MAILBOX_RECEIVER, mailbox_ptr->route,
+                                            !mailbox_ptr->no_compress);
+        if (mailbox_ptr->peer_slot == -1)
+        {
+            fprintf(stderr, "Too many receivers (max %d)\n", PEERS_MAX);
+            exit(1);
+        }
+    }
+
+    //每條 lane 照順序開：FIFO / socket 的 open 要等另一端開同一條才會回來
+    if (mailbox_ptr->lanes > 1)
+    {
+        mailbox_ptr->lane_box = calloc((size_t)mailbox_ptr->lanes - 1, sizeof(mailbox_t));
+        if (mailbox_ptr->lane_box == NULL)
+        {
+            perror("calloc failed");
+            exit(1);
+        }
+        for (int i = 1; i < mailbox_ptr->lanes; i++)
+        {
+            mailbox_t *lane = mailbox_lane(mailbox_ptr, i);
+            *lane = config;
+            lane->lanes = 0;
+            lane->prio = 0;
+            lane->doorbell = 0;
+            lane->arena_bytes = 0;
+            lane->lane = i;
+            lane->stats = mailbox_ptr->stats;
+            lane->place.cpu = -1; // 已經 pin 過了
+            mailbox_open(lane, mode, role, key_path);
+        }
+    }
+
+    //MSG_PASSING 用 mType 區間分 class，不用另外開
+    if (mailbox_ptr->prio && mode != MSG_PASSING)
+    {
+        mailbox_ptr->prio_box = calloc(PRIO_BULK, sizeof(mailbox_t));
+        if (mailbox_ptr->prio_box == NULL)
+        {
+            perror("calloc failed");
+            exit(1);
+        }
+        for (int c = 0; c < PRIO_BULK; c++)
+        {
+            mailbox_t *box = &mailbox_ptr->prio_box[c];
+            *box = config;
+            box->lanes = 0;
+            box->prio = 0;
+            box->arena_bytes = 0;
+            box->doorbell = 0; // sender 送 urgent 時會在 bulk 補 FRAME_WAKE，bulk 的 doorbell 就會響
+            box->lane = PRIO_LANE + c;
+            box->stats = mailbox_ptr->stats;
+            box->batch_bytes = 0; // control / urgent 不等 batch
+            box->place.cpu = -1;
+            mailbox_open(box, mode, role, key_path);
+        }
+    }
+    return 0;
+}
+
+//sender: 只 detach；receiver: 最後離開的一方，負責把 IPC 都移除
+void mailbox_close(mailbox_t *mailbox_ptr)
+{
+    if (mailbox_ptr->lane_box)
+    {
+        for (int i = 1; i < mailbox_ptr->lanes; i++)
+            mailbox_close(mailbox_lane(mailbox_ptr, i));
+        free(mailbox_ptr->lane_box);
+        mailbox_ptr->lane_box = NULL;
+    }
+    if (mailbox_ptr->prio_box)
+    {
+        for (int c = 0; c < PRIO_BULK; c++)
+            mailbox_close(&mailbox_ptr->prio_box[c]);
+        free(mailbox_ptr->prio_box);
+        mailbox_ptr->prio_box = NULL;
+    }
+    if (mailbox_ptr->role == MAILBOX_SENDER && !mailbox_ptr->finished)
+    {
+        long key;
+        mailbox_finish(mailbox_ptr, &key, 1);
+    }
+    mailbox_ptr->last = 1;
+    if (mailbox_ptr->role == MAILBOX_RECEIVER && mailbox_ptr->peers)
+        mailbox_ptr->last = peers_leave_receiver(mailbox_ptr->peers, mailbox_ptr->peer_slot,
+                                                  !mailbox_ptr->no_compress) == 0;
+    if (mailbox_ptr->bell)
+        doorbell_close(mailbox_ptr);
+    mailbox_ptr->ops->close(mailbox_ptr);
+    //還有 block 沒還回來 (receiver 還沒收到或還沒處理完) 的 arena 要留給 receiver，由 receiver 移除
+    if (mailbox_ptr->arena)
+    {
+        int remove = mailbox_ptr->role == MAILBOX_RECEIVER ? mailbox_ptr->last : atomic_load(&mailbox_ptr->arena->live) == 0;
+        arena_detach(mailbox_ptr->arena);
+        if (remove)
+            arena_destroy(mailbox_key(mailbox_ptr, ARENA_PROJ_ID));
+        mailbox_ptr->arena = NULL;
+    }
+    if (mailbox_ptr->file_data)
+        munmap((void *)mailbox_ptr->file_data, mailbox_ptr->file_size);
+    free(mailbox_ptr->lz_buf);
+    mailbox_ptr->lz_buf = NULL;
+    //lane / class mailbox 只還 slot，區段由主 mailbox (lane 0) detach
+    if (mailbox_ptr->stat)
+        stats_leave(mailbox_ptr->stat);
+    if (mailbox_ptr->stats && mailbox_ptr->lane == 0)
+        stats_detach(mailbox_ptr->stats, mailbox_key(mailbox_ptr, STATS_PROJ_ID));
+    mailbox_ptr->stat = NULL;
+    mailbox_ptr->spin.stats = NULL;
+    mailbox_ptr->stats = NULL;
+}
+
+/*
+    sender 送完所有資料 (已經 flush) 之後呼叫：回傳要送 "exit" 的 routing key 放在 keys，回傳有幾個
+    最後一個送完的 sender 拿到每個登記過的 receiver 的 key (key 0 的 receiver 什麼都收，送到 mType 1 就好)；
+    其他 sender 回傳 0，不用送 exit。transport 沒有 peers (或還沒有 receiver 登記) 就是原本的一對一：送給自己的 route
+    exit 排在所有 sender 的資料後面，receiver 收到 exit 時自己那份工作一定已經收完
+*/
+int mailbox_finish(mailbox_t *mailbox_ptr, long *keys, int max)
+{
+    int n = 0;
+    mailbox_ptr->finished = 1;
+    if (mailbox_ptr->peers)
+        n = peers_finish_sender(mailbox_ptr->peers, keys, max);
+    if (n == -1)
+        return 0;
+    if (n == 0 && max > 0)
+        keys[n++] = mailbox_ptr->route;
+    for (int i = 0; i < n; i++)
+        if (keys[i] == 0)
+            keys[i] = 1;
+    return n;
+}
+
+/* ======================= transfer 型 backend 共用 ======================= */
+
+size_t xfer_max_payload(mailbox_t *mailbox_ptr)
+{
+    return mailbox_ptr->tx_cap - FRAME_HDR_SIZE;
+}
+
+/*
+    batch 壓縮 (compress_min > 0)：每個 batch 開始時看 receiver 是不是都接受 (peers_lz_ok()，沒有 peers 的 transport 一定接受)
+    接受的話 frame 先組在本地的 lz_buf，最多 lz_span 個 tx_cap；flush 時到了 compress_min 就整個壓縮，
+    直接壓進 tx_begin() 給的 transfer，變成唯一的一個 FRAME_LZ frame：原本要好幾次 msgsnd() 的 frame 一次送完
+    壓不進一個 transfer (或沒有變小) 就把原本的 frame 照順序分成幾個 transfer 送，和沒有壓縮一樣
+    lz_span 從 LZ_SPAN_START 開始：壓完不到半個 transfer 就加一，壓不進去就減一 (1 ~ LZ_SPAN_MAX)
+*/
+#define LZ_SPAN_START 2
+#define LZ_SPAN_MAX 8
+
+//lz_buf 至少要有 len byte
+static void lz_reserve(mailbox_t *mailbox_ptr, size_t len)
+{
+    if (mailbox_ptr->lz_cap >= len)
+        return;
+    free(mailbox_ptr->lz_buf);
+    mailbox_ptr->lz_buf = malloc(len);
+    if (mailbox_ptr->lz_buf == NULL)
+    {
+        perror("malloc failed");
+        exit(1);
+    }
+    mailbox_ptr->lz_cap = len;
+}
+
+//新的 batch 要不要先組在 lz_buf
+static int lz_wanted(mailbox_t *mailbox_ptr)
+{
+    if (mailbox_ptr->compress_min == 0)
+        return 0;
+    if (mailbox_ptr->peers && !peers_lz_ok(mailbox_ptr->peers))
+        return 0;
+    if (mailbox_ptr->lz_span == 0)
+        mailbox_ptr->lz_span = LZ_SPAN_START;
+    lz_reserve(mailbox_ptr, LZ_SPAN_MAX * mailbox_ptr->tx_cap);
+    return 1;
+}
+
+//目前的 batch 最多放幾個 byte
+static size_t xfer_batch_cap(const mailbox_t *mailbox_ptr)
+{
+    return mailbox_ptr->tx_lz ? (size_t)mailbox_ptr->lz_span * mailbox_ptr->tx_cap : mailbox_ptr->tx_cap;
+}
+
+//把一個 frame 放進目前的 batch：[frame_hdr_t][payload]，只複製 len 個 byte
+//batch 放不下 (或 mType 不同) 就先把目前的 batch 送出去
+void xfer_put(mailbox_t *mailbox_ptr, long mType, uint32_t flags, const char *data, size_t len)
+{
+    if (mailbox_ptr->tx_len > 0 &&
+        (mailbox_ptr->tx_len + frame_size(len) > xfer_batch_cap(mailbox_ptr) || mType != mailbox_ptr->tx_mType))
+        mailbox_flush(mailbox_ptr);
+    if (mailbox_ptr->tx_len == 0)
+    {
+        //開始一個新的 batch
+        mailbox_ptr->tx_mType = mType;
+        mailbox_ptr->tx_lz = lz_wanted(mailbox_ptr);
+        mailbox_ptr->tx_data = mailbox_ptr->tx_lz ? mailbox_ptr->lz_buf : mailbox_ptr->ops->tx_begin(mailbox_ptr);
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    frame_hdr_t *hdr = (frame_hdr_t *)(mailbox_ptr->tx_data + mailbox_ptr->tx_len);
+    hdr->len = (uint32_t)len;
+    hdr->flags = flags;
+    //長度由 header 決定 (不再用 strcpy 找 '\0')；依照長度選 copy kernel (見 copy.h)，lz_buf 是本地的不用 stream
+    copy_to_shared(frame_payload(hdr), data, len, mailbox_ptr->tx_lz ? 0 : mailbox_ptr->tx_nt_min);
+    mailbox_add_time(mailbox_ptr, &start);
+}
+
+//lz_buf 裡的 batch 壓縮成一個 FRAME_LZ 寫進 dst (tx_begin() 給的)：回傳 transfer 的長度，壓不進去或沒有變小回傳 0
+static size_t lz_pack(mailbox_t *mailbox_ptr, char *dst)
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t raw = mailbox_ptr->tx_len;
+    frame_hdr_t *hdr = (frame_hdr_t *)dst;
+    size_t n = lz_compress(mailbox_ptr->lz_buf, raw, frame_payload(hdr) + FRAME_LZ_SIZE,
+                           mailbox_ptr->tx_cap - FRAME_HDR_SIZE - FRAME_LZ_SIZE);
+    mailbox_add_time(mailbox_ptr, &start);
+    if (n == 0 || frame_size(FRAME_LZ_SIZE + n) >= raw)
+    {
+        if (mailbox_ptr->lz_span > 1)
+            mailbox_ptr->lz_span--;
+        return 0;
+    }
+    if (frame_size(FRAME_LZ_SIZE + n) < mailbox_ptr->tx_cap / 2 && mailbox_ptr->lz_span < LZ_SPAN_MAX)
+        mailbox_ptr->lz_span++;
+    uint64_t len = raw;
+    memcpy(frame_payload(hdr), &len, sizeof(len));
+    hdr->len = (uint32_t)(FRAME_LZ_SIZE + n);
+    hdr->flags = FRAME_LZ;
+    return frame_size(hdr->len);
+}
+
+//沒有壓縮的 lz_buf：frame 照順序塞滿一個一個 transfer；第一個 transfer 可能已經 tx_begin() 過了 (dst)
+//只有 CRC 的 frame (FRAME_CRC | FRAME_MORE) 放得下的話和下一個 frame 放在同一個 transfer (見 batch_checksum())
+static void lz_send_raw(mailbox_t *mailbox_ptr, char *dst)
+{
+    const char *raw = mailbox_ptr->lz_buf;
+    size_t len = mailbox_ptr->tx_len, off = 0, cap = mailbox_ptr->tx_cap;
+    while (off < len)
+    {
+        size_t end = off;
+        while (end < len)
+        {
+            const frame_hdr_t *hdr = (const frame_hdr_t *)(raw + end);
+            size_t step = frame_size(hdr->len);
+            if ((hdr->flags & FRAME_CRC) && (hdr->flags & FRAME_MORE) && end + step < len)
+            {
+                size_t pair = step + frame_size(((const frame_hdr_t *)(raw + end + step))->len);
+                if (pair <= cap)
+                    step = pair;
+            }
+            if (end + step - off > cap)
+                break;
+            end += step;
+        }
+        if (dst == NULL)
+            dst = mailbox_ptr->ops->tx_begin(mailbox_ptr);
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        copy_to_shared(dst, raw + off, end - off, mailbox_ptr->tx_nt_min);
+        mailbox_add_time(mailbox_ptr, &start);
+        mailbox_ptr->tx_data = dst;
+        mailbox_ptr->tx_len = end - off;
+        mailbox_ptr->ops->tx_end(mailbox_ptr);
+        dst = NULL;
+        off = end;
+    }
+}
+
+void xfer_flush(mailbox_t *mailbox_ptr)
+{
+    if (!mailbox_ptr->tx_lz)
+    {
+        mailbox_ptr->ops->tx_end(mailbox_ptr);
+        return;
+    }
+    char *dst = NULL;
+    if (mailbox_ptr->tx_len >= mailbox_ptr->compress_min)
+    {
+        dst = mailbox_ptr->ops->tx_begin(mailbox_ptr);
+        size_t n = lz_pack(mailbox_ptr, dst);
+        if (n)
+        {
+            mailbox_ptr->tx_data = dst;
+            mailbox_ptr->tx_len = n;
+            mailbox_ptr->ops->tx_end(mailbox_ptr);
+            return;
+        }
+    }
+    lz_send_raw(mailbox_ptr, dst);
+}
+
+//收到 FRAME_LZ：解壓縮到 lz_buf，transfer 本身馬上還給 backend (sender 可以開始用)，之後從 lz_buf 一個一個讀
+static void lz_unpack(mailbox_t *mailbox_ptr, frame_hdr_t *hdr)
+{
+    uint64_t raw = 0;
+    if (hdr->len >= FRAME_LZ_SIZE)
+        memcpy(&raw, frame_payload(hdr), sizeof(raw));
+    if (hdr->len < FRAME_LZ_SIZE || raw > LZ_SPAN_MAX * (uint64_t)mailbox_ptr->tx_cap)
+    {
+        fprintf(stderr, "Corrupt compressed batch header (%u bytes, %llu uncompressed)\n", hdr->len,
+                (unsigned long long)raw);
+        exit(1);
+    }
+    lz_reserve(mailbox_ptr, (size_t)raw);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t n = lz_decompress(frame_payload(hdr) + FRAME_LZ_SIZE, hdr->len - FRAME_LZ_SIZE, mailbox_ptr->lz_buf,
+                             (size_t)raw);
+    mailbox_add_time(mailbox_ptr, &start);
+    if (n != raw)
+    {
+        fprintf(stderr, "Corrupt compressed batch (%u bytes, %llu uncompressed)\n", hdr->len, (unsigned long long)raw);
+        exit(1);
+    }
+    if (mailbox_ptr->ops->rx_end)
+        mailbox_ptr->ops->rx_end(mailbox_ptr);
+    mailbox_ptr->rx_data = mailbox_ptr->lz_buf;
+    mailbox_ptr->rx_len = (size_t)raw;
+    mailbox_ptr->rx_lz = 1;
+}
+
+//取得下一個 frame (還不釋放)：目前這次 transfer 的 frame 都讀完了，就去拿下一個 transfer
+//block = 0 時不等待，sender 還沒送東西來就回傳 NULL
+frame_hdr_t *xfer_next(mailbox_t *mailbox_ptr, int block)
+{
+    if (mailbox_ptr->rx_off < mailbox_ptr->rx_len)
+        return (frame_hdr_t *)(mailbox_ptr->rx_data + mailbox_ptr->rx_off);
+
+    if (!mailbox_ptr->ops->rx_begin(mailbox_ptr, block))
+        return NULL;
+    mailbox_ptr->rx_off = 0;
+    if (((frame_hdr_t *)mailbox_ptr->rx_data)->flags & FRAME_LZ)
+        lz_unpack(mailbox_ptr, (frame_hdr_t *)mailbox_ptr->rx_data);
+    return (frame_hdr_t *)mailbox_ptr->rx_data;
+}
+
+//這個 frame 讀完了；整個 transfer 都讀完就交還給 backend (解壓縮過的已經還了)
+void xfer_release(mailbox_t *mailbox_ptr, frame_hdr_t *hdr)
+{
+    mailbox_ptr->rx_off += frame_size(hdr->len);
+    if (mailbox_ptr->rx_off < mailbox_ptr->rx_len)
+        return;
+    if (mailbox_ptr->rx_lz)
+        mailbox_ptr->rx_lz = 0;
+    else if (mailbox_ptr->ops->rx_end)
+        mailbox_ptr->ops->rx_end(mailbox_ptr);
+}
+
+/* ============================ sender 端 ============================ */
+
+/*
+    integrity：訊息的第一個 frame 帶 FRAME_CRC，payload 最前面 FRAME_CRC_SIZE byte 是 receiver 最後拿到的那些 byte 的 CRC32C
+    FRAME_REF / FRAME_ARENA 算的是共享檔案 / arena 裡的內容，不是 16 byte 的 ref，從 sender 寫進去到 receiver 讀出來整段都有檢查
+    CRC_INLINE 以下的訊息把 CRC 和內容拼在一起用一個 frame 送 (多一個 frame 的成本比複製這幾十 byte 高很多)
+    更長的訊息先送一個只有 CRC 的 frame (帶 FRAME_MORE)，內容照原本的方式切
+    transfer 型的 backend 要和訊息的第一個片段放在同一個 transfer：放不下就先 flush，多個 receiver 時才不會被分給不同人
+    回傳 1 = 訊息已經整個送出去了
+*/
+#define CRC_INLINE 256
+static int batch_checksum(mailbox_t *mailbox_ptr, long mType, const message_t *message, uint32_t kind, size_t max)
+{
+    const char *data = message->msgText;
+    size_t len = message->msgLen;
+    if (kind & (FRAME_REF | FRAME_ARENA))
+    {
+        frame_ref_t ref;
+        memcpy(&ref, message->msgText, sizeof(ref));
+        data = (kind & FRAME_REF ? mailbox_ptr->file_data : mailbox_ptr->arena->data) + ref.off;
+        len = (size_t)ref.len;
+    }
+    char head[FRAME_CRC_SIZE + CRC_INLINE] = {0};
+    uint32_t crc = crc32c(0, data, len);
+    memcpy(head, &crc, sizeof(crc));
+
+    int inline_ok = message->msgLen <= CRC_INLINE && FRAME_CRC_SIZE + message->msgLen <= max;
+    size_t first = message->msgLen < max ? message->msgLen : max;
+    if (inline_ok)
+        memcpy(head + FRAME_CRC_SIZE, message->msgText, message->msgLen);
+    else if (mailbox_ptr->tx_cap && mailbox_ptr->tx_len > 0 &&
+             mailbox_ptr->tx_len + frame_size(FRAME_CRC_SIZE) + frame_size(first) > xfer_batch_cap(mailbox_ptr))
+        mailbox_flush(mailbox_ptr);
+    size_t n = inline_ok ? FRAME_CRC_SIZE + message->msgLen : FRAME_CRC_SIZE;
+    if (mailbox_ptr->tx_len == 0)
+        clock_gettime(CLOCK_MONOTONIC, &mailbox_ptr->tx_first);
+    mailbox_ptr->ops->put(mailbox_ptr, mType, kind | FRAME_CRC | (inline_ok ? 0 : FRAME_MORE), head, n);
+    mailbox_ptr->tx_len += frame_size(n);
+    return inline_ok;
+}
+
+//stats 的 bytes：FRAME_REF / FRAME_ARENA 的 msgText 是 frame_ref_t，算它指到的內容
+static uint64_t content_len(const message_t *message, uint32_t kind)
+{
+    frame_ref_t ref;
+    if (!(kind & (FRAME_REF | FRAME_ARENA)))
+        return message->msgLen;
+    memcpy(&ref, message->msgText, sizeof(ref));
+    return ref.len;
+}
+
+//把一則訊息切成 frame 放進 batch
+//payload 比 transport 單次能搬的還大時，切成多個 frame，除了最後一個都帶 FRAME_MORE
+//空訊息也會送出一個 len = 0 的 frame；kind (FRAME_FILE / FRAME_REF) 每個 frame 都會帶
+//MSG_PASSING 開 prio 時 mType 換到 class prio 的區間 (見 PRIO_SPAN)；其他模式 class 是分開的 mailbox，mType 不變
+static void batch_message(mailbox_t *mailbox_ptr, const message_t *message, uint32_t kind, int prio)
+{
+    long mType = message->mType;
+    if (mailbox_ptr->prio && mailbox_ptr->flag == MSG_PASSING)
+        mType += prio * PRIO_SPAN;
+    const transport_t *ops = mailbox_ptr->ops;
+    size_t max = ops->max_payload(mailbox_ptr);
+    size_t off = 0;
+    //一則訊息被切成好幾個 transfer 時，多個 sender / receiver 會把片段交錯或分給不同的 receiver，無法重組
+    //不能在這裡 exit：receiver 會一直等不到 exit，IPC 也不會被移除；不送這則、設 error，讓呼叫端走正常的結束流程
+    if (message->msgLen > max && mailbox_ptr->peers &&
+        (atomic_load(&mailbox_ptr->peers->senders) > 1 || atomic_load(&mailbox_ptr->peers->receivers) > 1))
+    {
+        fprintf(stderr, "Message of %zu bytes is larger than one transfer (%zu bytes); "
+                        "not supported with multiple senders / receivers\n", message->msgLen, max);
+        mailbox_ptr->error = 1;
+        return;
+    }
+    if (mailbox_ptr->stat && !(kind & (FRAME_FILE | FRAME_WAKE)))
+        stats_message(mailbox_ptr->stat, content_len(message, kind));
+    if (mailbox_ptr->integrity && !(kind & (FRAME_FILE | FRAME_WAKE)) &&
+        batch_checksum(mailbox_ptr, mType, message, kind, max))
+    {
+        mailbox_ptr->tx_count++;
+        return;
+    }
+    do
+    {
+        size_t chunk = message->msgLen - off < max ? message->msgLen - off : max;
+        uint32_t flags = kind | (off + chunk < message->msgLen ? FRAME_MORE : 0);
+        if (mailbox_ptr->tx_len == 0)
+            clock_gettime(CLOCK_MONOTONIC, &mailbox_ptr->tx_first);
+        ops->put(mailbox_ptr, mType, flags, message->msgText + off, chunk);
+        mailbox_ptr->tx_len += frame_size(chunk);
+        off += chunk;
+    } while (off < message->msgLen);
+    mailbox_ptr->tx_count++;
+}
+
+//batch 裡第一則訊息放進去之後，是否已經超過 batch_timeout_us
+static int batch_expired(mailbox_t *mailbox_ptr)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long waited_us = (now.tv_sec - mailbox_ptr->tx_first.tv_sec) * 1000000L +
+                     (now.tv_nsec - mailbox_ptr->tx_first.tv_nsec) / 1000;
+    return waited_us >= mailbox_ptr->batch_timeout_us;
+}
+
+//batch 大小每次都記；hold latency 要多讀一次 clock，每 STATS_HOLD_SAMPLE 個 batch 才量一次
+#define STATS_HOLD_SAMPLE 8
+static void count_batch(mailbox_t *mailbox_ptr)
+{
+    stats_slot_t *stat = mailbox_ptr->stat;
+    stats_batch(stat, (uint64_t)mailbox_ptr->tx_count);
+    if (atomic_load_explicit(&stat->batches, memory_order_relaxed) % STATS_HOLD_SAMPLE == 0)
+        stats_hold(stat, stats_now() - ((uint64_t)mailbox_ptr->tx_first.tv_sec * 1000000000ull +
+                                        (uint64_t)mailbox_ptr->tx_first.tv_nsec));
+}
+
+//把目前累積的 batch 一次交給 receiver：一次 msgsnd() / 一次 shm 交握 / 一次 publish tail ...
+void mailbox_flush(mailbox_t *mailbox_ptr)
+{
+    if (mailbox_ptr->tx_len == 0)
+        return;
+    mailbox_ptr->ops->flush(mailbox_ptr);
+    if (mailbox_ptr->stat)
+        count_batch(mailbox_ptr);
+    mailbox_ptr->tx_len = 0;
+    mailbox_ptr->tx_count = 0;
+    if (mailbox_ptr->bell)
+        doorbell_ring(mailbox_ptr);
+}
+
+//batch_bytes = 0 時每則訊息都立刻送出；否則累積到 batch_bytes 或等太久才送
+//timeout 是在下一次 send 時檢查的，輸入停住時要由呼叫端自己 mailbox_flush()
+static void send_message(mailbox_t *mailbox_ptr, const message_t *message, uint32_t kind)
+{
+    batch_message(mailbox_ptr, message, kind, PRIO_BULK);
+    if (mailbox_ptr->tx_len >= mailbox_ptr->batch_bytes || batch_expired(mailbox_ptr))
+        mailbox_flush(mailbox_ptr);
+}
+
+void mailbox_send(mailbox_t *mailbox_ptr, const message_t *message)
+{
+    send_message(mailbox_ptr, message, 0);
+}
+
+//一次送出 n 則訊息：全部打包進盡量少的 transfer (transfer 放滿才換下一個)，最後一定會 flush
+void mailbox_send_batch(mailbox_t *mailbox_ptr, const message_t *messages, int n)
+{
+    for (int i = 0; i < n; i++)
+        batch_message(mailbox_ptr, &messages[i], 0, PRIO_BULK);
+    mailbox_flush(mailbox_ptr);
+}
+
+/*
+    用 priority class 送一則訊息 (見 PRIO_*；沒有開 prio 時就是 mailbox_send())
+    control / urgent 不進 bulk 的 batch，立刻送出：
+        MSG_PASSING：mType 換到 class 的區間，和 bulk 在同一個 queue
+        其他模式：送到這個 class 自己的 mailbox，再在 bulk 送一個 FRAME_WAKE，receiver 睡在 bulk 上也會醒來
+    bulk 裡還沒送出的 batch 會跟著 flush 出去 (urgent 本來就不用等它)
+*/
+void mailbox_send_prio(mailbox_t *mailbox_ptr, const message_t *message, int prio)
+{
+    if (!mailbox_ptr->prio || prio >= PRIO_BULK)
+    {
+        mailbox_send(mailbox_ptr, message);
+        return;
+    }
+    if (mailbox_ptr->flag == MSG_PASSING)
+    {
+        batch_message(mailbox_ptr, message, 0, prio);
+        mailbox_flush(mailbox_ptr);
+        return;
+    }
+    mailbox_t *box = &mailbox_ptr->prio_box[prio];
+    batch_message(box, message, 0, prio);
+    mailbox_flush(box);
+    mailbox_ptr->error |= box->error;
+    message_t wake = {.mType = message->mType, .msgLen = 0, .msgText = ""};
+    batch_message(mailbox_ptr, &wake, FRAME_WAKE, PRIO_BULK);
+    mailbox_flush(mailbox_ptr);
+}
+
+/*
+    zero-copy 檔案傳輸：sender 把 path 整個 mmap 起來 (*data, *size)，再把檔案的絕對路徑送給 receiver (FRAME_FILE)
+    receiver 收到後自己 mmap 同一個檔案，兩邊看到的是同一份 page cache
+    之後用 mailbox_send_ref() 只送 (offset, length)，內容本身完全不經過 mailbox，也不會被複製
+    檔案在傳輸途中不能被截短 (receiver 讀到被截掉的部分會 SIGBUS)；失敗回傳 -1 (errno 有原因)
+*/
+int mailbox_share_file(mailbox_t *mailbox_ptr, const char *path, const char **data, size_t *size)
+{
+    char real[PATH_MAX];
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+        return -1;
+    if (realpath(path, real) == NULL || fstat(fd, &st) == -1)
+    {
+        close(fd);
+        return -1;
+    }
+    if (!S_ISREG(st.st_mode))
+    {
+        close(fd);
+        errno = EINVAL; // pipe / 終端機沒辦法 mmap
+        return -1;
+    }
+    //空檔案沒有東西可以 map
+    void *map = NULL;
+    if (st.st_size > 0)
+    {
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            close(fd);
+            return -1;
+        }
+        madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+    }
+    close(fd); // mapping 還在
+    mailbox_ptr->file_data = map;
+    mailbox_ptr->file_size = (size_t)st.st_size;
+
+    message_t announce = {.mType = mailbox_ptr->route ? mailbox_ptr->route : 1, .msgLen = strlen(real), .msgText = real};
+    send_message(mailbox_ptr, &announce, FRAME_FILE);
+    *data = map;
+    *size = (size_t)st.st_size;
+    return 0;
+}
+
+//送出共享檔案裡 [off, off + len) 這一段：只有 16 byte 的 frame_ref_t 會經過 mailbox
+void mailbox_send_ref(mailbox_t *mailbox_ptr, long mType, size_t off, size_t len)
+{
+    frame_ref_t ref = {.off = off, .len = len};
+    message_t message = {.mType = mType, .msgLen = sizeof(ref), .msgText = (char *)&ref};
+    send_message(mailbox_ptr, &message, FRAME_REF);
+}
+
+/*
+    arena (見 arena.h)：在共享的 arena 裡配置剛好 len byte 的 buffer，sender 直接把內容寫進去，
+    再用 mailbox_send_alloc() 只送 offset；receiver 處理完用 mailbox_release() 還回去
+    arena 暫時滿了會等 receiver 還；mailbox 沒有 arena (open 前沒設 arena_bytes) 或 len 比整個 arena 還大回傳 NULL
+*/
+char *mailbox_alloc(mailbox_t *mailbox_ptr, size_t len)
+{
+    if (mailbox_ptr->arena == NULL)
+        return NULL;
+    uint64_t off = arena_alloc(mailbox_ptr->arena, len, &mailbox_ptr->spin);
+    return off == ARENA_NONE ? NULL : arena_ptr(mailbox_ptr->arena, off);
+}
+
+//buf 是 mailbox_alloc() 拿到的 buffer，送出之後就歸 receiver 了，sender 不能再改
+void mailbox_send_alloc(mailbox_t *mailbox_ptr, long mType, const char *buf, size_t len)
+{
+    frame_ref_t ref = {.off = (uint64_t)(buf - mailbox_ptr->arena->data), .len = len};
+    message_t message = {.mType = mType, .msgLen = sizeof(ref), .msgText = (char *)&ref};
+    send_message(mailbox_ptr, &message, FRAME_ARENA);
+}
+
+/* ============================ receiver 端 ============================ */
+
+//把一個 frame 的 payload 接到 message 後面，buffer 不夠就放大
+//永遠多留 1 byte 補 '\0'，文字訊息可以直接當字串用
+static void message_append(message_t *message_ptr, const char *data, size_t len)
+{
+    size_t need = message_ptr->msgLen + len + 1;
+    if (need > message_ptr->msgCap)
+    {
+        size_t cap = message_ptr->msgCap ? message_ptr->msgCap : 64;
+        while (cap < need)
+            cap *= 2;
+        char *text = realloc(message_ptr->msgText, cap);
+        if (text == NULL)
+        {
+            perror("realloc failed");
+            exit(1);
+        }
+        message_ptr->msgText = text;
+        message_ptr->msgCap = cap;
+    }
+    copy_bytes(message_ptr->msgText + message_ptr->msgLen, data, len);
+    message_ptr->msgLen += len;
+    message_ptr->msgText[message_ptr->msgLen] = '\0';
+}
+
+//receiver: sender 用 mailbox_share_file() 分享的檔案，自己也 mmap 一份 (唯讀)
+static void map_shared_file(mailbox_t *mailbox_ptr, const char *path)
+{
+    if (mailbox_ptr->file_data)
+        munmap((void *)mailbox_ptr->file_data, mailbox_ptr->file_size);
+    mailbox_ptr->file_data = NULL;
+    mailbox_ptr->file_size = 0;
+
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if (fd == -1 || fstat(fd, &st) == -1)
+    {
+        perror("Cannot open shared file");
+        exit(1);
+    }
+    if (st.st_size > 0)
+    {
+        void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            perror("mmap failed");
+            exit(1);
+        }
+        madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+        mailbox_ptr->file_data = map;
+        mailbox_ptr->file_size = (size_t)st.st_size;
+    }
+    close(fd);
+}
+
+//收一則完整的訊息：一則訊息可能被切成好幾個 frame，收到沒有 FRAME_MORE 的那個才算完整
+//block = 0 時第一個 frame 還沒到就回傳 0；第一個 frame 到了之後，後面的片段一定會等
+//FRAME_FILE 自己處理掉 (mmap 檔案) 不交給呼叫端；FRAME_REF 只填 msgRef / msgLen，內容不複製
+//FRAME_WAKE 不是訊息，直接回傳 0 (block = 1 也一樣)，讓 recv_prio() 回頭看 urgent
+//FRAME_ARENA 也只填 msgRef / msgLen，另外記下 msgSlot，呼叫端用完要 mailbox_release()
+//FRAME_ABORT 不是訊息：跳過它 (收到一半的訊息也一起丟掉) 收下一則
+//FRAME_CRC 開頭的訊息組好之後驗證 CRC32C，不一樣就印錯誤並結束
+static int receive_message(mailbox_t *mailbox_ptr, message_t *message_ptr, int block)
+{
+    const transport_t *ops = mailbox_ptr->ops;
+    frame_hdr_t *hdr = ops->next(mailbox_ptr, block);
+    if (hdr == NULL)
+        return 0;
+
+    if (hdr->flags & FRAME_ABORT)
+    {
+        ops->release(mailbox_ptr, hdr);
+        return receive_message(mailbox_ptr, message_ptr, block);
+    }
+    //sender 開了 integrity：第一個 frame 的前 FRAME_CRC_SIZE byte 是 CRC，後面才是訊息
+    int checked = 0;
+    uint32_t expect = 0;
+    if (hdr->flags & FRAME_CRC)
+    {
+        memcpy(&expect, frame_payload(hdr), sizeof(expect));
+        checked = 1;
+    }
+    uint32_t kind = hdr->flags & (FRAME_FILE | FRAME_REF | FRAME_WAKE | FRAME_ARENA);
+    if (kind == FRAME_WAKE)
+    {
+        ops->release(mailbox_ptr, hdr);
+        return 0;
+    }
+    message_ptr->msgRef = NULL;
+    message_ptr->msgSlot = 0;
+    message_ptr->msgLen = 0;
+    message_ptr->mType = mailbox_ptr->rx_mType ? mailbox_ptr->rx_mType : 1;
+    for (;;)
+    {
+        struct timespec start;
+        uint32_t flags = hdr->flags;
+        size_t skip = flags & FRAME_CRC ? FRAME_CRC_SIZE : 0;
+        //payload 直接從 transfer (或 ring) 複製到 message，長度由 header 決定
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        message_append(message_ptr, frame_payload(hdr) + skip, hdr->len - skip);
+        mailbox_add_time(mailbox_ptr, &start);
+        ops->release(mailbox_ptr, hdr);
+        if (!(flags & FRAME_MORE))
+            break;
+        hdr = ops->next(mailbox_ptr, 1);
+        //前一個 sender 掛在這則訊息中間 (persist)：收到的片段丟掉，重新掛上的 sender 會從頭重送
+        if (hdr->flags & FRAME_ABORT)
+        {
+            ops->release(mailbox_ptr, hdr);
+            return receive_message(mailbox_ptr, message_ptr, 1);
+        }
+    }
+
+    if (kind == FRAME_FILE)
+    {
+        map_shared_file(mailbox_ptr, message_ptr->msgText);
+        return receive_message(mailbox_ptr, message_ptr, block);
+    }
+    if (kind == FRAME_REF)
+    {
+        frame_ref_t ref;
+        memcpy(&ref, message_ptr->msgText, sizeof(ref));
+        if (ref.off > mailbox_ptr->file_size || ref.len > mailbox_ptr->file_size - ref.off)
+        {
+            fprintf(stderr, "File reference [%llu, +%llu) is outside the shared file (%zu bytes)\n",
+                    (unsigned long long)ref.off, (unsigned long long)ref.len, mailbox_ptr->file_size);
+            exit(1);
+        }
+        message_ptr->msgRef = mailbox_ptr->file_data + ref.off;
+        message_ptr->msgLen = (size_t)ref.len;
+    }
+    if (kind == FRAME_ARENA)
+    {
+        frame_ref_t ref;
+        memcpy(&ref, message_ptr->msgText, sizeof(ref));
+        if (mailbox_ptr->arena == NULL)
+            mailbox_ptr->arena = arena_attach(mailbox_key(mailbox_ptr, ARENA_PROJ_ID));
+        if (ref.off > mailbox_ptr->arena->size || ref.len > mailbox_ptr->arena->size - ref.off)
+        {
+            fprintf(stderr, "Arena block [%llu, +%llu) is outside the arena (%llu bytes)\n",
+                    (unsigned long long)ref.off, (unsigned long long)ref.len,
+                    (unsigned long long)mailbox_ptr->arena->size);
+            exit(1);
+        }
+        message_ptr->msgRef = arena_ptr(mailbox_ptr->arena, ref.off);
+        message_ptr->msgLen = (size_t)ref.len;
+        message_ptr->msgSlot = ref.off + 1;
+    }
+    //內容和 sender 算的不一樣：共享記憶體被寫壞了，或是讀到寫到一半的訊息
+    if (checked && crc32c(0, message_data(message_ptr), message_ptr->msgLen) != expect)
+    {
+        fprintf(stderr, "Checksum mismatch on a %zu-byte message (expected %08x, got %08x)\n", message_ptr->msgLen,
+                expect, crc32c(0, message_data(message_ptr), message_ptr->msgLen));
+        exit(1);
+    }
+    if (mailbox_ptr->stat)
+        stats_message(mailbox_ptr->stat, message_ptr->msgLen);
+    return 1;
+}
+
+//receive() 收到的 FRAME_ARENA 訊息處理完了：block 還給 arena，sender 可以再拿去用 (其他訊息什麼都不做)
+void mailbox_release(mailbox_t *mailbox_ptr, message_t *message_ptr)
+{
+    if (message_ptr->msgSlot == 0)
+        return;
+    arena_free(mailbox_ptr->arena, message_ptr->msgSlot - 1);
+    message_ptr->msgSlot = 0;
+    message_ptr->msgRef = NULL;
+}
+
+//persist: 呼叫端回來收下一批，表示上一批都處理完了
+static void ack_previous(mailbox_t *mailbox_ptr)
+{
+    if (mailbox_ptr->persist && mailbox_ptr->ops->ack)
+        mailbox_ptr->ops->ack(mailbox_ptr);
+}
+
+//收一則訊息；block = 0 時沒有訊息就回傳 0
+static int recv_prio(mailbox_t *mailbox_ptr, message_t *messages, int n, int block);
+
+int mailbox_recv(mailbox_t *mailbox_ptr, message_t *message_ptr, int block)
+{
+    if (mailbox_ptr->prio_box)
+        return recv_prio(mailbox_ptr, message_ptr, 1, block);
+    ack_previous(mailbox_ptr);
+    int got = receive_message(mailbox_ptr, message_ptr, block);
+    if (mailbox_ptr->ops->publish)
+        mailbox_ptr->ops->publish(mailbox_ptr);
+    if (got && mailbox_ptr->stat)
+        stats_batch(mailbox_ptr->stat, 1);
+    return got;
+}
+
+//一次最多收 n 則訊息：block 時至少等到一則，之後只拿已經送到的 (同一個 batch 或 ring 裡現有的)，不會再等待
+//ring 模式整批收完才 publish 一次 head；回傳實際收到幾則
+//有好幾個 receiver 時只拿目前這個 transfer 裡的，不去搶下一個：不然一個 receiver 可能一次拿走好幾個給別人的 "exit"
+static int recv_batch(mailbox_t *mailbox_ptr, message_t *messages, int n, int block)
+{
+    int count = 0;
+    if (n <= 0)
+        return 0;
+    if (mailbox_ptr->prio_box)
+        return recv_prio(mailbox_ptr, messages, n, block);
+
+    ack_previous(mailbox_ptr);
+    int shared = mailbox_ptr->peers && atomic_load(&mailbox_ptr->peers->receivers) > 1;
+    while (count < n && (count == 0 || !shared || mailbox_ptr->rx_off < mailbox_ptr->rx_len) &&
+           receive_message(mailbox_ptr, &messages[count], count == 0 && block))
+        count++;
+
+    if (mailbox_ptr->ops->publish)
+        mailbox_ptr->ops->publish(mailbox_ptr);
+    if (count > 0 && mailbox_ptr->stat)
+        stats_batch(mailbox_ptr->stat, (uint64_t)count);
+    return count;
+}
+
+int mailbox_recv_batch(mailbox_t *mailbox_ptr, message_t *messages, int n)
+{
+    return recv_batch(mailbox_ptr, messages, n, 1);
+}
+
+//receiver 可以 epoll / poll 的 fd：可讀表示 mailbox_recv_ready() 可能收得到東西
+//FIFO / socket / mq / eventfd 模式就是 transport 自己的 fd；其他模式要在 open 之前設 doorbell；都沒有回傳 -1
+int mailbox_fd(mailbox_t *mailbox_ptr)
+{
+    if (mailbox_ptr->ops->poll_fd)
+        return mailbox_ptr->ops->poll_fd(mailbox_ptr);
+    return mailbox_ptr->bell ? doorbell_fd(mailbox_ptr) : -1;
+}
+
+/*
+    給 event loop 用的 non-blocking 版 mailbox_recv_batch()：只拿已經送到的，最多 n 則
+    回傳 0 時 doorbell 已經 arm 好，可以放心回去 epoll_wait()：之後 sender 再送東西一定會叫醒 mailbox_fd()
+    (arm 之後會再收一次，arm 之前剛好送到的不會被漏掉)
+*/
+int mailbox_recv_ready(mailbox_t *mailbox_ptr, message_t *messages, int n)
+{
+    int count = recv_batch(mailbox_ptr, messages, n, 0);
+    if (count > 0 || mailbox_ptr->bell == NULL)
+        return count;
+    doorbell_arm(mailbox_ptr);
+    count = recv_batch(mailbox_ptr, messages, n, 0);
+    if (count > 0)
+        doorbell_disarm(mailbox_ptr); // 還有資料，呼叫端會繼續收，不用 sender 叫
+    return count;
+}
+
+//priority 模式：從 class c 的 mailbox 拿現有的訊息 (不等待)，mType 換到 class 的區間
+static int recv_class(mailbox_t *box, message_t *messages, int n, int c, int block)
+{
+    int count = 0;
+    int shared = box->peers && atomic_load(&box->peers->receivers) > 1;
+    while (count < n && (count == 0 || !shared || box->rx_off < box->rx_len) &&
+           receive_message(box, &messages[count], count == 0 && block))
+    {
+        messages[count].mType += c * PRIO_SPAN;
+        count++;
+    }
+    if (box->ops->publish)
+        box->ops->publish(box);
+    if (count > 0 && box->stat)
+        stats_batch(box->stat, (uint64_t)count);
+    return count;
+}
+
+//把 [0, a) 和 [a, a + b) 兩段對調 (三次反轉)，message 的 buffer 跟著搬
+static void reverse_messages(message_t *messages, int n)
+{
+    for (int i = 0, j = n - 1; i < j; i++, j--)
+    {
+        message_t tmp = messages[i];
+        messages[i] = messages[j];
+        messages[j] = tmp;
+    }
+}
+
+static void rotate_messages(message_t *messages, int a, int b)
+{
+    reverse_messages(messages, a);
+    reverse_messages(messages + a, b);
+    reverse_messages(messages, a + b);
+}
+
+/*
+    priority 模式 (MSG_PASSING 以外) 的 drain policy：
+        1. control / urgent 現有的全部收 (class 小的在前)
+        2. bulk 最多收 PRIO_BULK_BUDGET 則，而且最多用掉剩下空間的一半
+        3. 收到 bulk 的話再看一次 control / urgent，放在 bulk 前面：
+           sender 在某則 bulk 之前送出的 urgent 一定在它前面交出去 (例如 "exit" 前面的 urgent 不會被丟掉)
+    一則都沒有就睡在 bulk 上；sender 送 urgent 時會在 bulk 補一個 FRAME_WAKE 叫醒
+    urgent 最多等呼叫端處理完一批 (n 則) 就會被看到，bulk 每次呼叫都有份，不會被 urgent 餓死
+*/
+static int recv_prio(mailbox_t *mailbox_ptr, message_t *messages, int n, int block)
+{
+    for (;;)
+    {
+        int count = 0;
+        for (int c = 0; c < PRIO_BULK; c++)
+            count += recv_class(&mailbox_ptr->prio_box[c], messages + count, n - count, c, 0);
+
+        int budget = (n - count) / 2;
+        if (budget > PRIO_BULK_BUDGET)
+            budget = PRIO_BULK_BUDGET;
+        if (budget == 0 && count == 0)
+            budget = 1;
+        int bulk = recv_class(mailbox_ptr, messages + count, budget, PRIO_BULK, 0);
+        if (bulk > 0)
+        {
+            int late = 0;
+            for (int c = 0; c < PRIO_BULK; c++)
+                late += recv_class(&mailbox_ptr->prio_box[c], messages + count + bulk + late,
+                                   n - count - bulk - late, c, 0);
+            rotate_messages(messages + count, bulk, late);
+            count += bulk + late;
+        }
+        if (count > 0 || !block)
+            return count;
+
+        //都是空的：等 bulk (或 FRAME_WAKE)，收到真的訊息就直接交出去
+        if (recv_class(mailbox_ptr, messages, 1, PRIO_BULK, 1))
+            return 1;
+    }
+}
@@ -0,0 +1,220 @@
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/msg.h>
+#include <sys/shm.h>
+#include <time.h>
+#include <stdint.h>
+#include "frame.h"
+#include "sync.h"
+
+//定義通訊模式 (message passing, shared memory and shared memory ring)
+//每個模式的實作是一張 transport_t (見 transport.h)
+#define MSG_PASSING 1
+#define SHARED_MEM 2
+#define SHM_RING 3 // 多個 slot 的 lock-free ring，sender 可以領先 receiver，不用 semaphore
+#define FIFO_PIPE 4   // named pipe (mkfifo)
+#define UNIX_SOCKET 5 // AF_UNIX SOCK_SEQPACKET，保留訊息邊界
+#define POSIX_MQ 6    // mq_open() / mq_send() / mq_receive()
+#define SHM_EVENTFD 7 // shared memory slot + eventfd 通知 (eventfd 用 SCM_RIGHTS 傳給 receiver)
+#define SHM_MPMC 8    // 多個 sender / 多個 receiver 共用的 lock-free ring (shared work queue)
+#define SHM_BCAST 9   // 一個 sender 寫一次，每個 receiver 都收到 (pub-sub，各自的 cursor)
+#define MAILBOX_MODES 10 // mode 編號的上限 (不含)
+
+#define MAILBOX_SENDER 0
+#define MAILBOX_RECEIVER 1
+
+typedef struct ring ring_t;
+typedef struct mpmc mpmc_t;
+typedef struct bcast bcast_t;
+typedef struct arena arena_t;
+typedef struct msgq_buf msgq_buf_t;
+typedef struct transport transport_t;
+typedef struct doorbell doorbell_t;
+typedef struct stats stats_t;
+typedef struct stats_slot stats_slot_t;
+
+typedef struct mailbox {
+    int flag;      // 通訊模式：MSG_PASSING, SHARED_MEM, SHM_RING ...
+    union{
+        int msqid; //for system V api. You can replace it with structure for POSIX api
+        char* shm_addr; // shared memory 的address pointer 
+        ring_t* ring;   // SHM_RING: 掛載好的 ring (見 ring.h)
+        int fd;         // FIFO_PIPE / UNIX_SOCKET / POSIX_MQ (Linux 的 mqd_t 就是 fd)
+        struct {
+            char *slots;    // shared memory 裡的 slot 陣列
+            int data_fd;    // eventfd：有幾個 slot 可以收
+            int space_fd;   // eventfd：有幾個 slot 可以寫
+            unsigned next;  // 下一個要用的 slot
+            size_t bytes;   // mapping 的大小 (huge page 時比 slot 陣列大)
+        } efd;          // SHM_EVENTFD
+        struct {
+            mpmc_t *q;      // 掛載好的 MPMC ring (見 transport_mpmc.c)
+            uint64_t pos;   // 目前這個 process 佔住的 cell
+        } mpmc;         // SHM_MPMC
+        struct {
+            bcast_t *log;   // 掛載好的 broadcast log (見 transport_bcast.c)
+            uint64_t pos;   // sender: 下一個要寫的位置；receiver: 自己的 cursor
+            uint64_t min;   // sender: 最慢的 receiver cursor 的本地快取
+            int reader;     // receiver: 在 reader[] 的位置
+        } bcast;        // SHM_BCAST
+    }storage;
+    const transport_t *ops; // 這個模式的 function table (見 transport.h)
+    spin_t spin;    // 這個 process 等待對方時的 spin 設定 (見 sync.h)
+    int role;       // MAILBOX_SENDER / MAILBOX_RECEIVER
+    const char *key_path; // ftok() 用的路徑，sender / receiver 要一樣
+    sync_ctl_t *ctl;      // MSG_PASSING / SHARED_MEM 的 sender_sem / receiver_sem
+    msgq_buf_t *qbuf;     // MSG_PASSING: msgsnd() / msgrcv() 用的 buffer
+    char *xbuf;           // FIFO_PIPE / UNIX_SOCKET / POSIX_MQ: 本地的 batch buffer
+    size_t tx_cap;        // transfer 型 backend 一次最多搬幾個 byte
+    size_t tx_nt_min;     // tx_begin() 給的是共享記憶體時：copy_to_shared() 的 nt_min (見 copy.h)；本地 buffer 是 0
+    unsigned window;      // MSG_PASSING: sender 最多可以有幾個 batch 還沒被收走 (credit)，0 = 1
+    unsigned subscribers; // SHM_BCAST: sender 開始寫之前要等幾個 receiver 加入，0 = 1
+    size_t ring_bytes;    // SHM_RING: ring data 區大小 (2 的次方)，0 = RING_BYTES
+    int lanes;            // stripe: 總共幾條 lane (見 stripe.h)，每條是一個獨立的 IPC；0 / 1 = 只有自己這條
+    int lane;             // 這個 mailbox 是第幾條 lane，IPC key 依照 lane 分開 (見 mailbox_key())
+    struct mailbox *lane_box; // lane 1 .. lanes - 1，mailbox_open() 建立；lane 0 就是自己
+    int channel;          // 同一個目錄下的第幾個 mailbox (0 ~ 65535)，IPC key 依照 channel 分開；一個 receiver 可以同時收好幾個 (見 mailbox_fd())
+    int doorbell;         // 1 = 共享記憶體類的模式也要有可以 epoll 的 fd (eventfd doorbell)，兩邊要一樣
+    doorbell_t *bell;     // doorbell 開了才有 (見 transport_fd.c)
+    int prio;             // 1 = 分 priority class (見 PRIO_*)，兩邊要一樣
+    struct mailbox *prio_box; // MSG_PASSING 以外：PRIO_CONTROL .. PRIO_BULK - 1 各一個 mailbox；PRIO_BULK 就是自己
+    const char *file_data; // zero-copy 檔案傳輸：兩邊各自 mmap 的同一個檔案 (sender: mailbox_share_file()，receiver: 收到 FRAME_FILE)
+    size_t file_size;
+    size_t arena_bytes;   // sender: > 0 時建立這麼大的 arena，mailbox_alloc() 從裡面配置 (見 arena.h)
+    arena_t *arena;       // sender: 建立的；receiver: 收到第一個 FRAME_ARENA 時掛載
+    int persist;          // SHM_RING: 1 = 區段跨 process 重新啟動保留，掛掉的 sender / receiver 重新掛上接著做 (見 ring.h)
+    uint64_t resumed;     // persist 重新掛上時：sender = 之前已經送出幾則，receiver = 之前已經處理完幾則 (新建立的是 0)
+    unsigned generation;  // persist: open 之後區段的 generation (每次有 process 重新掛上就 +1)
+    int integrity;        // sender: 1 = 每則訊息的第一個 frame 帶 FRAME_CRC；receiver 收到 FRAME_CRC 就驗證，不用設定
+    size_t compress_min;  // sender: 這麼大以上的 batch 壓縮成一個 FRAME_LZ 再送 (見 lz.h)，0 = 不壓縮；只有 transfer 型的 backend
+    int no_compress;      // receiver: 1 = 不接受壓縮過的 batch (open 時登記在 peers，sender 看到就不壓)
+    int telemetry;        // 1 = 計數器發佈到共享的 stats 區段，ipcstat 可以看 (見 stats.h)
+    stats_t *stats;       // 掛載的 stats 區段 (lane / class mailbox 和主 mailbox 共用一個)
+    stats_slot_t *stat;   // 自己的 slot；NULL = 不計數
+    place_t place;        // huge page / NUMA node / CPU pinning (見 place.h)，要先 place_init()
+    long route;           // routing key：sender 送出的 mType；receiver 只收這個 mType (0 = 什麼都收)
+    peers_t *peers;       // 支援多個 sender / receiver 的 transport 才有：登記在共享區段裡的 peer (見 sync.h)
+    int peer_slot;        // receiver 在 peers->keys[] 的位置
+    int finished;         // sender 已經呼叫過 mailbox_finish()
+    int error;            // sender: 有訊息送不出去 (見 batch_message())；呼叫端看到就停止送資料，照常 finish / 送 exit / close
+    int last;             // receiver 是最後離開的一個：close() 要負責移除 IPC
+    double total_time;    // 花在複製資料 / msgsnd() / msgrcv() 上的時間 (不含等待對方)
+
+    //sender 端的 batch：很多則訊息的 frame 先累積起來，一次 msgsnd() / 一次 shm 交握 / 一次 publish tail
+    size_t batch_bytes;     // 累積到這麼多 byte 就送出，0 = 每則訊息都立刻送出 (原本的行為)
+    long batch_timeout_us;  // batch 裡第一則訊息放進去之後，超過這麼久就送出
+    char *tx_data;          // 目前 batch 寫到哪裡 (msgq: 本地 buffer, shm: 直接寫在共享記憶體)
+    size_t tx_len;          // batch 裡 frame 的總長度
+    int tx_count;           // batch 裡有幾則完整的訊息
+    long tx_mType;
+    struct timespec tx_first;
+    int tx_lz;              // 這個 batch 先組在本地的 lz_buf，flush 時才壓縮 (見 xfer_flush())
+    int lz_span;            // lz_buf 裡的 batch 最多組到 tx_cap 的幾倍，依照壓縮率調整
+    char *lz_buf;           // sender: 還沒壓縮的 batch；receiver: 解壓縮出來的 batch
+    size_t lz_cap;
+
+    //receiver 端：目前這次 transfer 收到、還沒交出去的 frame
+    long rx_mType;
+    char *rx_data;
+    size_t rx_len;
+    size_t rx_off;
+    int rx_lz;              // rx_data 是解壓縮到 lz_buf 的 batch，transfer 本身已經還給 backend 了
+} mailbox_t;
+
+
+typedef struct {
+    /*  TODO: 
+        Message structure for wrapper
+    */
+    long mType; // 訊息類別：有兩種 1. msgsnd() 和 2. msgrcv()
+    size_t msgLen; // payload 實際長度，傳輸時只搬這麼多 byte (可以是 binary，不依賴 '\0')
+    size_t msgCap; // msgText buffer 的大小，receive() 放不下時會自動 realloc
+    char *msgText; // 實際內容；receive() 會在 msgText[msgLen] 補 '\0' 方便當字串印
+    const char *msgRef; // receive(): 不是 NULL 時內容直接在共享檔案 (或 arena) 的 mapping 裡 (zero-copy)，msgText 沒有內容
+    uint64_t msgSlot;   // receive(): FRAME_ARENA 的 block 在 arena 裡的 offset + 1，用完要 mailbox_release()；0 = 不是
+} message_t;
+
+//receive() 收到的內容：zero-copy 的訊息在 msgRef，一般的在 msgText (msgRef 的內容沒有補 '\0')
+static inline const char *message_data(const message_t *message)
+{
+    return message->msgRef ? message->msgRef : message->msgText;
+}
+
+//第 i 條 lane 的 mailbox (lane 0 是 mailbox_ptr 自己)
+static inline mailbox_t *mailbox_lane(mailbox_t *mailbox_ptr, int i)
+{
+    return i == 0 ? mailbox_ptr : &mailbox_ptr->lane_box[i - 1];
+}
+
+/*
+    priority class：控制訊息 (shutdown / flush / reload) 和緊急事件不用排在一大堆 bulk 資料後面
+    class 對應到 mType 的區間：class c 的訊息 mType = c * PRIO_SPAN + route (route < PRIO_SPAN)
+        MSG_PASSING：全部在同一個 queue，receiver 用 msgrcv(msgtyp = -PRIO_MTYPE_MAX)，kernel 先給 mType 最小的 (class 越小越優先)
+        其他模式：每個 class 一個獨立的 mailbox (IPC key 用 lane PRIO_LANE + c 分開)，shm / ring 裡就是各自的 ring
+    receiver 的 drain policy (見 mailbox_recv_batch())：每次先把 control / urgent 全部收完，
+        bulk 最多拿 PRIO_BULK_BUDGET 則就回頭再看一次，bulk 一直在流，urgent 最多等一批 bulk 處理完
+    同一個 class 裡照順序；不同 class 之間沒有順序 (urgent 可以超過先送的 bulk)，"exit" 走 bulk 排在資料後面
+*/
+#define PRIO_CONTROL 0
+#define PRIO_URGENT 1
+#define PRIO_BULK 2
+#define MAILBOX_PRIOS 3
+#define PRIO_SPAN 65536L // 一個 class 佔用的 mType 區間大小，route 要比這個小
+#define PRIO_MTYPE_MAX ((long)MAILBOX_PRIOS * PRIO_SPAN)
+#define PRIO_LANE 128    // class mailbox 的 lane 編號從這裡開始，和 stripe 的 lane 分開
+#define PRIO_BULK_BUDGET 32 // receiver 每收這麼多則 bulk 就回頭看一次 control / urgent
+
+//receive() 收到的訊息是哪個 class (只有開 prio 時有意義)
+static inline int message_prio(const message_t *message)
+{
+    return (int)((message->mType - 1) / PRIO_SPAN);
+}
+
+//MSG_PASSING: 一次 msgsnd() 的內容，mText 裡放一個或多個 frame (見 frame.h)
+#define MSGQ_MAX 8192 // Linux 預設的 msgmax，一次 msgsnd() 最多能送的 byte 數
+struct msgq_buf {
+    long mType;
+    char mText[MSGQ_MAX];
+};
+
+//SHARED_MEM: 共享記憶體區段的配置
+#define SHM_DATA_SIZE 16384
+typedef struct {
+    char flag;      // 原本的 shm[0]：1 = 有新資料，0 = 空的
+    uint32_t len;   // data 裡 frame 的總長度 (一個 batch 可以有很多個 frame)
+    char data[SHM_DATA_SIZE]; // 從 offset 8 開始，frame header 保持對齊
+} shm_box_t;
+#define SHM_SEG_SIZE sizeof(shm_box_t)
+
+#define MAILBOX_PROJ_ID 65 // ftok() 的編號：message queue / SHARED_MEM 區段
+
+const char *mailbox_mode_name(int mode);
+int mailbox_open(mailbox_t *mailbox_ptr, int mode, int role, const char *key_path);
+void mailbox_close(mailbox_t *mailbox_ptr);
+int mailbox_finish(mailbox_t *mailbox_ptr, long *keys, int max);
+
+void mailbox_send(mailbox_t *mailbox_ptr, const message_t *message);
+void mailbox_send_batch(mailbox_t *mailbox_ptr, const message_t *messages, int n);
+void mailbox_send_prio(mailbox_t *mailbox_ptr, const message_t *message, int prio);
+int mailbox_share_file(mailbox_t *mailbox_ptr, const char *path, const char **data, size_t *size);
+void mailbox_send_ref(mailbox_t *mailbox_ptr, long mType, size_t off, size_t len);
+char *mailbox_alloc(mailbox_t *mailbox_ptr, size_t len);
+void mailbox_send_alloc(mailbox_t *mailbox_ptr, long mType, const char *buf, size_t len);
+void mailbox_release(mailbox_t *mailbox_ptr, message_t *message_ptr);
+void mailbox_flush(mailbox_t *mailbox_ptr);
+int mailbox_recv(mailbox_t *mailbox_ptr, message_t *message_ptr, int block);
+int mailbox_recv_batch(mailbox_t *mailbox_ptr, message_t *messages, int n);
+int mailbox_fd(mailbox_t *mailbox_ptr);
+int mailbox_recv_ready(mailbox_t *mailbox_ptr, message_t *messages, int n);
+
+#endif
@@ -0,0 +1,176 @@
+#define _GNU_SOURCE
+#include "place.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
+#define HUGE_PAGE_DEFAULT (2u << 20)
+// <numaif.h> 的 mbind() 要連 libnuma；直接用 syscall，常數和 kernel 的一樣
+#define MPOL_BIND_ 2
+#define MPOL_MF_MOVE_ (1 << 1)
+
+void place_init(place_t *place)
+{
+    place->huge = 0;
+    place->node = -1;
+    place->cpu = -1;
+    place->huge_ok = 0;
+}
+
+int place_parse_int(const char *arg)
+{
+    char *end;
+    long v = strtol(arg, &end, 10);
+    if (end == arg || *end != '\0' || v < 0 || v > 4095)
+        return -1;
+    return (int)v;
+}
+
+//預設的 huge page 大小 (/proc/meminfo 的 Hugepagesize)，讀不到就當 2 MB
+static size_t huge_page_size(void)
+{
+    static size_t size;
+    if (size)
+        return size;
+    size = HUGE_PAGE_DEFAULT;
+    FILE *fp = fopen("/proc/meminfo", "r");
+    if (fp == NULL)
+        return size;
+    char line[128];
+    unsigned long kb;
+    while (fgets(line, sizeof(line), fp))
+        if (sscanf(line, "Hugepagesize: %lu kB", &kb) == 1)
+            size = kb * 1024;
+    fclose(fp);
+    return size;
+}
+
+static size_t round_huge(size_t size)
+{
+    size_t page = huge_page_size();
+    return (size + page - 1) / page * page;
+}
+
+int place_cpu_ok(int cpu)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    if (cpu < 0 || cpu >= CPU_SETSIZE || sched_getaffinity(0, sizeof(set), &set) == -1)
+        return 0;
+    return CPU_ISSET(cpu, &set);
+#else
+    return cpu >= 0;
+#endif
+}
+
+void place_pin(const place_t *place)
+{
+    if (place->cpu < 0)
+        return;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(place->cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) == -1)
+    {
+        perror("sched_setaffinity failed");
+        exit(1);
+    }
+#else
+    fprintf(stderr, "CPU pinning is not supported on this platform, ignoring cpu %d\n", place->cpu);
+#endif
+}
+
+int place_shmget(place_t *place, key_t key, size_t size)
+{
+    place->huge_ok = 0;
+#if defined(__linux__) && defined(SHM_HUGETLB)
+    if (place->huge)
+    {
+        int shmid = shmget(key, round_huge(size), IPC_CREAT | SHM_HUGETLB | 0666);
+        if (shmid != -1)
+        {
+            place->huge_ok = 1;
+            return shmid;
+        }
+        //ENOMEM：沒有預留 huge page (/proc/sys/vm/nr_hugepages)；EPERM：不在 hugetlb_shm_group
+        fprintf(stderr, "SHM_HUGETLB unavailable (%s), using normal pages\n", strerror(errno));
+    }
+#else
+    if (place->huge)
+        fprintf(stderr, "Huge pages are not supported on this platform, using normal pages\n");
+#endif
+    return shmget(key, size, IPC_CREAT | 0666);
+}
+
+int place_memfd(place_t *place, const char *name, size_t *size)
+{
+    place->huge_ok = 0;
+#ifdef __linux__
+    if (place->huge)
+    {
+        //hugetlb 的 page 是 mmap() 時才保留的：先 map 一次看看，沒有預留 huge page 的話 ftruncate 會成功、mmap 才失敗
+        int fd = memfd_create(name, MFD_HUGETLB);
+        size_t huge = round_huge(*size);
+        void *probe = MAP_FAILED;
+        if (fd != -1 && ftruncate(fd, (off_t)huge) == 0)
+            probe = mmap(NULL, huge, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (probe != MAP_FAILED)
+        {
+            munmap(probe, huge);
+            *size = huge;
+            place->huge_ok = 1;
+            return fd;
+        }
+        fprintf(stderr, "MFD_HUGETLB unavailable (%s), using normal pages\n", strerror(errno));
+        if (fd != -1)
+            close(fd);
+    }
+    int fd = memfd_create(name, 0);
+    if (fd != -1 && ftruncate(fd, (off_t)*size) == -1)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+#else
+    (void)name;
+    (void)size;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+void place_bind(place_t *place, void *addr, size_t size)
+{
+    if (place->node < 0)
+        return;
+#if defined(__linux__) && defined(SYS_mbind)
+    unsigned long mask[4096 / (8 * sizeof(unsigned long))] = {0};
+    mask[place->node / (8 * sizeof(unsigned long))] |= 1ul << (place->node % (8 * sizeof(unsigned long)));
+    //huge page 的 mapping 只能整頁設定 policy
+    if (place->huge_ok)
+        size = round_huge(size);
+    //shared memory 的 policy 是跟著區段走的，之後誰第一次碰到 page 都會配在這個 node
+    //綁不上 (node 不存在、kernel 沒開 NUMA) 只印警告，node 改成 -1 讓 benchmark 報告實際的狀況
+    if (syscall(SYS_mbind, addr, size, MPOL_BIND_, mask, (unsigned long)(8 * sizeof(mask)), MPOL_MF_MOVE_) == -1)
+    {
+        fprintf(stderr, "mbind to node %d failed (%s), memory is not bound\n", place->node, strerror(errno));
+        place->node = -1;
+    }
+#else
+    (void)addr;
+    (void)size;
+    fprintf(stderr, "NUMA binding is not supported on this platform, ignoring node %d\n", place->node);
+    place->node = -1;
+#endif
+}
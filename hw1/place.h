@@ -0,0 +1,38 @@
+#ifndef PLACE_H
+#define PLACE_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/*
+    共享區段和 process 放在哪裡：huge page、NUMA node、CPU
+    在雙 socket 的機器上，sender / receiver 跑在不同 socket、或 ring 放在另一個 node 的記憶體，
+    latency 會差很多；ring 很大時一般 4 KB page 的 TLB miss 也很明顯
+    每個 process 自己的設定，不放在 shared memory；沒有要求的項目保持 OS 預設
+    只有 Linux 支援，其他平台要求了會印警告、照一般方式執行
+*/
+typedef struct {
+    int huge;     // 1 = 共享區段用 huge page (SHM_HUGETLB / MFD_HUGETLB)
+    int node;     // 共享區段綁在這個 NUMA node (mbind)，-1 = 不綁 (綁不上時也會改回 -1)
+    int cpu;      // 這個 process 固定跑在這個 CPU (sched_setaffinity)，-1 = 不 pin
+    int huge_ok;  // 結果：區段真的拿到 huge page (系統沒有預留 huge page 時會退回一般 page)
+} place_t;
+
+void place_init(place_t *place); // 全部都用 OS 預設
+// "3" -> 3；不合法回傳 -1
+int place_parse_int(const char *arg);
+
+// 這個 process 可以跑在 cpu 上 (在目前的 affinity 裡)
+int place_cpu_ok(int cpu);
+// 依照 place->cpu pin 住呼叫的 process
+void place_pin(const place_t *place);
+
+// shmget(IPC_CREAT)：要求 huge page 時先試 SHM_HUGETLB (大小補到 huge page 的倍數)，失敗就退回一般 page
+int place_shmget(place_t *place, key_t key, size_t size);
+// memfd_create()：要求 huge page 時先試 MFD_HUGETLB，ftruncate 到 *size (會被補到 huge page 的倍數)
+int place_memfd(place_t *place, const char *name, size_t *size);
+// 還沒碰過的 mapping 綁到 place->node；page 已經配置了就搬過去
+// 綁不上時只印警告，place->node 改成 -1
+void place_bind(place_t *place, void *addr, size_t size);
+
+#endif
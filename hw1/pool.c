@@ -0,0 +1,179 @@
+#include "pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#define FNV_OFFSET 0xcbf29ce484222325ull
+#define FNV_PRIME  0x100000001b3ull
+
+typedef struct {
+    pool_item_t item;
+    int done; // handler 做完了，等 emit
+} slot_t;
+
+struct pool {
+    pool_handler_t handler;
+    pool_emit_t emit;
+    void *arg;
+    slot_t slot[POOL_WINDOW];
+
+    //seq 的三個位置：emitted <= taken <= submitted，submitted - emitted <= POOL_WINDOW
+    pthread_mutex_t lock;
+    pthread_cond_t work;  // worker 等「有新的訊息」
+    pthread_cond_t ready; // reorder thread 等「最前面那則做完了」
+    pthread_cond_t space; // submit 等「有 slot 空出來」
+    uint64_t submitted, taken, emitted;
+    int closing;
+
+    int workers;
+    pthread_t *worker;
+    pthread_t reorder;
+};
+
+void pool_checksum(pool_item_t *item)
+{
+    uint64_t h = FNV_OFFSET;
+    for (size_t i = 0; i < item->len; i++)
+        h = (h ^ (unsigned char)item->data[i]) * FNV_PRIME;
+    item->sum = h;
+}
+
+static void *worker_main(void *arg)
+{
+    pool_t *pool = arg;
+    pthread_mutex_lock(&pool->lock);
+    for (;;)
+    {
+        while (pool->taken == pool->submitted && !pool->closing)
+            pthread_cond_wait(&pool->work, &pool->lock);
+        if (pool->taken == pool->submitted)
+            break; // closing，而且都領完了
+        slot_t *slot = &pool->slot[pool->taken++ % POOL_WINDOW];
+        pthread_mutex_unlock(&pool->lock);
+
+        pool->handler(&slot->item);
+
+        pthread_mutex_lock(&pool->lock);
+        slot->done = 1;
+        if (slot->item.seq == pool->emitted)
+            pthread_cond_signal(&pool->ready);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+//依照 seq 的順序 emit：最前面那則沒做完就等，後面做完的先留在 slot 裡
+static void *reorder_main(void *arg)
+{
+    pool_t *pool = arg;
+    pthread_mutex_lock(&pool->lock);
+    for (;;)
+    {
+        slot_t *slot = &pool->slot[pool->emitted % POOL_WINDOW];
+        while (!(pool->emitted < pool->submitted && slot->done) && !(pool->closing && pool->emitted == pool->submitted))
+            pthread_cond_wait(&pool->ready, &pool->lock);
+        if (pool->emitted == pool->submitted)
+            break;
+        //emitted 還沒往前，submit 不會覆寫這個 slot，emit 時不用拿 lock
+        pthread_mutex_unlock(&pool->lock);
+        pool->emit(&slot->item, pool->arg);
+        pthread_mutex_lock(&pool->lock);
+        slot->done = 0;
+        pool->emitted++;
+        pthread_cond_signal(&pool->space);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+static void start(pthread_t *thread, void *(*fn)(void *), pool_t *pool)
+{
+    int rc = pthread_create(thread, NULL, fn, pool);
+    if (rc != 0)
+    {
+        errno = rc;
+        perror("pthread_create failed");
+        exit(1);
+    }
+}
+
+pool_t *pool_create(int workers, pool_handler_t handler, pool_emit_t emit, void *arg)
+{
+    pool_t *pool = calloc(1, sizeof(*pool));
+    if (pool == NULL || (pool->worker = calloc((size_t)workers, sizeof(pthread_t))) == NULL)
+    {
+        perror("calloc failed");
+        exit(1);
+    }
+    pool->handler = handler ? handler : pool_checksum;
+    pool->emit = emit;
+    pool->arg = arg;
+    pool->workers = workers;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->ready, NULL);
+    pthread_cond_init(&pool->space, NULL);
+    for (int i = 0; i < workers; i++)
+        start(&pool->worker[i], worker_main, pool);
+    start(&pool->reorder, reorder_main, pool);
+    return pool;
+}
+
+void pool_submit(pool_t *pool, const char *data, size_t len)
+{
+    pthread_mutex_lock(&pool->lock);
+    while (pool->submitted - pool->emitted == POOL_WINDOW)
+        pthread_cond_wait(&pool->space, &pool->lock);
+    uint64_t seq = pool->submitted;
+    pthread_mutex_unlock(&pool->lock);
+
+    //這個 slot 已經 emit 過，worker / reorder thread 都不會再碰，複製時不用拿 lock
+    pool_item_t *item = &pool->slot[seq % POOL_WINDOW].item;
+    if (len + 1 > item->cap)
+    {
+        size_t cap = item->cap ? item->cap : 64;
+        while (cap < len + 1)
+            cap *= 2;
+        char *data_new = realloc(item->data, cap);
+        if (data_new == NULL)
+        {
+            perror("realloc failed");
+            exit(1);
+        }
+        item->data = data_new;
+        item->cap = cap;
+    }
+    memcpy(item->data, data, len);
+    item->data[len] = '\0';
+    item->len = len;
+    item->seq = seq;
+    item->sum = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->submitted++;
+    pthread_cond_signal(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void pool_close(pool_t *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->closing = 1;
+    pthread_cond_broadcast(&pool->work);
+    pthread_cond_signal(&pool->ready);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->workers; i++)
+        pthread_join(pool->worker[i], NULL);
+    pthread_join(pool->reorder, NULL);
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work);
+    pthread_cond_destroy(&pool->ready);
+    pthread_cond_destroy(&pool->space);
+    for (int i = 0; i < POOL_WINDOW; i++)
+        free(pool->slot[i].item.data);
+    free(pool->worker);
+    free(pool);
+}
@@ -0,0 +1,44 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+    receiver 的 worker pool：收訊息的 thread 只負責把訊息從 mailbox 拿出來 (pool_submit())，
+    每則訊息的處理 (handler) 交給 N 個 worker thread 平行做，處理完再由 reorder thread 依照收到的順序交出去 (emit)
+    處理訊息很花時間時，transport 的速度就不會被單一個 core 的處理速度卡住
+
+    訊息放在 window 格的 ring 裡：第 seq 則放在 slot[seq % window]
+        worker 依序領還沒處理的 seq，處理的順序不一定，完成的時間也不一定
+        reorder thread 只等 slot[emitted % window] 完成，所以 emit 的順序一定和 submit 一樣
+        最前面那則還沒處理完時，後面的最多只能先做 window 則，submit 會等
+*/
+#define POOL_WINDOW 1024 // 最多同時有幾則訊息在 pool 裡 (還沒 emit)
+
+typedef struct {
+    uint64_t seq;   // 第幾則 (從 0 開始)
+    char *data;     // payload 的複本，handler 可以直接改
+    size_t len;
+    size_t cap;
+    uint64_t sum;   // handler 的結果
+} pool_item_t;
+
+// 處理一則訊息，在 worker thread 上執行，同時會有好幾個在跑
+typedef void (*pool_handler_t)(pool_item_t *item);
+// 依照 seq 的順序交出處理完的訊息，在 reorder thread 上執行 (一次只有一個)
+typedef void (*pool_emit_t)(pool_item_t *item, void *arg);
+
+typedef struct pool pool_t;
+
+// workers 個 worker thread；handler = NULL 用 pool_checksum
+pool_t *pool_create(int workers, pool_handler_t handler, pool_emit_t emit, void *arg);
+// 放進一則訊息 (會複製一份)，window 滿了就等
+void pool_submit(pool_t *pool, const char *data, size_t len);
+// 等所有訊息都處理完、emit 完，再停掉所有 thread
+void pool_close(pool_t *pool);
+
+// 預設的 handler：payload 的 64-bit FNV-1a 放進 item->sum
+void pool_checksum(pool_item_t *item);
+
+#endif
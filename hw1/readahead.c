@@ -0,0 +1,239 @@
+#define _GNU_SOURCE
+#include "readahead.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+#define READAHEAD_BUFS 2 // double buffer
+
+typedef struct {
+    char *data;
+    size_t len;  // 讀到幾個 byte；0 = 檔案結束
+    int err;     // read() 失敗時的 errno
+} chunk_t;
+
+struct readahead {
+    int fd;
+    size_t cap;  // 一個 chunk 的大小
+    chunk_t buf[READAHEAD_BUFS];
+
+    //buf[] 當成兩格的 ring：reader thread 寫 buf[fill % 2]，sender 讀 buf[take % 2]
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t filled; // sender 等「有讀好的 chunk」
+    pthread_cond_t freed;  // reader thread 等「有用完的 chunk」
+    unsigned fill, take;
+    int stop;
+
+    //sender 這邊：目前在切的 chunk，和跨越兩個 chunk 的行
+    chunk_t *cur;
+    size_t pos;
+    char *carry;
+    size_t carry_len, carry_cap;
+    int carry_out; // 上一次回傳的是 carry
+    int eof;
+};
+
+static void *reader_main(void *arg)
+{
+    readahead_t *ra = arg;
+    for (;;)
+    {
+        pthread_mutex_lock(&ra->lock);
+        while (ra->fill - ra->take == READAHEAD_BUFS && !ra->stop)
+            pthread_cond_wait(&ra->freed, &ra->lock);
+        int stop = ra->stop;
+        pthread_mutex_unlock(&ra->lock);
+        if (stop)
+            return NULL;
+
+        //chunk 盡量讀滿 (pipe / 終端機一次可能只給一點)，讀到 EOF 或錯誤就停
+        chunk_t *c = &ra->buf[ra->fill % READAHEAD_BUFS];
+        c->len = 0;
+        c->err = 0;
+        while (c->len < ra->cap)
+        {
+            ssize_t n = read(ra->fd, c->data + c->len, ra->cap - c->len);
+            if (n == -1 && errno == EINTR)
+                continue;
+            if (n == -1)
+                c->err = errno;
+            if (n <= 0)
+                break;
+            c->len += (size_t)n;
+        }
+        int done = c->len == 0 || c->err;
+
+        pthread_mutex_lock(&ra->lock);
+        ra->fill++;
+        pthread_cond_signal(&ra->filled);
+        pthread_mutex_unlock(&ra->lock);
+        if (done)
+            return NULL;
+    }
+}
+
+readahead_t *readahead_open(const char *path, size_t chunk)
+{
+    readahead_t *ra = calloc(1, sizeof(*ra));
+    if (ra == NULL)
+        return NULL;
+    ra->cap = chunk ? chunk : READAHEAD_CHUNK;
+    ra->fd = open(path, O_RDONLY);
+    if (ra->fd == -1)
+    {
+        free(ra);
+        return NULL;
+    }
+    //告訴 kernel 是從頭讀到尾，kernel 自己的 readahead 也會開大一點 (macOS 沒有 posix_fadvise)
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(ra->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    for (int i = 0; i < READAHEAD_BUFS; i++)
+    {
+        ra->buf[i].data = malloc(ra->cap);
+        if (ra->buf[i].data == NULL)
+        {
+            perror("malloc failed");
+            exit(1);
+        }
+    }
+    pthread_mutex_init(&ra->lock, NULL);
+    pthread_cond_init(&ra->filled, NULL);
+    pthread_cond_init(&ra->freed, NULL);
+    int rc = pthread_create(&ra->thread, NULL, reader_main, ra);
+    if (rc != 0)
+    {
+        errno = rc;
+        perror("pthread_create failed");
+        exit(1);
+    }
+    return ra;
+}
+
+//等下一個讀好的 chunk
+static chunk_t *take_chunk(readahead_t *ra)
+{
+    pthread_mutex_lock(&ra->lock);
+    while (ra->fill == ra->take)
+        pthread_cond_wait(&ra->filled, &ra->lock);
+    chunk_t *c = &ra->buf[ra->take % READAHEAD_BUFS];
+    pthread_mutex_unlock(&ra->lock);
+    if (c->err)
+    {
+        errno = c->err;
+        perror("Cannot read input file");
+        exit(1);
+    }
+    return c;
+}
+
+//chunk 用完了，還給 reader thread
+static void release_chunk(readahead_t *ra)
+{
+    pthread_mutex_lock(&ra->lock);
+    ra->take++;
+    pthread_cond_signal(&ra->freed);
+    pthread_mutex_unlock(&ra->lock);
+    ra->cur = NULL;
+}
+
+static void carry_append(readahead_t *ra, const char *data, size_t len)
+{
+    if (ra->carry_len + len > ra->carry_cap)
+    {
+        size_t cap = ra->carry_cap ? ra->carry_cap : 64;
+        while (cap < ra->carry_len + len)
+            cap *= 2;
+        char *carry = realloc(ra->carry, cap);
+        if (carry == NULL)
+        {
+            perror("realloc failed");
+            exit(1);
+        }
+        ra->carry = carry;
+        ra->carry_cap = cap;
+    }
+    memcpy(ra->carry + ra->carry_len, data, len);
+    ra->carry_len += len;
+}
+
+//一整行都在同一個 chunk 裡時直接回傳 chunk 裡的位置 (不複製)；跨 chunk 的行才接到 carry 裡
+ssize_t readahead_line(readahead_t *ra, char **line)
+{
+    //上一次回傳的行可能還指在 cur 裡，所以到這裡才還
+    if (ra->cur && ra->pos == ra->cur->len)
+        release_chunk(ra);
+    //上一次回傳的是 carry，這次重新開始接
+    if (ra->carry_out)
+    {
+        ra->carry_len = 0;
+        ra->carry_out = 0;
+    }
+
+    for (;;)
+    {
+        if (ra->eof)
+            return -1;
+        if (ra->cur == NULL)
+        {
+            ra->cur = take_chunk(ra);
+            ra->pos = 0;
+            if (ra->cur->len == 0)
+            {
+                //檔案結束：沒有 '\n' 的最後一行
+                ra->eof = 1;
+                if (ra->carry_len)
+                {
+                    ra->carry_out = 1;
+                    *line = ra->carry;
+                    return (ssize_t)ra->carry_len;
+                }
+                return -1;
+            }
+        }
+
+        char *start = ra->cur->data + ra->pos;
+        size_t left = ra->cur->len - ra->pos;
+        char *nl = memchr(start, '\n', left);
+        if (nl == NULL)
+        {
+            carry_append(ra, start, left);
+            release_chunk(ra);
+            continue;
+        }
+        size_t len = (size_t)(nl - start);
+        ra->pos += len + 1;
+        if (ra->carry_len == 0)
+        {
+            *line = start;
+            return (ssize_t)len;
+        }
+        carry_append(ra, start, len);
+        ra->carry_out = 1;
+        *line = ra->carry;
+        return (ssize_t)ra->carry_len;
+    }
+}
+
+void readahead_close(readahead_t *ra)
+{
+    pthread_mutex_lock(&ra->lock);
+    ra->stop = 1;
+    pthread_cond_signal(&ra->freed);
+    pthread_mutex_unlock(&ra->lock);
+    pthread_join(ra->thread, NULL);
+
+    pthread_mutex_destroy(&ra->lock);
+    pthread_cond_destroy(&ra->filled);
+    pthread_cond_destroy(&ra->freed);
+    close(ra->fd);
+    for (int i = 0; i < READAHEAD_BUFS; i++)
+        free(ra->buf[i].data);
+    free(ra->carry);
+    free(ra);
+}
@@ -0,0 +1,26 @@
+#ifndef READAHEAD_H
+#define READAHEAD_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/*
+    sender 讀 input 檔的 read-ahead：另一個 thread 專門 read()，和 send() 同時進行
+    兩個 chunk 輪流用 (double buffer)：reader thread 填一個，sender 在另一個裡切行
+    sender 只在兩個 chunk 都還沒讀好時才會等 disk，檔案是冷的 (不在 page cache) 時
+    讀檔的時間會藏在送資料的時間後面，不會直接卡住 sender
+    行的切法和 getline() 一樣：以 '\n' 分行，'\n' 不算在內，最後一行沒有 '\n' 也算一行
+*/
+#define READAHEAD_CHUNK (1u << 20) // 預設一個 chunk 1 MB
+
+typedef struct readahead readahead_t;
+
+// 開啟 path 並啟動 reader thread；chunk = 0 用 READAHEAD_CHUNK；失敗回傳 NULL (errno 有原因)
+readahead_t *readahead_open(const char *path, size_t chunk);
+// 下一行：*line 指向內容 (不含 '\n'，也沒有補 '\0')，下一次呼叫前都有效
+// 回傳長度，檔案結束回傳 -1；讀檔失敗會印錯誤並結束
+ssize_t readahead_line(readahead_t *ra, char **line);
+// 停掉 reader thread、關檔、釋放 buffer
+void readahead_close(readahead_t *ra);
+
+#endif
@@ -1,161 +1,421 @@
 #define _POSIX_C_SOURCE 199309L
 #include "receiver.h"
-#include <time.h>
+#include "sink.h"
+#include "pool.h"
+#include "stripe.h"
+#include "autotune.h"
 #include <unistd.h>
 #include <string.h>
-#include <semaphore.h>
+#include <errno.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
 
 #define BLUE  "\033[1;34m"
 #define RED   "\033[1;31m"
 #define GREEN "\033[1;32m"
 #define RESET "\033[0m"
 
-struct timespec start, end;
-double total_time = 0.0;
+#define RECV_BATCH 64 // main() 每次 receive_batch() 最多拿幾則
+#define EPOLL_BUDGET 16 // -E: 一個 ready 的 mailbox 一輪最多收幾批，收不完下一輪再來
+#define EPOLL_EVENTS 64
 
-sem_t *sender_sem = NULL;
-sem_t *receiver_sem = NULL;
 // message_ptr指向要存放接收結果的訊息結構體。函式會寫進去 
 //mailbox_ptr 指向IPC mailbox 結構體 ，裡面存有message queue ID 或shared memory address
 void receive(message_t *message_ptr, mailbox_t *mailbox_ptr) 
 {
-    //receiver 一開始會被卡住（因為receiver_sem 初始值是0）
-    //當sender 傳送完一封訊息並執行 sem_post(receiver_sem)才會放行 ：目的是避免Receiver提前讀取或是重複讀取
-    sem_wait(receiver_sem); // 等待 sender 通知（不計時）
-
-    if (mailbox_ptr->flag == MSG_PASSING)
-    {
-        clock_gettime(CLOCK_MONOTONIC, &start);
-        /*
-            msgrcv():
-                mailbox->storage.msqid: QueueID
-                message_ptr: 要存放結果的結構（會直接寫入）
-                sizeof(message_ptr->msgText) 要讀取資料的大小
-                1 ->mType 只讀取mType = 1 的訊息
-                0 ->預設阻塞模式（若queue 是空的則等待）
-        
-        */
-        if (msgrcv(mailbox_ptr->storage.msqid, message_ptr, sizeof(message_ptr->msgText), 1, 0) == -1)
+    mailbox_recv(mailbox_ptr, message_ptr, 1);
+}
+
+//一次最多收 n 則訊息：至少等到一則，之後只拿已經送到的 (同一個 batch 或 ring 裡現有的)，不會再等待
+//ring 模式整批收完才 publish 一次 head；回傳實際收到幾則
+int receive_batch(message_t *messages, int n, mailbox_t *mailbox_ptr)
+{
+    return mailbox_recv_batch(mailbox_ptr, messages, n);
+}
+
+//收到的資料要交到哪裡：sink、終端機，或都不印 (-q)；有 pool 時先交給 pool 處理
+typedef struct {
+    sink_t *sink;
+    pool_t *pool;
+    int quiet;
+    int prio;          // -P: 依照 class 處理 control / urgent
+    uint64_t checksum; // -j: 每則訊息 handler 結果依序合起來 (順序不同結果就不同)
+    uint64_t bytes;    // -l: 總共收到幾個 byte
+    autotune_t *tune;  // auto: sender 換 mode 時送的 exit 不是結束，不印
+} output_t;
+
+static void deliver(output_t *out, const char *data, size_t len)
+{
+    if (out->sink)
+        sink_write(out->sink, data, len);
+    else if (!out->quiet)
+        printf(BLUE"Receiving message: "RESET" \"%.*s\"\n", (int)len, data);
+}
+
+//-P 的 control 訊息：目前只有 "flush"，其他的只印出來
+static void control(output_t *out, const char *data, size_t len)
+{
+    if (len == 5 && memcmp(data, "flush", 5) == 0 && out->sink)
+        sink_flush(out->sink);
+    if (!out->quiet && !out->sink)
+        printf(GREEN"Receiving control message: "RESET" \"%.*s\"\n", (int)len, data);
+}
+
+//pool 的 emit：在 reorder thread 上依照收到的順序呼叫
+static void deliver_item(pool_item_t *item, void *arg)
+{
+    output_t *out = arg;
+    out->checksum = (out->checksum ^ item->sum) * 0x100000001b3ull;
+    deliver(out, item->data, item->len);
+}
+
+//處理收到的一則訊息；"exit" 是結束的訊號，不算資料，不寫進 sink，回傳 1
+static int consume(output_t *out, message_t *message)
+{
+    if (message->msgLen == 4 && memcmp(message_data(message), "exit", 4) == 0)
+    {
+        if (!out->quiet && !out->sink && !(out->tune && auto_switching(out->tune)))
+            printf(BLUE"Receiving message: "RESET" \"exit\"\n");
+        return 1;
+    }
+    if (out->prio && message_prio(message) == PRIO_CONTROL)
+    {
+        control(out, message_data(message), message->msgLen);
+        return 0;
+    }
+    if (out->prio && message_prio(message) == PRIO_URGENT && !out->pool && !out->quiet && !out->sink)
+    {
+        printf(RED"Receiving urgent message: "RESET" \"%.*s\"\n", (int)message->msgLen, message_data(message));
+        return 0;
+    }
+    if (out->pool)
+        pool_submit(out->pool, message_data(message), message->msgLen);
+    else
+        deliver(out, message_data(message), message->msgLen);
+    return 0;
+}
+
+#ifdef __linux__
+/*
+    -E: 一個 thread 用 epoll 同時服務 channel 0 .. channels - 1 (每個 sender 用 -C 選自己的 channel)
+    每個 mailbox 有一個可以 epoll 的 fd (見 mailbox_fd())，共享記憶體類的模式用 eventfd doorbell
+    ready 的 mailbox 一次收一批 (mailbox_recv_ready())，一輪最多 EPOLL_BUDGET 批：
+        收到空就表示 doorbell 已經 arm，等下一次 epoll 叫醒；收不完就留在 pending，下一輪 (不睡) 再來，忙的 sender 不會卡住別人
+    每個 channel 收到自己的 "exit" 就移出 epoll，全部都收到才結束；回傳花在收訊息上的時間
+*/
+static double serve_channels(const mailbox_t *config, int mode, int channels, output_t *out,
+                             message_t *messages, FILE *log)
+{
+    mailbox_t *boxes = calloc((size_t)channels, sizeof(mailbox_t));
+    char *pending = calloc((size_t)channels, 1);
+    int ep = epoll_create1(0);
+    if (boxes == NULL || pending == NULL || ep == -1)
+    {
+        perror("epoll setup failed");
+        exit(1);
+    }
+    //照 channel 順序開：每個 channel 的 sender 都要先啟動 (和一般的 receiver 一樣)
+    for (int c = 0; c < channels; c++)
+    {
+        boxes[c] = *config;
+        boxes[c].channel = c;
+        boxes[c].doorbell = 1;
+        mailbox_open(&boxes[c], mode, MAILBOX_RECEIVER, ".");
+        struct epoll_event ev = {.events = EPOLLIN, .data.u32 = (uint32_t)c};
+        if (epoll_ctl(ep, EPOLL_CTL_ADD, mailbox_fd(&boxes[c]), &ev) == -1)
         {
-            perror("msgrcv failed");
+            perror("epoll_ctl failed");
             exit(1);
         }
-        clock_gettime(CLOCK_MONOTONIC, &end);
+        pending[c] = 1; // 開好之前 sender 可能已經送了
     }
-    else if (mailbox_ptr->flag == SHARED_MEM)
+
+    int live = channels, npending = channels;
+    unsigned long long wakeups = 0;
+    while (live > 0)
     {
-        
-        char *shm = mailbox_ptr->storage.shm_addr;
-        clock_gettime(CLOCK_MONOTONIC, &start);
-        //strcpy(message_ptr0>msgText , shm+1): 從共享記憶體第二位元組開始（跳過其標shm[0]） 把文字複製到message_ptr中
-        strcpy(message_ptr->msgText, shm + 1);
-        clock_gettime(CLOCK_MONOTONIC, &end);
-        shm[0] = 0;//表示現在這塊共享記憶體是空的
+        struct epoll_event evs[EPOLL_EVENTS];
+        int n = epoll_wait(ep, evs, EPOLL_EVENTS, npending ? 0 : -1);
+        if (n == -1 && errno != EINTR)
+        {
+            perror("epoll_wait failed");
+            exit(1);
+        }
+        for (int i = 0; i < n; i++)
+            if (!pending[evs[i].data.u32])
+            {
+                pending[evs[i].data.u32] = 1;
+                npending++;
+            }
+        wakeups += n > 0;
+
+        for (int c = 0; c < channels; c++)
+        {
+            if (!pending[c])
+                continue;
+            int batches = 0, got = 0, done = 0;
+            while (!done && batches < EPOLL_BUDGET && (got = mailbox_recv_ready(&boxes[c], messages, RECV_BATCH)) > 0)
+            {
+                batches++;
+                for (int i = 0; i < got; i++)
+                {
+                    done = done || consume(out, &messages[i]);
+                    mailbox_release(&boxes[c], &messages[i]);
+                }
+            }
+            if (done)
+            {
+                epoll_ctl(ep, EPOLL_CTL_DEL, mailbox_fd(&boxes[c]), NULL);
+                fprintf(log, RED"Channel %d: sender exit!\n"RESET, c);
+                live--;
+            }
+            if (done || got == 0)
+            {
+                pending[c] = 0;
+                npending--;
+            }
+        }
     }
 
-    total_time += (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
-    sem_post(sender_sem); // 通知 sender 可以送下一封
+    if (out->pool)
+        pool_close(out->pool);
+    double total = 0;
+    for (int c = 0; c < channels; c++)
+    {
+        total += boxes[c].total_time;
+        mailbox_close(&boxes[c]);
+    }
+    fprintf(log, "Served %d channels from one epoll loop (%llu wakeups)\n", channels, wakeups);
+    close(ep);
+    free(pending);
+    free(boxes);
+    return total;
+}
+#endif
+
+//stripe 的 emit：chunk 依照順序接起來寫進 sink (沒有 -o 就只算 byte 數)
+static void deliver_chunk(uint64_t seq, const char *data, size_t len, void *arg)
+{
+    output_t *out = arg;
+    (void)seq;
+    if (out->sink)
+        sink_append(out->sink, data, len);
+    out->bytes += len;
 }
 
 int main(int argc, char *argv[])
 {
-    if (argc != 2)
+    if (argc < 2)
     {
-        printf("Usage: ./receiver <mode>\n");
+        printf("Usage: ./receiver <mode|auto> [-s spins|auto] [-k key] [-c cpu] [-q] [-o output|-] [-D] [-F none|flush|close] [-j workers] [-l lanes] [-P] [-E channels] [-p] [-U] [-T]\n");
         return 1;
     }
 
+    int tuned = auto_parse(argv[1], NULL) == 0; // auto: 用 sender 量完挑的 mode (見 autotune.h)
     int mode = atoi(argv[1]);
-    mailbox_t mailbox;
-    message_t message;
-    mailbox.flag = mode;
-
-    key_t key = ftok(".", 65);
-    if (key == -1)
-    {
-        perror("ftok failed");
-        exit(1);
-    }
+    mailbox_t mailbox = {0};
+    message_t messages[RECV_BATCH] = {0}; // msgText 由 receive_batch() 第一次收到時配置
 
-    if (mode == MSG_PASSING)
+    //-s: 等待 sender 時先 spin 幾次才睡 (預設 auto 自動調整)
+    //-k: MSG_PASSING 只收這個 mType 的訊息 (預設 1)；0 = 和其他 -k 0 的 receiver 一起分攤 queue 裡所有的訊息
+    //-c: receiver 固定跑在這個 CPU (見 place.h)
+    //-q: 不印每則訊息 (只印開頭的模式和最後的統計)
+    //-o: payload 一則一行寫進這個檔案 ("-" = stdout)，不加顏色和前綴 (見 sink.h)；這時也不會印每則訊息
+    //-D / -F: 寫 -o 的檔案時用 O_DIRECT、什麼時候 fsync
+    //-j: 每則訊息交給 N 個 worker thread 處理 (預設 handler 算 checksum)，再依照順序輸出 (見 pool.h)；0 = 在收訊息的 thread 上直接輸出
+    output_t out = {0};
+    //-l: stripe 模式 (見 stripe.h)，要和 sender 的 -l 一樣；收到的 byte 依照原本的順序寫進 -o
+    //-P: 分 priority class (見 PRIO_*)，要和 sender 的 -P 一起用；control / urgent 先收，MSG_PASSING 時不看 -k
+    //    control 訊息不是資料：不寫進 sink，"flush" = 把 sink 寫出去
+    //-E: 一個 epoll loop 同時收 channel 0 .. N-1 (sender 用 -C 選 channel)，全部的 sender 都送完才結束
+    //-p: SHM_RING 的 fast restart (見 ring.h)：處理完才 ack，離開 / 掛掉時 ring 留著，重新啟動從上一次 ack 的地方接著收
+    //    收到 exit 才移除 ring；-o 的檔案不截斷，接在後面寫
+    //-U: 不接受壓縮過的 batch (sender 的 -L)：登記在共享的 peers 裡，sender 看到就不壓；只有 MSG_PASSING / SHARED_MEM / SHM_MPMC 有 peers
+    //-T: 不發佈計數器到 stats 區段 (預設會發佈，ipcstat 可以看，見 stats.h)
+    int channels = 0;
+    int workers = 0;
+    int striped = 0;
+    const char *output = NULL;
+    int sink_flags = 0;
+    int fsync_flags;
+    spin_init(&mailbox.spin, -1);
+    place_init(&mailbox.place);
+    mailbox.route = 1;
+    mailbox.telemetry = 1;
+    int opt;
+    optind = 2;
+    while ((opt = getopt(argc, argv, "s:k:c:qo:DF:j:l:PE:pUT")) != -1)
     {
-        printf(BLUE"Message Passing\n"RESET);
-        // msgget()建立或取得一個System V Message Queue
-        // key: 透過ftok()產生唯一識別碼
-        // 0666(權限)|IPC_CREAT(若 queue 不存在就建立) :
-        //成功後就把queueID 存進mailbox.storage.msqid裡
-        //這樣Sender use same key to call msgsnd() and Receiver us msgrcv() 就能通訊
-        mailbox.storage.msqid = msgget(key, 0666 | IPC_CREAT);
-        if (mailbox.storage.msqid == -1)
+        if (opt == 'k' && atol(optarg) >= 0)
+            mailbox.route = atol(optarg);
+        else if (opt == 'c' && (mailbox.place.cpu = place_parse_int(optarg)) >= 0)
+            continue;
+        else if (opt == 'q')
+            out.quiet = 1;
+        else if (opt == 'o')
+            output = optarg;
+        else if (opt == 'D')
+            sink_flags |= SINK_DIRECT;
+        else if (opt == 'F' && (fsync_flags = sink_parse_fsync(optarg)) >= 0)
+            sink_flags = (sink_flags & SINK_DIRECT) | fsync_flags;
+        else if (opt == 'P')
+            mailbox.prio = out.prio = 1;
+        else if (opt == 'p')
+            mailbox.persist = 1;
+        else if (opt == 'U')
+            mailbox.no_compress = 1;
+        else if (opt == 'T')
+            mailbox.telemetry = 0;
+        else if (opt == 'E' && atoi(optarg) >= 1 && atoi(optarg) <= 65536)
+            channels = atoi(optarg);
+        else if (opt == 'j' && atoi(optarg) >= 0)
+            workers = atoi(optarg);
+        else if (opt == 'l' && atoi(optarg) >= 1 && atoi(optarg) <= STRIPE_LANES_MAX)
         {
-            perror("msgget failed");
-            exit(1);
+            striped = 1;
+            mailbox.lanes = atoi(optarg);
         }
-    }
-    else if (mode == SHARED_MEM)
-    {
-        printf(BLUE"Shared Memory\n"RESET);
-        // shmget(key , 1025 , 0666| IPC_CREAT)
-        // 建立一塊大小為1025的功用記憶體
-        //第一byte 為旗標，剩下1024 byte 儲存訊息 
-        // shmat()把這塊記憶體掛階到這個process 的位址空間
-        //return pointer to mailbox.storage.shm_addr裡
-        //之後用shm[0] control 同步狀態
-        int shmid = shmget(key, 1025, 0666 | IPC_CREAT);
-        mailbox.storage.shm_addr = (char *)shmat(shmid, NULL, 0);
-        if (mailbox.storage.shm_addr == (char *)-1)
+        else if (opt != 's' || spin_parse(&mailbox.spin, optarg) == -1)
         {
-            perror("shmat failed");
-            exit(1);
+            printf("Usage: ./receiver <mode|auto> [-s spins|auto] [-k key] [-c cpu] [-q] [-o output|-] [-D] [-F none|flush|close] [-j workers] [-l lanes] [-P] [-E channels] [-p] [-U] [-T]\n");
+            return 1;
         }
     }
-    else
+
+    //掛載 sender 建好的 IPC；MSG_PASSING / SHARED_MEM 會等 sender 建好控制區段再開始 (見 mailbox_open())
+    if (!tuned && mailbox_mode_name(mode) == NULL)
     {
-        fprintf(stderr, "Invalid mode. Use 1 for Message Passing, 2 for Shared Memory.\n");
+        fprintf(stderr, "Invalid mode. Use");
+        for (int m = 1; m < MAILBOX_MODES; m++)
+            if (mailbox_mode_name(m))
+                fprintf(stderr, "%s %d for %s", m > 1 ? "," : "", m, mailbox_mode_name(m));
+        fprintf(stderr, ".\n");
         exit(1);
     }
-
-    sender_sem = sem_open("/sender_sem", 0);
-    receiver_sem = sem_open("/receiver_sem", 0);
-    if (sender_sem == SEM_FAILED || receiver_sem == SEM_FAILED)
+    //ack 的是「已經交給 sink」：pool / stripe / 其他 class 的 mailbox 都還有沒交出去的，不能當作處理完
+    if (mailbox.persist && (mode != SHM_RING || striped || channels || workers || mailbox.prio))
     {
-        perror("sem_open failed");
+        fprintf(stderr, "-p needs mode %d without -l, -E, -j or -P\n", SHM_RING);
         exit(1);
     }
-
-    // receiver 啟動後立即通知 sender 可以送第一封
-    sem_post(sender_sem);
-
-    while (1)
+    if (tuned && (striped || channels || mailbox.prio || mailbox.persist))
     {
-        receive(&message, &mailbox);
-        printf(BLUE"Receiving message: "RESET" \"%s\"\n", message.msgText);
-
-        if (strcmp(message.msgText, "exit") == 0)
+        fprintf(stderr, "auto cannot be used with -l, -E, -P or -p\n");
+        exit(1);
+    }
+    if (mailbox.no_compress && !tuned && mode != MSG_PASSING && mode != SHARED_MEM && mode != SHM_MPMC)
+    {
+        fprintf(stderr, "-U needs mode %d, %d or %d\n", MSG_PASSING, SHARED_MEM, SHM_MPMC);
+        exit(1);
+    }
+    if (mailbox.persist)
+        sink_flags |= SINK_APPEND;
+    //payload 寫到 stdout 時，其他的訊息改印到 stderr，stdout 只有資料
+    if (output)
+    {
+        out.sink = sink_open(output, sink_flags);
+        if (!out.sink)
         {
-            printf(RED"Sender exit!\n"RESET);
-            sem_post(sender_sem); // prevent sender stuck
-            break;
+            perror("Cannot open output file.");
+            exit(1);
         }
     }
-
-    printf("Total time taken in receiving msg: %.9f seconds\n", total_time);
-
-    if (mode == SHARED_MEM)
+    FILE *log = output && strcmp(output, "-") == 0 ? stderr : stdout;
+    if (!tuned)
+        fprintf(log, BLUE"%s\n"RESET, mailbox_mode_name(mode));
+    if (channels)
     {
-        shmdt(mailbox.storage.shm_addr);
-        int shmid = shmget(key, 1025, 0666);
-        shmctl(shmid, IPC_RMID, NULL);
+#ifdef __linux__
+        out.pool = workers ? pool_create(workers, pool_checksum, deliver_item, &out) : NULL;
+        double copy = serve_channels(&mailbox, mode, channels, &out, messages, log);
+        if (out.sink)
+            sink_close(out.sink);
+        if (out.pool)
+            fprintf(log, "Checksum (%d workers): %016llx\n", workers, (unsigned long long)out.checksum);
+        fprintf(log, "Total time taken in receiving msg: %.9f seconds\n", copy);
+        for (int i = 0; i < RECV_BATCH; i++)
+            free(messages[i].msgText);
+        return 0;
+#else
+        fprintf(stderr, "-E needs epoll (Linux)\n");
+        exit(1);
+#endif
+    }
+    autotune_t at = {0};
+    if (tuned)
+    {
+        auto_init(&at, &mailbox, MAILBOX_RECEIVER, 0, ".");
+        auto_next(&at, &mailbox);
+        out.tune = &at;
+        fprintf(log, BLUE"Auto: %s\n"RESET, mailbox_mode_name(mailbox.flag));
     }
     else
+        mailbox_open(&mailbox, mode, MAILBOX_RECEIVER, ".");
+    if (mailbox.persist)
+        fprintf(log, "Attached to ring generation %u, %llu messages already processed\n", mailbox.generation,
+                (unsigned long long)mailbox.resumed);
+    //handler 換成別的函式就是別的處理 (parse、轉換...)
+    if (striped)
     {
-        msgctl(mailbox.storage.msqid, IPC_RMID, NULL);
+        uint64_t chunks = stripe_recv(&mailbox, deliver_chunk, &out);
+        if (out.sink)
+            sink_close(out.sink);
+        double copy = 0;
+        for (int i = 0; i < (mailbox.lanes > 1 ? mailbox.lanes : 1); i++)
+            copy += mailbox_lane(&mailbox, i)->total_time;
+        fprintf(log, RED"Received %llu bytes in %llu chunks over %d lane(s)\n"RESET,
+                (unsigned long long)out.bytes, (unsigned long long)chunks, mailbox.lanes > 1 ? mailbox.lanes : 1);
+        fprintf(log, "Total time taken in receiving msg: %.9f seconds\n", copy);
+        mailbox_close(&mailbox);
+        return 0;
     }
+    out.pool = workers ? pool_create(workers, pool_checksum, deliver_item, &out) : NULL;
 
-    sem_close(sender_sem);
-    sem_close(receiver_sem);
-    sem_unlink("/sender_sem");
-    sem_unlink("/receiver_sem");
+    int running = 1;
+    while (running)
+    {
+        //一次拿一整批：sender 用 batch 送過來的訊息不用一則一則等
+        //-p: 下一次 receive 會 ack 上一批，ack 之前先把它們寫出去
+        if (mailbox.persist && out.sink)
+            sink_flush(out.sink);
+        int n = receive_batch(messages, RECV_BATCH, &mailbox);
+        for (int i = 0; i < n; i++)
+        {
+            //arena 裡的訊息處理完 (寫進 sink / 交給 pool 都會複製) 就還給 sender
+            //"exit"：pool 裡的要先全部輸出完
+            int done = consume(&out, &messages[i]);
+            mailbox_release(&mailbox, &messages[i]);
+            //auto: sender 要換 mode 時也是送 exit，換到下一個 mailbox 接著收 (exit 後面不會有別的訊息)
+            if (done && tuned && auto_switching(&at))
+            {
+                auto_next(&at, &mailbox);
+                fprintf(log, BLUE"Auto: switched to %s\n"RESET, mailbox_mode_name(mailbox.flag));
+                break;
+            }
+            if (done)
+            {
+                if (out.pool)
+                    pool_close(out.pool);
+                fprintf(log, RED"Sender exit!\n"RESET);
+                mailbox.persist = 0; // 整個串流結束了，離開時移除 ring
+                running = 0;
+                break;
+            }
+        }
+    }
 
+    if (out.sink)
+        sink_close(out.sink);
+    if (out.pool)
+        fprintf(log, "Checksum (%d workers): %016llx\n", workers, (unsigned long long)out.checksum);
+    fprintf(log, "Total time taken in receiving msg: %.9f seconds\n", at.run_time + mailbox.total_time);
+    for (int i = 0; i < RECV_BATCH; i++)
+        free(messages[i].msgText);
+
+    //receiver 最後離開：通知 sender 不要卡住，並移除 queue / shm / ring / 控制區段
+    mailbox_close(&mailbox);
+    if (tuned)
+        auto_close(&at);
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,316 @@
+#define _GNU_SOURCE
+#include "ring.h"
+#include "copy.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+// sender 端：建立 ring 的 shared memory，把 head/tail 歸零後才寫入 magic
+// cap 是 data 區大小，必須是 2 的次方
+ring_t *ring_create(key_t key, size_t cap, place_t *place)
+{
+    int shmid = place_shmget(place, key, sizeof(ring_t) + cap);
+    if (shmid == -1)
+    {
+        perror("shmget failed");
+        exit(1);
+    }
+    ring_t *ring = (ring_t *)shmat(shmid, NULL, 0);
+    if (ring == (ring_t *)-1)
+    {
+        perror("shmat failed");
+        exit(1);
+    }
+    //還沒碰過任何 page 之前綁 node，下面的初始化就會把 page 配在那個 node
+    place_bind(place, ring, sizeof(ring_t) + cap);
+
+    atomic_store_explicit(&ring->magic, 0, memory_order_relaxed);
+    ring->cap = cap;
+    atomic_store_explicit(&ring->head, 0, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, 0, memory_order_relaxed);
+    ring->tail_cache = 0;
+    ring->head_cache = 0;
+    ring->rhead = 0;
+    ring->wtail = 0;
+    ring->rack = 0;
+    ring->rmsgs = 0;
+    ring->wmsgs = 0;
+    ring->wsafe = 0;
+    ring->nt_min = copy_nt_min(cap);
+    ring->persist = 0;
+    ring->rsplit = 0;
+    ring->rmid = 0;
+    ring->rdrop = 0;
+    atomic_store_explicit(&ring->acked, 0, memory_order_relaxed);
+    atomic_store_explicit(&ring->sent, 0, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail_safe, 0, memory_order_relaxed);
+    atomic_store_explicit(&ring->generation, 1, memory_order_relaxed);
+    fevent_init(&ring->data_ev);
+    fevent_init(&ring->space_ev);
+    // release: receiver 看到 magic 時，上面的初始化一定都已經可見
+    atomic_store_explicit(&ring->magic, RING_MAGIC, memory_order_release);
+    return ring;
+}
+
+// receiver 端：等 sender 把 ring 建好 (segment 存在而且 magic 正確) 再掛載
+// 大小傳 0：直接掛上 sender 建立的區段，不需要知道 sender 用的 cap
+ring_t *ring_attach(key_t key)
+{
+    int shmid;
+    while ((shmid = shmget(key, 0, 0666)) == -1)
+        usleep(1000);
+
+    ring_t *ring = (ring_t *)shmat(shmid, NULL, 0);
+    if (ring == (ring_t *)-1)
+    {
+        perror("shmat failed");
+        exit(1);
+    }
+
+    while (atomic_load_explicit(&ring->magic, memory_order_acquire) != RING_MAGIC)
+        usleep(1000);
+    return ring;
+}
+
+ring_t *ring_reattach(key_t key)
+{
+    int shmid = shmget(key, 0, 0666);
+    if (shmid == -1)
+        return NULL;
+    ring_t *ring = (ring_t *)shmat(shmid, NULL, 0);
+    if (ring == (ring_t *)-1)
+    {
+        perror("shmat failed");
+        exit(1);
+    }
+    //上一個 sender 在初始化到一半時掛掉：當作沒有，重新建立
+    if (atomic_load_explicit(&ring->magic, memory_order_acquire) != RING_MAGIC)
+    {
+        shmdt(ring);
+        return NULL;
+    }
+    return ring;
+}
+
+void ring_detach(ring_t *ring)
+{
+    shmdt(ring);
+}
+
+void ring_destroy(key_t key)
+{
+    int shmid = shmget(key, 0, 0666);
+    if (shmid != -1)
+        shmctl(shmid, IPC_RMID, NULL);
+}
+
+int ring_bytes_valid(size_t cap)
+{
+    return cap >= RING_BYTES_MIN && cap <= (1u << 30) && (cap & (cap - 1)) == 0;
+}
+
+// 限制在 cap/4：就算前面要補 FRAME_PAD，一個 frame 也一定放得進空的 ring
+size_t ring_max_payload(const ring_t *ring)
+{
+    return (ring->cap / 4 - FRAME_HDR_SIZE) & ~(size_t)(FRAME_ALIGN - 1);
+}
+
+// 寫一個 frame 到 wtail (receiver 還看不到)，空間不夠就回傳 -1 (不會等待)
+// 回傳 -1 之前會先 publish 已經寫好的 frame，receiver 才有東西可以讀、騰出空間
+// len 不能超過 ring_max_payload()
+int ring_try_write(ring_t *ring, uint32_t flags, const void *data, size_t len)
+{
+    uint64_t cap = ring->cap;
+    uint64_t tail = ring->wtail;
+    uint64_t off = tail & (cap - 1);
+    size_t need = frame_size(len);
+    // 尾端剩下的連續空間放不下整個 frame 的話，要先用 FRAME_PAD 補滿
+    size_t pad = need > cap - off ? cap - off : 0;
+
+    if (tail + pad + need - ring->head_cache > cap)
+    {
+        ring->head_cache = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (tail + pad + need - ring->head_cache > cap)
+        {
+            ring_publish_tail(ring);
+            return -1;
+        }
+    }
+
+    if (pad)
+    {
+        frame_hdr_t *filler = (frame_hdr_t *)(ring->data + off);
+        filler->len = (uint32_t)(pad - FRAME_HDR_SIZE);
+        filler->flags = FRAME_PAD;
+        tail += pad;
+        off = 0;
+    }
+
+    frame_hdr_t *hdr = (frame_hdr_t *)(ring->data + off);
+    hdr->len = (uint32_t)len;
+    hdr->flags = flags;
+    copy_to_shared(frame_payload(hdr), data, len, ring->nt_min); // 只複製實際的 payload 長度 (kernel 見 copy.h)
+
+    ring->wtail = tail + need;
+    //訊息的最後一個 frame：記下來，publish 時交給 persist 用
+    if (!(flags & FRAME_MORE))
+    {
+        ring->wsafe = ring->wtail;
+        ring->wmsgs += !(flags & (FRAME_ABORT | FRAME_WAKE | FRAME_FILE));
+    }
+    return 0;
+}
+
+typedef struct {
+    ring_t *ring;
+    uint32_t flags;
+    const void *data;
+    size_t len;
+} ring_write_args_t;
+
+static int ring_write_ready(void *arg)
+{
+    ring_write_args_t *w = arg;
+    return ring_try_write(w->ring, w->flags, w->data, w->len) == 0;
+}
+
+//空間不夠時先 spin，再睡在 space_ev 上等 receiver publish head
+void ring_write(ring_t *ring, spin_t *spin, uint32_t flags, const void *data, size_t len)
+{
+    if (ring_try_write(ring, flags, data, len) == 0)
+        return;
+    ring_write_args_t w = {ring, flags, data, len};
+    fevent_await(&ring->space_ev, spin, ring_write_ready, &w);
+}
+
+// 把 wtail 之前寫好的 frame 一次交給 receiver
+void ring_publish_tail(ring_t *ring)
+{
+    // release: receiver 讀到新的 tail 時，frame 內容一定已經寫好
+    if (atomic_load_explicit(&ring->tail, memory_order_relaxed) != ring->wtail)
+    {
+        atomic_store_explicit(&ring->tail, ring->wtail, memory_order_release);
+        //tail 之後才更新：中間掛掉的話重新掛上的 sender 只會多送幾則，不會少送
+        atomic_store_explicit(&ring->tail_safe, ring->wsafe, memory_order_relaxed);
+        atomic_store_explicit(&ring->sent, ring->wmsgs, memory_order_relaxed);
+        fevent_notify(&ring->data_ev);
+    }
+}
+
+// 單一 frame：寫完馬上 publish
+void ring_push(ring_t *ring, spin_t *spin, uint32_t flags, const void *data, size_t len)
+{
+    ring_write(ring, spin, flags, data, len);
+    ring_publish_tail(ring);
+}
+
+// 上一個 sender 沒 publish 的 frame 都不算，從 tail 接著寫
+// tail 停在訊息中間的話，receiver 可能已經收了前面的片段：補一個 FRAME_ABORT 叫它丟掉，整則訊息會從頭重送
+uint64_t ring_resume_writer(ring_t *ring, spin_t *spin)
+{
+    ring->wtail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    ring->head_cache = atomic_load_explicit(&ring->head, memory_order_acquire);
+    ring->wsafe = atomic_load_explicit(&ring->tail_safe, memory_order_relaxed);
+    ring->wmsgs = atomic_load_explicit(&ring->sent, memory_order_relaxed);
+    atomic_fetch_add(&ring->generation, 1);
+    if (ring->wsafe != ring->wtail)
+        ring_push(ring, spin, FRAME_ABORT, "", 0);
+    return ring->wmsgs;
+}
+
+// 看 rhead 上的下一個 frame (不複製、也還不釋放)，ring 是空的就回傳 NULL
+// 讀完之後要呼叫 ring_release()，再用 ring_publish_head() 讓 sender 覆寫這塊空間
+// 回傳 NULL 之前會先 publish head，sender 在等空間的話才不會卡住
+frame_hdr_t *ring_try_peek(ring_t *ring)
+{
+    for (;;)
+    {
+        if (ring->rhead == ring->tail_cache)
+        {
+            ring->tail_cache = atomic_load_explicit(&ring->tail, memory_order_acquire);
+            if (ring->rhead == ring->tail_cache)
+            {
+                //persist：訊息中間等下一個片段，手上沒 ack 的超過半個 ring 時 sender 可能已經放不下 (見 ring.h)
+                if (ring->persist && ring->rmid && ring->rhead - ring->rack > ring->cap / 2)
+                {
+                    ring->rsplit = ring->rhead + 1;
+                    ring->rack = ring->rhead;
+                }
+                ring_publish_head(ring);
+                return NULL;
+            }
+        }
+
+        frame_hdr_t *hdr = (frame_hdr_t *)(ring->data + (ring->rhead & (ring->cap - 1)));
+        if (!(hdr->flags & FRAME_PAD) && !ring->rdrop)
+            return hdr;
+        if (!(hdr->flags & FRAME_PAD))
+            ring->rdrop = (hdr->flags & FRAME_MORE) != 0;
+        ring->rhead += frame_size(hdr->len);
+    }
+}
+
+typedef struct {
+    ring_t *ring;
+    frame_hdr_t *hdr;
+} ring_peek_args_t;
+
+static int ring_peek_ready(void *arg)
+{
+    ring_peek_args_t *p = arg;
+    p->hdr = ring_try_peek(p->ring);
+    return p->hdr != NULL;
+}
+
+//ring 是空的時候先 spin，再睡在 data_ev 上等 sender publish tail
+frame_hdr_t *ring_peek(ring_t *ring, spin_t *spin)
+{
+    ring_peek_args_t p = {ring, ring_try_peek(ring)};
+    if (p.hdr == NULL)
+        fevent_await(&ring->data_ev, spin, ring_peek_ready, &p);
+    return p.hdr;
+}
+
+void ring_release(ring_t *ring, frame_hdr_t *frame)
+{
+    ring->rhead += frame_size(frame->len);
+    ring->rmid = (frame->flags & FRAME_MORE) != 0;
+    ring->rmsgs += !(frame->flags & (FRAME_MORE | FRAME_ABORT | FRAME_WAKE | FRAME_FILE));
+}
+
+// 把 rhead 之前讀完的空間一次還給 sender (persist 時只還到 rack，讀了還沒處理完的要留著)
+void ring_publish_head(ring_t *ring)
+{
+    uint64_t head = ring->persist ? ring->rack : ring->rhead;
+    // release: sender 看到新的 head 時，我們已經讀完這些 frame，可以覆寫
+    if (atomic_load_explicit(&ring->head, memory_order_relaxed) != head)
+    {
+        atomic_store_explicit(&ring->head, head, memory_order_release);
+        fevent_notify(&ring->space_ev);
+    }
+}
+
+// head 停在訊息的邊界上 (rack 只在 ring_ack() 時推進)，上一個 receiver 讀了沒 ack 的從這裡重新收
+// 只有 head 是被迫推到訊息中間的那個位置 (rsplit) 時，要先跳過那則訊息剩下的片段
+uint64_t ring_resume_reader(ring_t *ring)
+{
+    ring->rhead = ring->rack = atomic_load_explicit(&ring->head, memory_order_acquire);
+    ring->tail_cache = ring->rhead;
+    ring->rdrop = ring->rsplit == ring->rhead + 1;
+    ring->rmid = 0;
+    ring->rmsgs = atomic_load_explicit(&ring->acked, memory_order_relaxed);
+    ring->persist = 1;
+    atomic_fetch_add(&ring->generation, 1);
+    return ring->rmsgs;
+}
+
+// head 之後才更新 acked：中間掛掉的話只是少算，不會把沒處理的算進去
+void ring_ack(ring_t *ring)
+{
+    ring->rack = ring->rhead;
+    ring_publish_head(ring);
+    atomic_store_explicit(&ring->acked, ring->rmsgs, memory_order_relaxed);
+}
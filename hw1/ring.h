@@ -0,0 +1,103 @@
+#ifndef RING_H
+#define RING_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "frame.h"
+#include "sync.h"
+
+#define CACHE_LINE 64
+#define RING_BYTES (1u << 20)   // 預設 data 區大小，必須是 2 的次方 (offset 用 & 取餘數)
+#define RING_BYTES_MIN 4096
+#define RING_MAGIC 0x52494e47u  // "RING"：sender 初始化完成之後才寫入
+#define RING_PROJ_ID 66         // ftok() 的編號，和 SHARED_MEM 的 65 分開，避免 shmget 大小不合
+
+/*
+    Single producer / single consumer 的 byte ring，整塊放在 shared memory 裡
+    data 區裡是一個接一個的 frame (見 frame.h)，長度不固定，短訊息只佔用自己需要的空間
+    head: receiver 下一個要讀的 byte offset，只有 receiver 會寫
+    tail: sender 下一個要寫的 byte offset，只有 sender 會寫
+    head/tail 一直遞增不回繞，tail - head 就是目前 ring 裡已使用的 byte 數
+    兩個 index 各自放在獨立的 cache line，避免 sender/receiver 互相 invalidate (false sharing)
+    *_cache 是對方 index 的本地快取，只有在看起來滿/空的時候才去讀對方的 cache line
+    wtail/rhead 是自己私有的游標：batch 裡可以連續寫/讀很多個 frame，最後才 publish 一次 tail/head
+    (ring 滿了或空了要等對方之前，一定會先 publish，避免兩邊互等)
+    等待時先 spin，再用 futex 睡在 data_ev / space_ev 上 (見 sync.h)；publish 時有人在睡才叫醒
+    frame 不會跨過 data 區尾端：放不下時先寫一個 FRAME_PAD 把尾端補滿，再從 0 開始
+
+    persist (fast restart)：ring 的狀態本來就都在區段裡，process 掛掉之後區段還在，新的 process 直接掛回去接著做
+        sender 每次 publish tail 時順便記下 sent (已經 publish 的完整訊息數) 和 tail_safe (最後一則完整訊息的結尾)
+        receiver 開了 persist 時 head 只推到 rack：呼叫端處理完、再來收 (ring_ack()) 才算數，掛掉時沒處理完的會再收一次
+        重新掛上的 sender 從 tail 接著寫，跳過前 sent 則；tail 停在訊息中間 (ring 滿了先 publish 的片段) 就先補一個 FRAME_ABORT
+        重新掛上的 receiver 從 head 接著讀；generation 每次有 process 重新掛上就 +1
+        例外：一則訊息收到一半就佔了半個 ring 以上，sender 的下一個片段可能放不下，只好先把 head 推到訊息中間 (rsplit)
+        這時掛掉的話這則訊息會遺失 (重新掛上的 receiver 跳過剩下的片段)；ring 比最大的訊息大兩倍以上就不會發生
+*/
+struct ring {
+    _Alignas(CACHE_LINE) _Atomic uint32_t magic;
+    _Atomic uint32_t generation; // 建立時是 1，每次有 process 重新掛上 (persist) 就 +1
+    uint64_t cap;               // data 區大小
+
+    _Alignas(CACHE_LINE) _Atomic uint64_t head; // receiver 的 cache line
+    uint64_t tail_cache;
+    uint64_t rhead;
+    uint64_t rack;              // persist: 呼叫端處理完的位置，head 不會超過它
+    uint64_t rmsgs;             // rhead 之前有幾則完整的訊息
+    _Atomic uint64_t acked;     // persist: rack 之前有幾則完整的訊息
+    uint64_t rsplit;            // persist: head 被迫停在訊息中間時的位置 + 1 (0 = 沒有)
+    uint32_t persist;           // receiver 開了 persist
+    uint32_t rmid;              // 上一個 release 的 frame 後面還有片段
+    uint32_t rdrop;             // 重新掛上時 head 在訊息中間：跳過片段直到這則訊息結束
+
+    _Alignas(CACHE_LINE) _Atomic uint64_t tail; // sender 的 cache line
+    uint64_t head_cache;
+    uint64_t wtail;
+    uint64_t wmsgs;             // wtail 之前有幾則完整的訊息
+    uint64_t wsafe;             // wtail 之前最後一則完整訊息的結尾
+    _Atomic uint64_t sent;      // tail 之前有幾則完整的訊息 (publish 時更新)
+    _Atomic uint64_t tail_safe; // tail 之前最後一則完整訊息的結尾
+    uint64_t nt_min;            // payload 這麼長以上用 stream 寫 (copy_nt_min(cap)，0 = 不用)
+
+    _Alignas(CACHE_LINE) fevent_t data_ev;  // receiver 等「ring 有資料」
+    _Alignas(CACHE_LINE) fevent_t space_ev; // sender 等「ring 有空間」
+
+    _Alignas(CACHE_LINE) char data[];
+};
+
+typedef struct ring ring_t;
+
+// place: huge page / NUMA node (見 place.h)，區段在初始化之前就綁好
+ring_t *ring_create(key_t key, size_t cap, place_t *place);
+ring_t *ring_attach(key_t key);
+// persist: 已經有建好的 ring 就掛上去 (不會等)，沒有回傳 NULL
+ring_t *ring_reattach(key_t key);
+void ring_detach(ring_t *ring);
+void ring_destroy(key_t key);
+
+// cap 可以當 ring 的 data 區大小：2 的次方，RING_BYTES_MIN 到 1 GB
+int ring_bytes_valid(size_t cap);
+
+// 單一 frame 最大的 payload，超過就要由呼叫端拆成多個 FRAME_MORE 片段
+size_t ring_max_payload(const ring_t *ring);
+
+// producer：write 只寫到私有的 wtail，publish_tail 之後 receiver 才看得到
+int ring_try_write(ring_t *ring, uint32_t flags, const void *data, size_t len);
+void ring_write(ring_t *ring, spin_t *spin, uint32_t flags, const void *data, size_t len);
+void ring_publish_tail(ring_t *ring);
+void ring_push(ring_t *ring, spin_t *spin, uint32_t flags, const void *data, size_t len);
+// persist: 重新掛上的 sender 從 tail 接著寫，回傳已經 publish 過幾則完整的訊息
+uint64_t ring_resume_writer(ring_t *ring, spin_t *spin);
+
+// consumer：release 只推進私有的 rhead，publish_head 之後 sender 才能覆寫
+frame_hdr_t *ring_try_peek(ring_t *ring);
+frame_hdr_t *ring_peek(ring_t *ring, spin_t *spin);
+void ring_release(ring_t *ring, frame_hdr_t *frame);
+void ring_publish_head(ring_t *ring);
+// persist: receiver 從 head 接著讀 (之後 head 只推到 ring_ack() 的位置)，回傳已經處理完幾則完整的訊息
+uint64_t ring_resume_reader(ring_t *ring);
+// persist: 到目前為止讀過的訊息都處理完了，sender 可以覆寫
+void ring_ack(ring_t *ring);
+
+#endif
@@ -1,9 +1,13 @@
-#define _POSIX_C_SOURCE 199309L
+#define _POSIX_C_SOURCE 200809L
 #include "sender.h"
+#include "ring.h"
+#include "readahead.h"
+#include "stripe.h"
+#include "copy.h"
+#include "autotune.h"
 #include <unistd.h>
-#include <semaphore.h>
-#include <errno.h>
 #include <string.h>
+#include <sys/mman.h>
 
 #define BLUE  "\033[1;34m"
 #define YELLOW "\033[1;33m"
@@ -11,191 +15,344 @@
 #define GREEN "\033[1;32m"
 #define RESET "\033[0m"
 
-struct timespec start, end;
-double total_time = 0.0;
-
-sem_t *sender_sem = NULL;
-sem_t *receiver_sem = NULL;
 //
 void send(message_t message, mailbox_t *mailbox_ptr) // message: message 結構（傳值）傳送要送出的內容 mailbox_ptr: 指向要儲存IPC的設定（queueID or shared memory address）
 
 {
-    // 等待 receiver 訊號（不計時）
-    //sem_wair()會讓sender 在semaphore 值為0 導致stuck
-    //一開始sender initial value 為1 所以第一次會直接通過
-    //接下來要等receiver 收完一封信，sem_post(sender_sem)通之後才會放行
-    sem_wait(sender_sem);
-
-    if (mailbox_ptr->flag == MSG_PASSING)
-    {
-        clock_gettime(CLOCK_MONOTONIC, &start);
-        //msgsnd()參數
-        // mailbox_ptr->storage.msqid : QueueID （由msgget()建立）
-        // &message -> 要傳送的訊息
-        //sizeof(message.msgtText) ->資料的大小
-        // 0 ->預設阻塞模式(會等queue 可用)
-        if (msgsnd(mailbox_ptr->storage.msqid, &message, sizeof(message.msgText), 0) == -1) 
-        {
-            perror("msgsnd failed");
-            exit(1);
-        }
-        clock_gettime(CLOCK_MONOTONIC, &end);
+    //batch / frame 的細節都在 mailbox.c，sender / receiver / ipcbench 共用
+    mailbox_send(mailbox_ptr, &message);
+}
+
+//一次送出 n 則訊息：全部打包進盡量少的 transfer (transfer 放滿才換下一個)，最後一定會 flush
+void send_batch(message_t *messages, int n, mailbox_t *mailbox_ptr)
+{
+    mailbox_send_batch(mailbox_ptr, messages, n);
+}
+
+//把目前累積的 batch 一次交給 receiver
+void send_flush(mailbox_t *mailbox_ptr)
+{
+    mailbox_flush(mailbox_ptr);
+}
+
+//-M: 在 arena 裡配置剛好大小的 block，內容直接寫進去，只送 offset
+static void send_arena(message_t *message, mailbox_t *mailbox_ptr)
+{
+    char *buf = mailbox_alloc(mailbox_ptr, message->msgLen);
+    if (buf == NULL)
+    {
+        fprintf(stderr, "Message of %zu bytes does not fit in the arena (%zu bytes)\n", message->msgLen,
+                mailbox_ptr->arena_bytes);
+        mailbox_ptr->error = 1; // 不在這裡 exit：main 停止讀檔，照常送 exit、移除 IPC (和 batch_message() 一樣)
+        return;
     }
-    else if (mailbox_ptr->flag == SHARED_MEM)
+    copy_to_shared(buf, message->msgText, message->msgLen, copy_nt_min(mailbox_ptr->arena_bytes));
+    mailbox_send_alloc(mailbox_ptr, message->mType, buf, message->msgLen);
+}
+
+//-P: 依照行首的前綴決定 class，前綴拿掉再送 (見 PRIO_*)
+static void send_prio(message_t *message, mailbox_t *mailbox_ptr)
+{
+    int prio = PRIO_BULK;
+    if (message->msgLen >= 2 && memcmp(message->msgText, "!!", 2) == 0)
+        prio = PRIO_CONTROL;
+    else if (message->msgLen >= 1 && message->msgText[0] == '!')
+        prio = PRIO_URGENT;
+    size_t skip = prio == PRIO_CONTROL ? 2 : prio == PRIO_URGENT ? 1 : 0;
+    message->msgText += skip;
+    message->msgLen -= skip;
+    mailbox_send_prio(mailbox_ptr, message, prio);
+}
+
+//-l: 整個檔案當成一串 byte，切成 chunk 分散到每條 lane 平行送 (見 stripe.h)，不分行、不送 exit
+static void send_striped(mailbox_t *mailbox_ptr, const char *filename)
+{
+    struct stat st;
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1 || fstat(fd, &st) == -1)
     {
-        clock_gettime(CLOCK_MONOTONIC, &start);
-        //取出共享記憶體的起始位置
-        //shm[0] =1 有新資料
-        
-        char *shm = mailbox_ptr->storage.shm_addr;
-        shm[0] = 1;
-        //把文字訊息複製進去共享記憶體中（從地2byte開始）
-        strcpy(shm + 1, message.msgText);
-        clock_gettime(CLOCK_MONOTONIC, &end);
+        perror("Cannot open input file.");
+        exit(1);
     }
-    else
+    //每條 lane 的 thread 直接從 page cache 複製進自己的 lane
+    size_t size = (size_t)st.st_size;
+    const char *data = NULL;
+    if (size > 0 && (data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED)
     {
-        fprintf(stderr, "Invalid communication flag.\n");
+        perror("mmap failed");
         exit(1);
     }
+    close(fd);
 
-    sem_post(receiver_sem); // 通知 receiver 可以收
-    total_time += (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    stripe_send(mailbox_ptr, data, size, 0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    double copy = 0;
+    for (int i = 0; i < (mailbox_ptr->lanes > 1 ? mailbox_ptr->lanes : 1); i++)
+        copy += mailbox_lane(mailbox_ptr, i)->total_time;
+    printf(RED "Sent %zu bytes over %d lane(s) in %.6f s (%.1f MB/s)\n" RESET, size,
+           mailbox_ptr->lanes > 1 ? mailbox_ptr->lanes : 1, secs, secs > 0 ? size / secs / 1e6 : 0.0);
+    printf("Total time taken in sending msg: %.9f s\n", copy);
+    if (size > 0)
+        munmap((void *)data, size);
 }
 
 int main(int argc, char *argv[]){
-    if (argc != 3)
+    if (argc < 3)
     {
-        fprintf(stderr, "Usage: %s <mode> <input.txt>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <mode|auto[:m,m,..]> <input.txt> [-b batch_bytes] [-t batch_timeout_us] [-w window] [-s spins|auto] [-k key] [-r subscribers]\n"
+                        "          [-H] [-N node] [-c cpu] [-R ring_bytes] [-Z] [-A chunk_bytes] [-q] [-l lanes] [-P] [-C channel] [-M arena_bytes] [-p] [-I] [-L min_batch_bytes] [-T]\n", argv[0]);
         exit(1);
     }
 
+    //auto: 先量每個 mode，挑最快的 (見 autotune.h)；auto:1,3,8 只量這幾個
+    unsigned candidates = 0;
+    int tuned = auto_parse(argv[1], &candidates) == 0;
     int mode = atoi(argv[1]);
     char *filename = argv[2];
-    mailbox_t mailbox;
-    mailbox.flag = mode;
+    mailbox_t mailbox = {0};
+    mailbox.batch_timeout_us = 1000;
+    mailbox.route = 1;
+    mailbox.telemetry = 1;
+    spin_init(&mailbox.spin, -1);
+    place_init(&mailbox.place);
 
-    // 建立IPC 共用Key 讓 receiver and sencer 都可以找到同一個message queue 或shared memory 
-    // ftok: File to Key ：他會根據「檔案路徑+ 一個編號」產生一個獨一無二的key
-    key_t key = ftok(".", 65);
-    if (key == -1)
+    //-b: 累積到幾個 byte 才送出一次 (預設 0，每則訊息都立刻送)
+    //-t: batch 最多等多久 (微秒) 就送出，避免訊息少的時候一直卡在 batch 裡
+    //-w: MSG_PASSING 最多幾個 batch 可以在 queue 裡還沒被收 (credit window，預設 1 = 一來一回)
+    //-s: 等待對方時先 spin 幾次才睡 (auto = 依照最近的等待時間自動調整)
+    //-k: routing key，這個 sender 的訊息都用這個 mType 送 (預設 1)；MSG_PASSING 的 receiver 用 -k 選要收哪個
+    //-r: SHM_BCAST 先等幾個 receiver 加入才開始送 (預設 1)，晚加入的 receiver 收不到之前的訊息
+    //-H / -N / -c: 共享區段用 huge page、綁在哪個 NUMA node、sender 跑在哪個 CPU (見 place.h)
+    //-R: SHM_RING 的 ring 大小 (2 的次方)，大 ring 搭配 -H 可以減少 TLB miss
+    //-Z: zero-copy，整個檔案 mmap 起來分享給 receiver，每行只送 (offset, length) (見 mailbox_share_file())
+    //-A: read-ahead thread 一次讀多少 byte (預設 1 MB，見 readahead.h)
+    //-q: 不印每則 "Sending message:"
+    //-l: stripe 模式，用幾條 lane (receiver 也要用一樣的 -l)
+    //-C: 送到第幾個 channel (0 ~ 65535)，同時打開 doorbell：receiver 用 -E 在一個 epoll loop 裡收所有的 channel
+    //-M: 建立這麼大的共享 arena，每行直接寫進 arena 裡剛好大小的 block，mailbox 只送 offset (見 arena.h)
+    //-P: 分 priority class (receiver 也要 -P)："!!" 開頭的行是 control、"!" 開頭的是 urgent (前綴不送)，其他是 bulk
+    //-I: 每則訊息加上 CRC32C (見 crc32c.h)，receiver 自動驗證，內容不對就印錯誤並結束
+    //-L: batch 到這麼多 byte 以上就壓縮成一個 FRAME_LZ 再送 (見 lz.h)，receiver 自動解開；每個 receiver 都接受才會壓
+    //    一個 batch 可以組到好幾個 transfer 那麼大，壓完一次送出：要搭配夠大的 -b
+    //-p: SHM_RING 的 fast restart (見 ring.h)：已經有 ring 就掛回去，跳過上一個 sender 已經送出的行，接著送
+    //-T: 不發佈計數器到 stats 區段 (預設會發佈，ipcstat 可以看，見 stats.h)
+    //mode 寫 auto 時 -L 不會量 SHM_RING；-k / -b / -t / -w / -s / -I / -H / -N / -R 每個量的 mode 和正式的都一樣
+    int zero_copy = 0;
+    int striped = 0;
+    int quiet = 0;
+    size_t chunk_bytes = 0;
+    int opt;
+    optind = 3;
+    while ((opt = getopt(argc, argv, "b:t:w:s:k:r:HN:c:R:ZA:ql:PC:M:pIL:T")) != -1)
     {
-        perror("ftok failed");
-        exit(1);
-    }
-
-    // 建立 IPC
-    if (mode == MSG_PASSING) //using System V message queue to send the message
-    {
-        printf(BLUE"Message Passing\n"RESET);
-        //建立一個System V message queue 
-        //key: 由ftok()產生唯一識別碼
-        //IPC_CREAT: 若queue 不存在就建立一個
-        //0666: 權限設定(read and write for everyone)
-        //這樣一來sender and receiver 就可以用相同的key 連線到同一個queue
-        int msqid = msgget(key, IPC_CREAT | 0666);
-        if (msqid == -1)
+        if (opt == 'b')
+            mailbox.batch_bytes = strtoul(optarg, NULL, 10);
+        else if (opt == 't')
+            mailbox.batch_timeout_us = atol(optarg);
+        else if (opt == 'w' && atoi(optarg) > 0)
+            mailbox.window = (unsigned)atoi(optarg);
+        else if (opt == 's' && spin_parse(&mailbox.spin, optarg) == 0)
+            continue;
+        else if (opt == 'k' && atol(optarg) > 0)
+            mailbox.route = atol(optarg);
+        else if (opt == 'r' && atoi(optarg) > 0)
+            mailbox.subscribers = (unsigned)atoi(optarg);
+        else if (opt == 'H')
+            mailbox.place.huge = 1;
+        else if (opt == 'N' && (mailbox.place.node = place_parse_int(optarg)) >= 0)
+            continue;
+        else if (opt == 'c' && (mailbox.place.cpu = place_parse_int(optarg)) >= 0)
+            continue;
+        else if (opt == 'R' && ring_bytes_valid(strtoul(optarg, NULL, 10)))
+            mailbox.ring_bytes = strtoul(optarg, NULL, 10);
+        else if (opt == 'Z')
+            zero_copy = 1;
+        else if (opt == 'q')
+            quiet = 1;
+        else if (opt == 'P')
+            mailbox.prio = 1;
+        else if (opt == 'p')
+            mailbox.persist = 1;
+        else if (opt == 'I')
+            mailbox.integrity = 1;
+        else if (opt == 'T')
+            mailbox.telemetry = 0;
+        else if (opt == 'L' && strtoul(optarg, NULL, 10) > 0)
+            mailbox.compress_min = strtoul(optarg, NULL, 10);
+        else if (opt == 'M' && strtoul(optarg, NULL, 10) > 0)
+            mailbox.arena_bytes = strtoul(optarg, NULL, 10);
+        else if (opt == 'C' && atoi(optarg) >= 0 && atoi(optarg) <= 65535)
         {
-            perror("msgget failed");
-            exit(1);
+            mailbox.channel = atoi(optarg);
+            mailbox.doorbell = 1;
         }
-        //把queue ID 存到mailbox結構裡 之後 msgsnd() 或是 msgrcv() 都會用到它
-        mailbox.storage.msqid = msqid;
-    }
-    else if (mode == SHARED_MEM)
-    {
-        printf(BLUE"Shared Memory\n"RESET);
-        // 建立一個共同記憶體區段(Shared Memory Segment)
-        //key: generate by ftok() , 確保sender / receiver 共用同一塊記憶體
-        //1025: 區段大小(單位是byte)這裡設1025 剛好可以放一個旗標加上一個1024的訊息
-
-        int shmid = shmget(key, 1025, IPC_CREAT | 0666);
-        if (shmid == -1)
+        else if (opt == 'l' && atoi(optarg) >= 1 && atoi(optarg) <= STRIPE_LANES_MAX)
         {
-            perror("shmget failed");
-            exit(1);
+            striped = 1;
+            mailbox.lanes = atoi(optarg);
         }
-        //shmat(): attach shared memory 
-        //這會將剛剛建立的shared memory 區段「掛載」到這個process 的記憶體空間
-        //回傳一個指標(char*)讓程式能直接存取這塊記憶體
-        //shmid: share memory ID
-        //NULL : 讓OS 自動決定要掛在哪
-        //0: 預設模式（read and write）
-        char *shm = (char *)shmat(shmid, NULL, 0);
-        if (shm == (char *)-1)
+        else if (opt == 'A' && strtoul(optarg, NULL, 10) > 0)
+            chunk_bytes = strtoul(optarg, NULL, 10);
+        else
         {
-            perror("shmat failed");
+            fprintf(stderr, "Usage: %s <mode|auto[:m,m,..]> <input.txt> [-b batch_bytes] [-t batch_timeout_us] [-w window] [-s spins|auto] [-k key] [-r subscribers]\n"
+                        "          [-H] [-N node] [-c cpu] [-R ring_bytes] [-Z] [-A chunk_bytes] [-q] [-l lanes] [-P] [-C channel] [-M arena_bytes] [-p] [-I] [-L min_batch_bytes] [-T]\n", argv[0]);
             exit(1);
         }
-        //將指標存取進去mailbox 中
-        mailbox.storage.shm_addr = shm;
-        //init shared memory 的狀態旗標，第一個byte 作為同步旗標
-        // 0 = emty (receiver can wait for new message) 1= there is new message(sender written)
-        shm[0] = 0;
     }
-    else
+
+    //MSG_PASSING 的 class 用 mType 區間分，route 要放得進一個區間
+    if (mailbox.prio && mailbox.route >= PRIO_SPAN)
     {
-        fprintf(stderr, "Invalid mode. Use 1 for Message Passing, 2 for Shared Memory.\n");
+        fprintf(stderr, "Routing key must be below %ld with -P\n", PRIO_SPAN);
         exit(1);
     }
 
+    //重送是用「第幾行」對齊：一行一則訊息、只有一條 ring 才對得起來 (arena 的 offset 也不能跨 sender 用)
+    if (mailbox.persist && (mode != SHM_RING || striped || zero_copy || mailbox.prio || mailbox.arena_bytes))
+    {
+        fprintf(stderr, "-p needs mode %d without -l, -Z, -P or -M\n", SHM_RING);
+        exit(1);
+    }
 
+    //auto 只有一對 sender / receiver，每個 mode 都要能用一樣的設定開
+    if (tuned && (striped || zero_copy || mailbox.prio || mailbox.persist || mailbox.arena_bytes || mailbox.doorbell ||
+                  mailbox.subscribers > 1))
+    {
+        fprintf(stderr, "auto cannot be used with -l, -Z, -P, -p, -M, -C or -r\n");
+        exit(1);
+    }
 
-    // 建立 semaphore（都初始化為 0）
-    //sem_open() 它是POSIX semaphore(命名訊號量)的函式，用來讓兩個不同的process 共享同步機制
-    //語法： sem_t* sem_open(const char name , int oflag , mode_t mode , unsigned int value)
-    //name: semaphore 的名稱(跨程式共用)
-    // O_CREAT 若semaphore 不存在就建立新的 
-    // 0644 : 權限 (user 可讀可寫 ，其他人可讀)
-    // value 初始值（表示目前有多少資源可以用）
-    //在這個程式底下 sender_sem = 1 receiver_sem = 0 代表sender 一開始可以接受訊息因為沒有東西要等，而receiver 要等待sender
-    
-    /*
-        sender 開始 actions: sem_wait(sender_sem) 通過（1->0）
-        sender 傳完訊息 actions : sem_post(receiver_sem) ->receiver_sem = 1 (notify receiver)
-        receiver接收完訊息： sem_post(sender_sem) -> sender_sem =1 （通知sender可以再送)
-        雙方會輪流執行
-    */ 
-    sender_sem = sem_open("/sender_sem", O_CREAT, 0644, 1);
-    receiver_sem = sem_open("/receiver_sem", O_CREAT, 0644, 0);
-    if (sender_sem == SEM_FAILED || receiver_sem == SEM_FAILED)
-    {
-        perror("sem_open failed");
+    //ring 的 frame 直接寫進共享記憶體，沒有整個 batch 一起搬的那一步，沒有東西可以壓
+    if (mailbox.compress_min && (mode == SHM_RING || (tuned && candidates == (1u << SHM_RING))))
+    {
+        fprintf(stderr, "-L is not available in mode %d\n", SHM_RING);
         exit(1);
     }
 
-    FILE *fp = fopen(filename, "r");
-    if (!fp)
+    // 建立 IPC (message queue / shared memory / ring) 和 semaphore，細節見 mailbox_open()
+    //key 由 ftok(".", ...) 產生，receiver 也要在同一個目錄執行
+    if (!tuned && mailbox_mode_name(mode) == NULL)
     {
-        perror("Cannot open input file.");
+        fprintf(stderr, "Invalid mode. Use");
+        for (int m = 1; m < MAILBOX_MODES; m++)
+            if (mailbox_mode_name(m))
+                fprintf(stderr, "%s %d for %s", m > 1 ? "," : "", m, mailbox_mode_name(m));
+        fprintf(stderr, ".\n");
         exit(1);
     }
+    autotune_t at = {0};
+    if (tuned)
+    {
+        auto_init(&at, &mailbox, MAILBOX_SENDER, candidates, ".");
+        auto_start(&at, &mailbox, filename);
+    }
+    else
+    {
+        printf(BLUE"%s\n"RESET, mailbox_mode_name(mode));
+        mailbox_open(&mailbox, mode, MAILBOX_SENDER, ".");
+    }
+    if (mailbox.generation > 1)
+        printf("Reattached to ring generation %u, %llu messages already sent\n", mailbox.generation,
+               (unsigned long long)mailbox.resumed);
+    if (striped)
+    {
+        send_striped(&mailbox, filename);
+        mailbox_close(&mailbox);
+        return 0;
+    }
 
-    char buffer[1024];
-    message_t msg;
-    msg.mType = 1;
+    message_t msg = {0};
+    msg.mType = mailbox.route;
 
-    while (fgets(buffer, sizeof(buffer), fp))
+    if (zero_copy)
     {
-        buffer[strcspn(buffer, "\n")] = '\0';
-        strcpy(msg.msgText, buffer);
-        send(msg, &mailbox);
-        printf(BLUE"Sending message: "RESET"%s\n", msg.msgText);
+        //行的切法和下面的 getline() 一樣：以 '\n' 分行，'\n' 不算在內，最後一行沒有 '\n' 也算一行
+        const char *data;
+        size_t size;
+        if (mailbox_share_file(&mailbox, filename, &data, &size) == -1)
+        {
+            perror("Cannot share input file.");
+            exit(1);
+        }
+        size_t off = 0;
+        while (off < size)
+        {
+            const char *nl = memchr(data + off, '\n', size - off);
+            size_t len = nl ? (size_t)(nl - (data + off)) : size - off;
+            mailbox_send_ref(&mailbox, msg.mType, off, len);
+            if (!quiet)
+                printf(BLUE"Sending message: "RESET"%.*s\n", (int)len, data + off);
+            off += len + (nl != NULL);
+        }
+    }
+    else
+    {
+        //讀檔在另一個 thread (readahead.c)，和 send() 同時進行；一行多長都可以
+        readahead_t *ra = readahead_open(filename, chunk_bytes);
+        if (!ra)
+        {
+            perror("Cannot open input file.");
+            exit(1);
+        }
+        char *line;
+        ssize_t n;
+        uint64_t skip = mailbox.resumed; // -p: 上一個 sender 已經送出的行
+        while ((n = readahead_line(ra, &line)) != -1)
+        {
+            if (skip > 0)
+            {
+                skip--;
+                continue;
+            }
+            msg.msgText = line;
+            msg.msgLen = (size_t)n;
+            if (mailbox.arena)
+                send_arena(&msg, &mailbox);
+            else if (mailbox.prio)
+                send_prio(&msg, &mailbox);
+            else
+                send(msg, &mailbox);
+            if (mailbox.error)
+                break;
+            if (!quiet)
+                printf(BLUE"Sending message: "RESET"%.*s\n", (int)msg.msgLen, msg.msgText);
+            if (tuned)
+                auto_observe(&at, &mailbox, &msg);
+        }
+        readahead_close(ra);
     }
 
-    strcpy(msg.msgText, "exit");
-    send(msg, &mailbox);
-    printf(RED "End of input file! exit!\n" RESET);
-
-    printf("Total time taken in sending msg: %.9f s\n", total_time);
+    //先把自己的資料都送出去，再看要不要送 exit：
+    //有好幾個 sender 時只有最後一個送完的負責，每個 receiver 各送一個 (用 receiver 自己的 routing key)
+    //每個 exit 自己一個 transfer，一個 receiver 才不會一次收到兩個
+    send_flush(&mailbox);
+    long keys[PEERS_MAX];
+    int nkeys = mailbox_finish(&mailbox, keys, PEERS_MAX);
+    msg.msgText = "exit";
+    msg.msgLen = strlen(msg.msgText);
+    for (int i = 0; i < nkeys; i++)
+    {
+        msg.mType = keys[i];
+        send(msg, &mailbox);
+        send_flush(&mailbox);
+    }
+    if (mailbox.error)
+        printf(RED "Stopped before the end of input file! exit!\n" RESET);
+    else
+        printf(RED "End of input file! exit!\n" RESET);
 
-    fclose(fp);
-    if (mode == SHARED_MEM)
-        shmdt(mailbox.storage.shm_addr);
+    if (tuned)
+        printf("Auto: finished on %s, switched %u time(s)\n", mailbox_mode_name(mailbox.flag), at.switches);
+    printf("Total time taken in sending msg: %.9f s\n", at.run_time + mailbox.total_time);
 
-    sem_close(sender_sem);
-    sem_close(receiver_sem);
-    return 0;
+    mailbox_close(&mailbox);
+    if (tuned)
+        auto_close(&at);
+    return mailbox.error ? 1 : 0;
 }
 
 
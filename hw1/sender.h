@@ -1,41 +1,8 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <unistd.h>
-#include <signal.h>
-#include <fcntl.h>
-#include <sys/stat.h>
-#include <sys/types.h>
-#include <sys/ipc.h>
-#include <sys/msg.h>
-#include <sys/shm.h>
-#include <semaphore.h>
-#include <time.h>
-
-//定義兩種通訊模式 (message passing and shared memory mode)
-#define MSG_PASSING 1
-#define SHARED_MEM 2
-
-
-
-typedef struct {
-    int flag;      // 1 for message passing, 2 for shared memory
-    union{
-        int msqid; //for system V api. You can replace it with structure for POSIX api
-        char* shm_addr; // shared memory 的address pointer 
-    }storage;
-} mailbox_t;
-
-
-typedef struct {
-    /*  TODO: 
-        Message structure for wrapper
-    */
-    long mType; // 訊息類別：有兩種 1. msgsnd() 和 2. msgrcv()
-    char msgText[1024]; // 實際文字內容
-} message_t;
+#include "mailbox.h"
 
 void send(message_t message, mailbox_t* mailbox_ptr);
+void send_batch(message_t* messages, int n, mailbox_t* mailbox_ptr);
+void send_flush(mailbox_t* mailbox_ptr);
 
 
 /*
@@ -52,4 +19,4 @@ void send(message_t message, mailbox_t* mailbox_ptr);
         * msgsz: 要讀取的訊息正文大小(不含mtype)
         * msgtyp: 指定要接受哪一種類型的訊息
         * msgflg: 控制其標
-*/
\ No newline at end of file
+*/
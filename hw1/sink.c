@@ -0,0 +1,196 @@
+#define _GNU_SOURCE
+#include "sink.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+
+#define SINK_ALIGN 4096            // O_DIRECT 的 buffer / 長度 / offset 都要對齊 block
+#define SINK_LARGE (SINK_BUFFER / 4) // payload 至少這麼大就不複製進 buffer，直接 writev()
+
+struct sink {
+    int fd;
+    int flags;
+    int own;    // fd 是 sink_open() 開的，sink_close() 要關
+    char *buf;  // SINK_ALIGN 對齊
+    size_t len; // buf 裡還沒寫出去的 byte 數
+};
+
+sink_t *sink_open(const char *path, int flags)
+{
+    sink_t *sink = calloc(1, sizeof(*sink));
+    if (sink == NULL)
+        return NULL;
+    if (posix_memalign((void **)&sink->buf, SINK_ALIGN, SINK_BUFFER) != 0)
+    {
+        perror("posix_memalign failed");
+        exit(1);
+    }
+
+    if (strcmp(path, "-") == 0)
+    {
+        sink->fd = STDOUT_FILENO;
+        flags &= ~SINK_DIRECT;
+    }
+    else
+    {
+        sink->own = 1;
+        sink->fd = -1;
+        //O_DIRECT 的 offset 要對齊 block，接在檔尾 (長度不一定對齊) 寫不了
+        if (flags & SINK_APPEND)
+            flags &= ~SINK_DIRECT;
+        int mode = flags & SINK_APPEND ? O_APPEND : O_TRUNC;
+#ifdef O_DIRECT
+        if (flags & SINK_DIRECT)
+        {
+            sink->fd = open(path, O_WRONLY | O_CREAT | mode | O_DIRECT, 0644);
+            //tmpfs 之類的檔案系統不支援 O_DIRECT
+            if (sink->fd == -1 && errno == EINVAL)
+                fprintf(stderr, "Warning: O_DIRECT is not supported for %s, using buffered writes\n", path);
+        }
+#else
+        if (flags & SINK_DIRECT)
+            fprintf(stderr, "Warning: O_DIRECT is not supported on this platform, using buffered writes\n");
+#endif
+        if (sink->fd == -1)
+        {
+            flags &= ~SINK_DIRECT;
+            sink->fd = open(path, O_WRONLY | O_CREAT | mode, 0644);
+        }
+        if (sink->fd == -1)
+        {
+            free(sink->buf);
+            free(sink);
+            return NULL;
+        }
+    }
+    sink->flags = flags;
+    return sink;
+}
+
+int sink_parse_fsync(const char *arg)
+{
+    if (strcmp(arg, "none") == 0)
+        return 0;
+    if (strcmp(arg, "flush") == 0)
+        return SINK_FSYNC_FLUSH;
+    if (strcmp(arg, "close") == 0)
+        return SINK_FSYNC_CLOSE;
+    return -1;
+}
+
+//writev() 可能只寫了一部分 (pipe 滿了、被 signal 打斷)，把剩下的寫完
+static void write_all(int fd, struct iovec *iov, int n)
+{
+    while (n > 0)
+    {
+        ssize_t w = writev(fd, iov, n);
+        if (w == -1 && errno == EINTR)
+            continue;
+        if (w == -1)
+        {
+            perror("Cannot write output");
+            exit(1);
+        }
+        while (n > 0 && (size_t)w >= iov->iov_len)
+        {
+            w -= (ssize_t)iov->iov_len;
+            iov++;
+            n--;
+        }
+        if (n > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + w;
+            iov->iov_len -= (size_t)w;
+        }
+    }
+}
+
+static void sink_sync(sink_t *sink)
+{
+    if (fsync(sink->fd) == -1 && errno != EINVAL) // pipe / 終端機不能 fsync
+    {
+        perror("fsync failed");
+        exit(1);
+    }
+}
+
+void sink_flush(sink_t *sink)
+{
+    //O_DIRECT 只能寫整塊，不滿一塊的尾巴留在 buffer 開頭等下一次
+    size_t out = sink->flags & SINK_DIRECT ? sink->len & ~(size_t)(SINK_ALIGN - 1) : sink->len;
+    if (out == 0)
+        return;
+    struct iovec iov = {sink->buf, out};
+    write_all(sink->fd, &iov, 1);
+    memmove(sink->buf, sink->buf + out, sink->len - out);
+    sink->len -= out;
+    if (sink->flags & SINK_FSYNC_FLUSH)
+        sink_sync(sink);
+}
+
+//newline = 1 時後面補 '\n'
+static void sink_put(sink_t *sink, const char *data, size_t len, int newline)
+{
+    //很大的 payload：buffer 裡的、payload、'\n' 一次 writev()，payload 不用先複製
+    if (len >= SINK_LARGE && !(sink->flags & SINK_DIRECT))
+    {
+        struct iovec iov[3] = {{sink->buf, sink->len}, {(void *)data, len}, {"\n", 1}};
+        write_all(sink->fd, iov, newline ? 3 : 2);
+        sink->len = 0;
+        if (sink->flags & SINK_FSYNC_FLUSH)
+            sink_sync(sink);
+        return;
+    }
+
+    //payload 比 buffer 還大時 (只有 O_DIRECT 會到這裡) 分段放進去
+    while (len > 0)
+    {
+        size_t room = SINK_BUFFER - sink->len;
+        size_t n = len < room ? len : room;
+        memcpy(sink->buf + sink->len, data, n);
+        sink->len += n;
+        data += n;
+        len -= n;
+        if (sink->len == SINK_BUFFER)
+            sink_flush(sink);
+    }
+    if (!newline)
+        return;
+    if (sink->len == SINK_BUFFER)
+        sink_flush(sink);
+    sink->buf[sink->len++] = '\n';
+}
+
+void sink_write(sink_t *sink, const char *data, size_t len)
+{
+    sink_put(sink, data, len, 1);
+}
+
+void sink_append(sink_t *sink, const char *data, size_t len)
+{
+    sink_put(sink, data, len, 0);
+}
+
+void sink_close(sink_t *sink)
+{
+    sink_flush(sink);
+    //O_DIRECT 剩下不滿一塊的尾巴：關掉 O_DIRECT 再用一般寫入補上
+#ifdef O_DIRECT
+    if (sink->len > 0)
+    {
+        fcntl(sink->fd, F_SETFL, fcntl(sink->fd, F_GETFL) & ~O_DIRECT);
+        sink->flags &= ~SINK_DIRECT;
+        sink_flush(sink);
+    }
+#endif
+    if (sink->flags & (SINK_FSYNC_FLUSH | SINK_FSYNC_CLOSE))
+        sink_sync(sink);
+    if (sink->own)
+        close(sink->fd);
+    free(sink->buf);
+    free(sink);
+}
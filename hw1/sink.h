@@ -0,0 +1,35 @@
+#ifndef SINK_H
+#define SINK_H
+
+#include <stddef.h>
+
+/*
+    receiver 的輸出：收到的 payload 直接寫進檔案 / fd，一則一行，不加顏色和前綴
+    每則訊息一個 printf() 時，終端機或 stdout pipe 很快就變成瓶頸，量到的也不只是 IPC 的時間
+    payload 先累積在一個大 buffer 裡，滿了才一次 write()；很大的 payload 不複製，和 buffer 一起 writev()
+    SINK_DIRECT 用 O_DIRECT 繞過 page cache (buffer 對齊 block，只寫整塊，最後不滿一塊的部分關掉 O_DIRECT 再寫)
+    fsync 的時機由 SINK_FSYNC_FLUSH / SINK_FSYNC_CLOSE 決定，預設不 fsync
+*/
+#define SINK_DIRECT      0x1 // O_DIRECT；檔案系統不支援時印警告，改用一般寫入
+#define SINK_FSYNC_FLUSH 0x2 // 每次把 buffer 寫出去之後 fsync
+#define SINK_FSYNC_CLOSE 0x4 // 關閉前 fsync 一次
+#define SINK_APPEND      0x8 // 不截斷，接在原本的內容後面寫 (不能和 SINK_DIRECT 一起用，會改成一般寫入)
+
+#define SINK_BUFFER (1u << 20) // buffer 大小，也是一次 write() 的大小
+
+typedef struct sink sink_t;
+
+// path = "-" 寫到 stdout；其他的建立 / 截斷成空檔案 (SINK_APPEND 時不截斷)；失敗回傳 NULL (errno 有原因)
+sink_t *sink_open(const char *path, int flags);
+// 寫一則 payload，後面自動補 '\n'；寫入失敗會印錯誤並結束
+void sink_write(sink_t *sink, const char *data, size_t len);
+// 和 sink_write() 一樣，但不補 '\n' (資料本身就是一串 byte，例如 stripe 的 chunk)
+void sink_append(sink_t *sink, const char *data, size_t len);
+// 把 buffer 裡的東西都寫出去 (SINK_DIRECT 時只寫整塊)
+void sink_flush(sink_t *sink);
+// 寫完剩下的、依 flags fsync、關檔 (stdout 不關)
+void sink_close(sink_t *sink);
+// "flush" -> SINK_FSYNC_FLUSH，"close" -> SINK_FSYNC_CLOSE，"none" -> 0；不合法回傳 -1
+int sink_parse_fsync(const char *arg);
+
+#endif
@@ -0,0 +1,105 @@
+#include "stats.h"
+#include "sync.h"
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+stats_t *stats_join(key_t key)
+{
+    int fresh;
+    stats_t *stats = shm_join(key, sizeof(stats_t), STATS_MAGIC, NULL, &fresh);
+    if (fresh)
+    {
+        memset(stats->slot, 0, sizeof(stats->slot));
+        atomic_store_explicit(&stats->magic, STATS_MAGIC, memory_order_release);
+    }
+    return stats;
+}
+
+int stats_alive(const stats_slot_t *slot)
+{
+    int32_t pid = atomic_load_explicit(&slot->pid, memory_order_acquire);
+    return pid != 0 && (kill(pid, 0) == 0 || errno != ESRCH);
+}
+
+//計數器和 pid 以外的欄位歸零 (slot 的主人才會呼叫)
+static void slot_reset(stats_slot_t *slot)
+{
+    atomic_store_explicit(&slot->msgs, 0, memory_order_relaxed);
+    atomic_store_explicit(&slot->bytes, 0, memory_order_relaxed);
+    atomic_store_explicit(&slot->batches, 0, memory_order_relaxed);
+    atomic_store_explicit(&slot->waits, 0, memory_order_relaxed);
+    atomic_store_explicit(&slot->wait_ns, 0, memory_order_relaxed);
+    atomic_store_explicit(&slot->xfer_ns, 0, memory_order_relaxed);
+    atomic_store_explicit(&slot->wait_since, 0, memory_order_relaxed);
+    for (int i = 0; i < STATS_BATCH_BUCKETS; i++)
+        atomic_store_explicit(&slot->batch_hist[i], 0, memory_order_relaxed);
+    for (int i = 0; i < STATS_BUCKETS; i++)
+    {
+        atomic_store_explicit(&slot->wait_hist[i], 0, memory_order_relaxed);
+        atomic_store_explicit(&slot->hold_hist[i], 0, memory_order_relaxed);
+    }
+}
+
+stats_slot_t *stats_claim(stats_t *stats, int role, int mode, int lane)
+{
+    int32_t self = (int32_t)getpid();
+    //先找空位，都滿了再找 process 已經不在的 (當掉沒有 stats_leave())
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int i = 0; i < STATS_SLOTS; i++)
+        {
+            stats_slot_t *slot = &stats->slot[i];
+            int32_t pid = atomic_load(&slot->pid);
+            if (pass == 0 ? pid != 0 : pid == 0 || stats_alive(slot))
+                continue;
+            if (!atomic_compare_exchange_strong(&slot->pid, &pid, self))
+                continue;
+            slot->role = role;
+            slot->mode = mode;
+            slot->lane = lane;
+            slot_reset(slot);
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+void stats_leave(stats_slot_t *slot)
+{
+    slot_reset(slot);
+    atomic_store(&slot->pid, 0);
+}
+
+void stats_detach(stats_t *stats, key_t key)
+{
+    int live = 0;
+    for (int i = 0; i < STATS_SLOTS; i++)
+        live += stats_alive(&stats->slot[i]);
+    shmdt(stats);
+    if (live == 0)
+    {
+        int shmid = shmget(key, 0, 0666);
+        if (shmid != -1)
+            shmctl(shmid, IPC_RMID, NULL);
+    }
+}
+
+stats_t *stats_attach(key_t key, int *shmid)
+{
+    *shmid = shmget(key, 0, 0666);
+    if (*shmid == -1)
+        return NULL;
+    stats_t *stats = shmat(*shmid, NULL, SHM_RDONLY);
+    if (stats == (void *)-1)
+        return NULL;
+    if (atomic_load_explicit(&stats->magic, memory_order_acquire) != STATS_MAGIC)
+    {
+        shmdt(stats);
+        return NULL;
+    }
+    return stats;
+}
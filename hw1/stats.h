@@ -0,0 +1,122 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include "ring.h"
+
+/*
+    telemetry：sender / receiver 把計數器發佈到一塊小的共享區段，ipcstat 掛上去每秒印一次速率 (見 ipcstat.c)
+    每個 mailbox (stripe 的每條 lane、priority 的每個 class 也是) 各佔一個 slot，只有自己會寫：
+        更新是 relaxed 的 load + store (一般的 mov，沒有 lock 前綴)，slot 對齊 cache line，不會和別人 false sharing
+        ipcstat 只讀，速率用兩次讀到的差算
+    計數的地方 (見 mailbox.c)：
+        msgs / bytes         sender 放進 batch、receiver 收到的訊息 (FRAME_REF / FRAME_ARENA 算內容的長度)
+        batches / batch_hist sender 每次 flush、receiver 每次 recv_batch() 交出去幾則 (2 的次方分桶)
+        waits / wait_ns / wait_hist  真的要等對方的時候：sender 等 credit / 空間，receiver 等資料
+                             (semaphore、ring / MPMC / broadcast / arena 的 futex、msgrcv() 睡著)
+                             一開始就不用等的不計時：熱路徑上不會多讀 clock
+                             wait_since 是正在等的這一次從什麼時候開始，ipcstat 把還沒結束的等待也算進去
+        xfer_ns              花在複製 / msgsnd() / msgrcv() 上的時間 (就是 total_time)
+        hold_hist            sender：batch 的第一則訊息放進去，到整個 batch 交給 receiver 花了多久
+    queue depth 不另外記：同一個 mailbox 上 sender 的 msgs 總和 - receiver 的 msgs 總和就是還在路上的訊息
+    區段的 key 和 mailbox 一樣混進 channel，誰先 open 誰建立；最後一個離開的 process 移除
+*/
+#define STATS_MAGIC 0x53544154u // "STAT"
+#define STATS_PROJ_ID 71        // ftok() 的編號，和 ARENA_PROJ_ID 70 分開
+#define STATS_SLOTS 64
+#define STATS_BUCKETS 40        // 時間：bucket i = [2^i, 2^(i+1)) ns，最後一個包含更長的
+#define STATS_BATCH_BUCKETS 16  // 訊息數：bucket i = [2^i, 2^(i+1)) 則
+
+typedef struct stats_slot {
+    _Alignas(CACHE_LINE) _Atomic int32_t pid; // 0 = 空位
+    int32_t role;  // MAILBOX_SENDER / MAILBOX_RECEIVER
+    int32_t mode;
+    int32_t lane;
+    _Atomic uint64_t msgs;
+    _Atomic uint64_t bytes;
+    _Atomic uint64_t batches;
+    _Atomic uint64_t waits;
+    _Atomic uint64_t wait_ns;
+    _Atomic uint64_t xfer_ns;
+    _Atomic uint64_t wait_since; // 0 = 沒在等
+    _Atomic uint64_t batch_hist[STATS_BATCH_BUCKETS];
+    _Atomic uint64_t wait_hist[STATS_BUCKETS];
+    _Atomic uint64_t hold_hist[STATS_BUCKETS];
+} stats_slot_t;
+
+typedef struct stats {
+    _Alignas(CACHE_LINE) _Atomic uint32_t magic;
+    stats_slot_t slot[STATS_SLOTS];
+} stats_t;
+
+// sender / receiver：掛載 (不存在就建立)
+stats_t *stats_join(key_t key);
+// 佔一個 slot (pid 已經不在的 slot 也可以拿來用)；都滿了回傳 NULL，這個 mailbox 就不計數
+stats_slot_t *stats_claim(stats_t *stats, int role, int mode, int lane);
+// 還回 slot，計數器歸零
+void stats_leave(stats_slot_t *slot);
+// detach；已經沒有活著的 slot 就把區段移除
+void stats_detach(stats_t *stats, key_t key);
+// ipcstat：只掛載已經存在的區段，不存在回傳 NULL；*shmid 用來發現區段換了一個新的
+stats_t *stats_attach(key_t key, int *shmid);
+// slot 的 process 還在不在
+int stats_alive(const stats_slot_t *slot);
+
+static inline uint64_t stats_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// 只有 slot 的主人會寫：不用 atomic 的 read-modify-write
+static inline void stats_add(_Atomic uint64_t *counter, uint64_t v)
+{
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + v, memory_order_relaxed);
+}
+
+// v 落在哪個 2 的次方的 bucket (0 和 1 都在 bucket 0)
+static inline int stats_bucket(uint64_t v, int buckets)
+{
+    int b = v ? 63 - __builtin_clzll(v) : 0;
+    return b < buckets ? b : buckets - 1;
+}
+
+static inline void stats_message(stats_slot_t *slot, uint64_t bytes)
+{
+    stats_add(&slot->msgs, 1);
+    stats_add(&slot->bytes, bytes);
+}
+
+static inline void stats_batch(stats_slot_t *slot, uint64_t msgs)
+{
+    stats_add(&slot->batches, 1);
+    stats_add(&slot->batch_hist[stats_bucket(msgs, STATS_BATCH_BUCKETS)], 1);
+}
+
+static inline uint64_t stats_wait_begin(stats_slot_t *slot)
+{
+    uint64_t now = stats_now();
+    atomic_store_explicit(&slot->wait_since, now, memory_order_relaxed);
+    return now;
+}
+
+static inline uint64_t stats_wait_end(stats_slot_t *slot, uint64_t start)
+{
+    uint64_t ns = stats_now() - start;
+    stats_add(&slot->waits, 1);
+    stats_add(&slot->wait_ns, ns);
+    stats_add(&slot->wait_hist[stats_bucket(ns, STATS_BUCKETS)], 1);
+    atomic_store_explicit(&slot->wait_since, 0, memory_order_relaxed);
+    return ns;
+}
+
+static inline void stats_hold(stats_slot_t *slot, uint64_t ns)
+{
+    stats_add(&slot->hold_hist[stats_bucket(ns, STATS_BUCKETS)], 1);
+}
+
+#endif
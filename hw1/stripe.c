@@ -0,0 +1,143 @@
+#include "stripe.h"
+#include <errno.h>
+#include <pthread.h>
+
+typedef struct {
+    mailbox_t *lane;
+    int index;
+    int lanes;
+    const char *data;
+    size_t len;
+    size_t chunk;
+} stripe_tx_t;
+
+//receiver 的 reorder：next 是下一個可以 emit 的 seq
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t turn;
+    uint64_t next;
+    stripe_emit_t emit;
+    void *arg;
+} stripe_order_t;
+
+typedef struct {
+    mailbox_t *lane;
+    stripe_order_t *order;
+    uint64_t chunks;
+} stripe_rx_t;
+
+static void start(pthread_t *thread, void *(*fn)(void *), void *arg)
+{
+    int rc = pthread_create(thread, NULL, fn, arg);
+    if (rc != 0)
+    {
+        errno = rc;
+        perror("pthread_create failed");
+        exit(1);
+    }
+}
+
+//seq 和 chunk 一起放進同一個 batch：chunk 直接從 data 複製進 lane，不經過暫存
+static void send_chunk(mailbox_t *lane, uint64_t seq, const char *data, size_t len)
+{
+    long mType = lane->route ? lane->route : 1;
+    message_t messages[2] = {
+        {.mType = mType, .msgLen = sizeof(seq), .msgText = (char *)&seq},
+        {.mType = mType, .msgLen = len, .msgText = (char *)data},
+    };
+    mailbox_send_batch(lane, messages, 2);
+}
+
+static void *send_lane(void *arg)
+{
+    stripe_tx_t *tx = arg;
+    for (uint64_t k = (uint64_t)tx->index; k * tx->chunk < tx->len; k += (uint64_t)tx->lanes)
+    {
+        size_t off = (size_t)k * tx->chunk;
+        size_t n = tx->len - off < tx->chunk ? tx->len - off : tx->chunk;
+        send_chunk(tx->lane, k, tx->data + off, n);
+    }
+    send_chunk(tx->lane, STRIPE_END, NULL, 0);
+    return NULL;
+}
+
+//lane 0 在呼叫的 thread 上送，其他每條 lane 一個 thread
+void stripe_send(mailbox_t *mailbox_ptr, const char *data, size_t len, size_t chunk)
+{
+    int lanes = mailbox_ptr->lanes > 1 ? mailbox_ptr->lanes : 1;
+    stripe_tx_t tx[STRIPE_LANES_MAX];
+    pthread_t thread[STRIPE_LANES_MAX];
+    for (int i = 0; i < lanes; i++)
+    {
+        tx[i] = (stripe_tx_t){mailbox_lane(mailbox_ptr, i), i, lanes, data, len, chunk ? chunk : STRIPE_CHUNK};
+        if (i > 0)
+            start(&thread[i], send_lane, &tx[i]);
+    }
+    send_lane(&tx[0]);
+    for (int i = 1; i < lanes; i++)
+        pthread_join(thread[i], NULL);
+}
+
+static void *recv_lane(void *arg)
+{
+    stripe_rx_t *rx = arg;
+    stripe_order_t *order = rx->order;
+    message_t seq_msg = {0}, chunk_msg = {0};
+    for (;;)
+    {
+        uint64_t seq;
+        mailbox_recv(rx->lane, &seq_msg, 1);
+        mailbox_recv(rx->lane, &chunk_msg, 1);
+        if (seq_msg.msgLen != sizeof(seq))
+        {
+            fprintf(stderr, "Lane %d: expected a sequence number, got %zu bytes\n", rx->lane->lane, seq_msg.msgLen);
+            exit(1);
+        }
+        memcpy(&seq, message_data(&seq_msg), sizeof(seq));
+        if (seq == STRIPE_END)
+            break;
+
+        //前面的 chunk 在別條 lane 上，等它們先 emit
+        pthread_mutex_lock(&order->lock);
+        while (order->next != seq)
+            pthread_cond_wait(&order->turn, &order->lock);
+        pthread_mutex_unlock(&order->lock);
+
+        order->emit(seq, message_data(&chunk_msg), chunk_msg.msgLen, order->arg);
+        rx->chunks++;
+
+        pthread_mutex_lock(&order->lock);
+        order->next++;
+        pthread_cond_broadcast(&order->turn);
+        pthread_mutex_unlock(&order->lock);
+    }
+    free(seq_msg.msgText);
+    free(chunk_msg.msgText);
+    return NULL;
+}
+
+uint64_t stripe_recv(mailbox_t *mailbox_ptr, stripe_emit_t emit, void *arg)
+{
+    int lanes = mailbox_ptr->lanes > 1 ? mailbox_ptr->lanes : 1;
+    stripe_order_t order = {.next = 0, .emit = emit, .arg = arg};
+    stripe_rx_t rx[STRIPE_LANES_MAX];
+    pthread_t thread[STRIPE_LANES_MAX];
+    pthread_mutex_init(&order.lock, NULL);
+    pthread_cond_init(&order.turn, NULL);
+    for (int i = 0; i < lanes; i++)
+    {
+        rx[i] = (stripe_rx_t){mailbox_lane(mailbox_ptr, i), &order, 0};
+        if (i > 0)
+            start(&thread[i], recv_lane, &rx[i]);
+    }
+    recv_lane(&rx[0]);
+    uint64_t chunks = rx[0].chunks;
+    for (int i = 1; i < lanes; i++)
+    {
+        pthread_join(thread[i], NULL);
+        chunks += rx[i].chunks;
+    }
+    pthread_mutex_destroy(&order.lock);
+    pthread_cond_destroy(&order.turn);
+    return chunks;
+}
@@ -0,0 +1,26 @@
+#ifndef STRIPE_H
+#define STRIPE_H
+
+#include "mailbox.h"
+
+/*
+    stripe：很大的資料分成 chunk，分散到好幾條 lane (mailbox->lanes，每條是一個獨立的 ring / queue) 上平行傳
+    一條 lane 的複製速度受限於一個 core；每條 lane 兩邊各有自己的 thread，複製可以同時在好幾個 core 上做
+        sender: 第 k 個 chunk 走 lane k % lanes，前面先送一則 8 byte 的 seq (同一個 batch)
+        receiver: 每條 lane 的 thread 收到 chunk 之後，等輪到這個 seq 才交給 emit，所以 emit 的順序和資料一樣
+    每條 lane 裡的 seq 是遞增的，最小的那個 seq 一定在某條 lane 的最前面，不會互相卡住
+    結束時每條 lane 各送一個 seq = STRIPE_END 的空 chunk
+*/
+#define STRIPE_LANES_MAX 16
+#define STRIPE_CHUNK (256u << 10) // 預設一個 chunk 256 KB
+#define STRIPE_END UINT64_MAX
+
+// 依照 seq 的順序呼叫 (一次只有一個，在收到那條 lane 的 thread 上)
+typedef void (*stripe_emit_t)(uint64_t seq, const char *data, size_t len, void *arg);
+
+// 把 data 整個切成 chunk 送出去，最後送結束標記；chunk = 0 用 STRIPE_CHUNK
+void stripe_send(mailbox_t *mailbox_ptr, const char *data, size_t len, size_t chunk);
+// 收到每條 lane 都結束為止，回傳收到幾個 chunk
+uint64_t stripe_recv(mailbox_t *mailbox_ptr, stripe_emit_t emit, void *arg);
+
+#endif
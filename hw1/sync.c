@@ -0,0 +1,363 @@
+#define _GNU_SOURCE
+#include "sync.h"
+#include "stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#define SPIN_MIN 16
+#define SHM_INIT_BUSY 1u // shm_join(): 有人正在初始化 (不會和任何 magic 相同)
+
+// 不是 FUTEX_PRIVATE_FLAG：futex word 在跨 process 的 shared memory 裡
+static void futex_wait(_Atomic uint32_t *addr, uint32_t expected)
+{
+#ifdef __linux__
+    syscall(SYS_futex, addr, FUTEX_WAIT, expected, NULL, NULL, 0);
+#else
+    //沒有 futex 的平台 (例如 macOS) 只好讓出 CPU 之後再回去檢查
+    (void)addr;
+    (void)expected;
+    usleep(50);
+#endif
+}
+
+static void futex_wake(_Atomic uint32_t *addr, int count)
+{
+#ifdef __linux__
+    syscall(SYS_futex, addr, FUTEX_WAKE, count, NULL, NULL, 0);
+#else
+    (void)addr;
+    (void)count;
+#endif
+}
+
+void spin_init(spin_t *spin, int spins)
+{
+    //只有一顆 CPU 的時候，spin 的期間對方根本不會執行，直接睡比較快
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    spin->adaptive = spins < 0;
+    spin->stats = NULL;
+    spin->waited = 0;
+    spin->max = cpus > 1 ? (spins < 0 ? SPIN_MAX : (unsigned)spins) : 0;
+    spin->budget = spins < 0 ? SPIN_DEFAULT : (unsigned)spins;
+    if (spin->budget > spin->max)
+        spin->budget = spin->max;
+}
+
+int spin_parse(spin_t *spin, const char *arg)
+{
+    if (strcmp(arg, "auto") == 0)
+    {
+        spin_init(spin, -1);
+        return 0;
+    }
+    char *end;
+    long spins = strtol(arg, &end, 10);
+    if (*end != '\0' || spins < 0 || spins > INT_MAX)
+        return -1;
+    spin_init(spin, (int)spins);
+    return 0;
+}
+
+uint64_t spin_wait_begin(spin_t *spin)
+{
+    return spin->stats ? stats_wait_begin(spin->stats) : 0;
+}
+
+void spin_wait_end(spin_t *spin, uint64_t start)
+{
+    if (spin->stats == NULL)
+        return;
+    if (spin->waited == 0)
+        spin->waited_from = start;
+    spin->waited += stats_wait_end(spin->stats, start);
+}
+
+//spin 了 used 次之後等到 (blocked = 0)，或是最後還是睡著了 (blocked = 1)
+//spin 等得到：budget 往 used 的兩倍靠近；一直要睡：budget 慢慢縮小，少浪費 CPU
+static void spin_update(spin_t *spin, unsigned used, int blocked)
+{
+    if (!spin->adaptive)
+        return;
+    long target = blocked ? spin->budget / 2 : 2L * used;
+    long budget = (long)spin->budget + (target - (long)spin->budget) / 8;
+    if (budget < SPIN_MIN)
+        budget = SPIN_MIN;
+    if (budget > spin->max)
+        budget = spin->max;
+    spin->budget = (unsigned)budget;
+}
+
+void fsem_init(fsem_t *sem, unsigned value)
+{
+    atomic_store(&sem->value, value);
+    atomic_store(&sem->waiters, 0);
+}
+
+int fsem_trywait(fsem_t *sem)
+{
+    uint32_t value = atomic_load_explicit(&sem->value, memory_order_relaxed);
+    while (value > 0)
+    {
+        if (atomic_compare_exchange_weak_explicit(&sem->value, &value, value - 1,
+                                                  memory_order_acquire, memory_order_relaxed))
+            return 0;
+    }
+    return -1;
+}
+
+void fsem_wait(fsem_t *sem, spin_t *spin)
+{
+    //不用等就拿到：不計時
+    if (fsem_trywait(sem) == 0)
+    {
+        spin_update(spin, 0, 0);
+        return;
+    }
+    uint64_t start = spin_wait_begin(spin);
+    for (unsigned i = 1; i < spin->budget; i++)
+    {
+        cpu_relax();
+        if (fsem_trywait(sem) == 0)
+        {
+            spin_update(spin, i, 0);
+            spin_wait_end(spin, start);
+            return;
+        }
+    }
+
+    //先登記 waiters 再檢查 value；post 那邊是先加 value 再看 waiters (都是 seq_cst)
+    //所以不會發生「post 沒看到 waiter、waiter 也沒看到 value」的 lost wakeup
+    atomic_fetch_add(&sem->waiters, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    while (fsem_trywait(sem) == -1)
+        futex_wait(&sem->value, 0);
+    atomic_fetch_sub(&sem->waiters, 1);
+    spin_update(spin, spin->budget, 1);
+    spin_wait_end(spin, start);
+}
+
+void fsem_post(fsem_t *sem)
+{
+    atomic_fetch_add(&sem->value, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(&sem->waiters) > 0)
+        futex_wake(&sem->value, 1);
+}
+
+void fevent_init(fevent_t *ev)
+{
+    atomic_store(&ev->seq, 0);
+    atomic_store(&ev->waiters, 0);
+}
+
+//呼叫前條件已經成立 (例如 tail 已經 publish)
+void fevent_notify(fevent_t *ev)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&ev->waiters, memory_order_relaxed) > 0)
+    {
+        atomic_fetch_add(&ev->seq, 1);
+        futex_wake(&ev->seq, INT_MAX);
+    }
+}
+
+void fevent_await(fevent_t *ev, spin_t *spin, int (*ready)(void *), void *arg)
+{
+    if (ready(arg))
+    {
+        spin_update(spin, 0, 0);
+        return;
+    }
+    uint64_t start = spin_wait_begin(spin);
+    for (unsigned i = 1; i < spin->budget; i++)
+    {
+        cpu_relax();
+        if (ready(arg))
+        {
+            spin_update(spin, i, 0);
+            spin_wait_end(spin, start);
+            return;
+        }
+    }
+
+    //先登記 waiters、記下 seq，再檢查一次條件：notify 如果發生在這之後，seq 一定會變，futex_wait 會馬上回來
+    atomic_fetch_add(&ev->waiters, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    for (;;)
+    {
+        uint32_t key = atomic_load(&ev->seq);
+        if (ready(arg))
+            break;
+        futex_wait(&ev->seq, key);
+    }
+    atomic_fetch_sub(&ev->waiters, 1);
+    spin_update(spin, spin->budget, 1);
+    spin_wait_end(spin, start);
+}
+
+void peers_init(peers_t *peers)
+{
+    atomic_store(&peers->senders, 0);
+    atomic_store(&peers->receivers, 0);
+    atomic_store(&peers->lz_receivers, 0);
+    for (int i = 0; i < PEERS_MAX; i++)
+        atomic_store(&peers->keys[i], 0);
+}
+
+int peers_join(peers_t *peers, int receiver, long key, int lz)
+{
+    if (!receiver)
+    {
+        atomic_fetch_add(&peers->senders, 1);
+        return 0;
+    }
+    for (int i = 0; i < PEERS_MAX; i++)
+    {
+        int64_t empty = 0;
+        if (atomic_compare_exchange_strong(&peers->keys[i], &empty, (int64_t)key + 1))
+        {
+            //先算進 receivers 再算進 lz_receivers：sender 中間看到的是「不是每個都接受」，不會多壓
+            atomic_fetch_add(&peers->receivers, 1);
+            if (lz)
+                atomic_fetch_add(&peers->lz_receivers, 1);
+            return i;
+        }
+    }
+    return -1;
+}
+
+int peers_finish_sender(peers_t *peers, long *keys, int max)
+{
+    if (atomic_fetch_sub(&peers->senders, 1) != 1)
+        return -1;
+    int n = 0;
+    for (int i = 0; i < PEERS_MAX && n < max; i++)
+    {
+        int64_t key = atomic_load(&peers->keys[i]);
+        if (key != 0)
+            keys[n++] = (long)(key - 1);
+    }
+    return n;
+}
+
+unsigned peers_leave_receiver(peers_t *peers, int slot, int lz)
+{
+    if (lz)
+        atomic_fetch_sub(&peers->lz_receivers, 1);
+    atomic_store(&peers->keys[slot], 0);
+    return atomic_fetch_sub(&peers->receivers, 1) - 1;
+}
+
+int peers_lz_ok(peers_t *peers)
+{
+    uint32_t receivers = atomic_load(&peers->receivers);
+    return receivers > 0 && atomic_load(&peers->lz_receivers) == receivers;
+}
+
+void *shm_join(key_t key, size_t size, uint32_t magic, place_t *place, int *fresh)
+{
+    int shmid = place ? place_shmget(place, key, size) : shmget(key, size, IPC_CREAT | 0666);
+    if (shmid == -1)
+    {
+        perror("shmget failed");
+        exit(1);
+    }
+    void *addr = shmat(shmid, NULL, 0);
+    if (addr == (void *)-1)
+    {
+        perror("shmat failed");
+        exit(1);
+    }
+
+    //magic 不對：還沒有人初始化過；只有自己掛著：上一次執行留下來的，重新初始化
+    //magic 對而且還有別人掛著：直接加入
+    //同時啟動的好幾個 process 用 CAS 搶 SHM_INIT_BUSY，只有搶到的那個初始化，其他的等 magic
+    struct shmid_ds ds;
+    _Atomic uint32_t *m = addr;
+    uint32_t seen = atomic_load_explicit(m, memory_order_acquire);
+    int stale = seen == magic && shmctl(shmid, IPC_STAT, &ds) == 0 && ds.shm_nattch == 1;
+    if ((seen != magic && seen != SHM_INIT_BUSY) || stale)
+    {
+        if (atomic_compare_exchange_strong(m, &seen, SHM_INIT_BUSY))
+        {
+            if (place)
+                place_bind(place, addr, size);
+            *fresh = 1;
+            return addr;
+        }
+    }
+    while (atomic_load_explicit(m, memory_order_acquire) != magic)
+        usleep(1000);
+    *fresh = 0;
+    return addr;
+}
+
+void *shm_wait(key_t key, uint32_t magic)
+{
+    int shmid;
+    while ((shmid = shmget(key, 0, 0666)) == -1)
+        usleep(1000);
+
+    void *addr = shmat(shmid, NULL, 0);
+    if (addr == (void *)-1)
+    {
+        perror("shmat failed");
+        exit(1);
+    }
+    while (atomic_load_explicit((_Atomic uint32_t *)addr, memory_order_acquire) != magic)
+        usleep(1000);
+    return addr;
+}
+
+sync_ctl_t *sync_ctl_create(key_t key, unsigned sender_credits)
+{
+    int fresh;
+    sync_ctl_t *ctl = shm_join(key, sizeof(sync_ctl_t), SYNC_MAGIC, NULL, &fresh);
+    if (!fresh)
+        return ctl;
+
+    fsem_init(&ctl->sender_sem, sender_credits);
+    fsem_init(&ctl->receiver_sem, 0);
+    peers_init(&ctl->peers);
+    atomic_store_explicit(&ctl->magic, SYNC_MAGIC, memory_order_release);
+    return ctl;
+}
+
+sync_ctl_t *sync_ctl_attach(key_t key)
+{
+    int shmid;
+    while ((shmid = shmget(key, sizeof(sync_ctl_t), 0666)) == -1)
+        usleep(1000);
+
+    sync_ctl_t *ctl = (sync_ctl_t *)shmat(shmid, NULL, 0);
+    if (ctl == (sync_ctl_t *)-1)
+    {
+        perror("shmat failed");
+        exit(1);
+    }
+    while (atomic_load_explicit(&ctl->magic, memory_order_acquire) != SYNC_MAGIC)
+        usleep(1000);
+    return ctl;
+}
+
+void sync_ctl_detach(sync_ctl_t *ctl)
+{
+    shmdt(ctl);
+}
+
+void sync_ctl_destroy(key_t key)
+{
+    int shmid = shmget(key, sizeof(sync_ctl_t), 0666);
+    if (shmid != -1)
+        shmctl(shmid, IPC_RMID, NULL);
+}
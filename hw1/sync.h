@@ -0,0 +1,119 @@
+#ifndef SYNC_H
+#define SYNC_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "place.h"
+
+/*
+    放在 shared memory 裡的同步元件 (取代 sem_open() 的具名 semaphore)
+    等待時先 busy spin 一小段 (對方通常幾十 ns 內就會好)，還是沒等到才用 futex 睡覺
+    futex word 就在共享區段裡，process 掛掉也不會像 /dev/shm/sem.* 一樣留下垃圾
+    只有真的有人在睡 (waiters > 0) 時，post/notify 才會進 kernel 呼叫 FUTEX_WAKE
+*/
+
+#if defined(__x86_64__) || defined(__i386__)
+#define cpu_relax() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define cpu_relax() __asm__ __volatile__("yield" ::: "memory")
+#else
+#define cpu_relax() ((void)0)
+#endif
+
+#define SPIN_DEFAULT 2000  // adaptive 的起始 spin 次數
+#define SPIN_MAX 20000     // adaptive 最多 spin 這麼多次
+
+struct stats_slot;
+
+// 每個 process (或 thread) 自己的 spin 設定，不放在 shared memory
+typedef struct {
+    unsigned budget;   // 目前睡覺前最多 spin 幾次
+    unsigned max;
+    int adaptive;      // 1: 依照最近是 spin 等到還是睡著等到，自動調整 budget
+    struct stats_slot *stats; // 不是 NULL：真的要等的時間記在這個 slot (見 stats.h)
+    uint64_t waited;          // stats：上一次 mailbox_add_time() 之後等了多少 ns
+    uint64_t waited_from;     // 其中第一次等待開始的時間
+} spin_t;
+
+// counting semaphore
+typedef struct {
+    _Atomic uint32_t value;
+    _Atomic uint32_t waiters;
+} fsem_t;
+
+// event count：等待「某個條件成立」(ring 有資料 / 有空間)，條件本身由呼叫端檢查
+typedef struct {
+    _Atomic uint32_t seq;
+    _Atomic uint32_t waiters;
+} fevent_t;
+
+void spin_init(spin_t *spin, int spins); // spins < 0 表示 adaptive
+int spin_parse(spin_t *spin, const char *arg); // "auto" 或固定次數
+// 一開始沒拿到、真的要等的時候才呼叫：有 spin->stats 才讀 clock，wait_end 把等了多久記進 slot
+uint64_t spin_wait_begin(spin_t *spin);
+void spin_wait_end(spin_t *spin, uint64_t start);
+
+void fsem_init(fsem_t *sem, unsigned value);
+void fsem_wait(fsem_t *sem, spin_t *spin);
+int fsem_trywait(fsem_t *sem);
+void fsem_post(fsem_t *sem);
+
+void fevent_init(fevent_t *ev);
+void fevent_notify(fevent_t *ev);
+// 等到 ready(arg) 回傳非 0 為止：先 spin，再 futex wait
+void fevent_await(fevent_t *ev, spin_t *spin, int (*ready)(void *), void *arg);
+
+/*
+    MSG_PASSING / SHARED_MEM 的交握 semaphore，放在一塊小的控制區段
+    sender 建立並設定初始值，最後才寫 magic；receiver 等到 magic 正確才開始用
+*/
+#define SYNC_MAGIC 0x53594e43u // "SYNC"
+#define SYNC_PROJ_ID 67
+
+/*
+    同一個 mailbox 上登記了哪些 sender / receiver (N 個 sender、M 個 receiver)
+    receiver 登記自己的 routing key (收哪個 mType，0 = 什麼都收)
+    最後一個送完的 sender 負責送 "exit" 給每個登記過的 receiver
+    receiver 也登記自己能不能解壓縮 (lz_receivers)：每個 receiver 都可以，sender 才會壓縮 batch (見 FRAME_LZ)
+*/
+#define PEERS_MAX 64
+
+typedef struct {
+    _Atomic uint32_t senders;   // 還沒送完的 sender
+    _Atomic uint32_t receivers; // 還沒離開的 receiver
+    _Atomic uint32_t lz_receivers; // 其中接受 FRAME_LZ 的 receiver
+    _Atomic int64_t keys[PEERS_MAX]; // receiver 的 routing key + 1；0 = 空位
+} peers_t;
+
+void peers_init(peers_t *peers);
+// sender 回傳 0；receiver 回傳自己的 slot；receiver 太多回傳 -1；lz = receiver 接受 FRAME_LZ
+int peers_join(peers_t *peers, int receiver, long key, int lz);
+// sender 送完了：還有別的 sender 沒送完回傳 -1；自己是最後一個就把每個 receiver 的 key 放進 keys，回傳 receiver 數
+int peers_finish_sender(peers_t *peers, long *keys, int max);
+// receiver 離開，回傳還剩幾個 receiver
+unsigned peers_leave_receiver(peers_t *peers, int slot, int lz);
+// 目前有 receiver，而且每一個都接受 FRAME_LZ
+int peers_lz_ok(peers_t *peers);
+
+typedef struct {
+    _Atomic uint32_t magic;
+    fsem_t sender_sem;   // sender 還可以送幾個 batch (所有 sender 共用的 credit)
+    fsem_t receiver_sem; // receiver 有幾個 batch 可以收
+    peers_t peers;
+} sync_ctl_t;
+
+// 第一個 sender 建立並設定初始值；後來的 sender 直接加入，不會把別人正在用的 semaphore 歸零
+sync_ctl_t *sync_ctl_create(key_t key, unsigned sender_credits);
+sync_ctl_t *sync_ctl_attach(key_t key);
+void sync_ctl_detach(sync_ctl_t *ctl);
+void sync_ctl_destroy(key_t key);
+
+// 開頭是 _Atomic uint32_t magic 的共享區段：掛載 (不存在就建立)
+// *fresh = 1 表示區段是新的 (或上次當掉留下來、已經沒人掛著)，呼叫端要初始化之後再寫入 magic
+// place 不是 NULL 時，建立區段用 huge page / 綁 NUMA node (見 place.h)
+void *shm_join(key_t key, size_t size, uint32_t magic, place_t *place, int *fresh);
+// 等別人把區段建好 (存在而且 magic 正確) 再掛載，不會初始化：sender 已經送完離開也不會把資料清掉
+void *shm_wait(key_t key, uint32_t magic);
+
+#endif
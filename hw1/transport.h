@@ -0,0 +1,85 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include "mailbox.h"
+#include "copy.h"
+
+/*
+    每種通訊模式 (transport) 是一張 function table，mailbox.c 只透過這張表呼叫 backend
+    新增一種 transport：寫一個 transport_xxx.c 定義 transport_t，再登記到 mailbox.c 的 transports[]
+    send() / receive() 的主迴圈、batch、切 frame、重組訊息都不用改
+
+    frame 層 (put / flush / next / release / publish)：
+        ring 這種 frame 直接寫進共享記憶體的 backend，自己實作這五個
+    transfer 層 (tx_begin / tx_end / rx_begin / rx_end)：
+        一次搬一整塊 batch 的 backend (msgsnd()、write()、mq_send()...) 只要實作這四個，
+        frame 層直接用 XFER_OPS (mailbox.c 的 xfer_*)，batch 最大 mb->tx_cap byte
+*/
+typedef struct transport {
+    const char *name;
+    void (*open)(mailbox_t *mailbox_ptr);  // 依 mailbox_ptr->role 建立或掛載；失敗直接 perror + exit
+    void (*close)(mailbox_t *mailbox_ptr); // receiver 要負責移除 IPC 物件
+    size_t (*max_payload)(mailbox_t *mailbox_ptr); // 單一 frame 最多放多少 payload
+
+    //frame 層
+    void (*put)(mailbox_t *mailbox_ptr, long mType, uint32_t flags, const char *data, size_t len);
+    void (*flush)(mailbox_t *mailbox_ptr);
+    frame_hdr_t *(*next)(mailbox_t *mailbox_ptr, int block);
+    void (*release)(mailbox_t *mailbox_ptr, frame_hdr_t *hdr);
+    void (*publish)(mailbox_t *mailbox_ptr); // receiver 一次 receive 結束時呼叫，可以是 NULL
+    void (*ack)(mailbox_t *mailbox_ptr);     // persist: 之前收到的訊息呼叫端都處理完了 (下一次 receive 開始時呼叫)，可以是 NULL
+
+    //transfer 層
+    char *(*tx_begin)(mailbox_t *mailbox_ptr);          // 回傳這次 batch 要寫在哪裡 (可以等待對方)
+    void (*tx_end)(mailbox_t *mailbox_ptr);             // 把 tx_data[0, tx_len) 交給 receiver
+    int (*rx_begin)(mailbox_t *mailbox_ptr, int block); // 收下一個 batch 到 rx_data / rx_len，沒有就回傳 0
+    void (*rx_end)(mailbox_t *mailbox_ptr);             // batch 裡的 frame 都讀完了，可以是 NULL
+
+    int (*poll_fd)(mailbox_t *mailbox_ptr); // receiver 有資料時會變成可讀的 fd；NULL = 沒有，要用 doorbell (見 mailbox_fd())
+} transport_t;
+
+size_t xfer_max_payload(mailbox_t *mailbox_ptr);
+void xfer_put(mailbox_t *mailbox_ptr, long mType, uint32_t flags, const char *data, size_t len);
+void xfer_flush(mailbox_t *mailbox_ptr);
+frame_hdr_t *xfer_next(mailbox_t *mailbox_ptr, int block);
+void xfer_release(mailbox_t *mailbox_ptr, frame_hdr_t *hdr);
+
+#define XFER_OPS                         \
+    .max_payload = xfer_max_payload,     \
+    .put = xfer_put, .flush = xfer_flush, \
+    .next = xfer_next, .release = xfer_release
+
+//backend 共用的小工具
+key_t mailbox_key(const mailbox_t *mailbox_ptr, int proj_id);
+// 由 key 產生檔案系統上的名字，例如 /tmp/mailbox-41020301.fifo
+void mailbox_path(const mailbox_t *mailbox_ptr, const char *prefix, const char *suffix, char *buf, size_t size);
+// 把 start 到現在的時間加進 total_time
+void mailbox_add_time(mailbox_t *mailbox_ptr, const struct timespec *start);
+// poll_fd：資料本身就在 storage.fd 上的 transport (FIFO / socket / mq)
+int fd_poll_fd(mailbox_t *mailbox_ptr);
+
+/*
+    doorbell：共享記憶體類的 transport 本身沒有 fd 可以 epoll，另外配一個 eventfd 當門鈴
+    receiver 要睡之前 arm (共享的 armed = 1)，sender 每次 flush 之後看到 armed 才 write() eventfd 叫醒它
+    沒人在睡的時候 sender 只多一次 atomic load，不進 kernel
+*/
+void doorbell_open(mailbox_t *mailbox_ptr);
+void doorbell_close(mailbox_t *mailbox_ptr);
+void doorbell_ring(mailbox_t *mailbox_ptr);
+void doorbell_arm(mailbox_t *mailbox_ptr);    // 清掉 eventfd，再 arm；呼叫端之後一定要再檢查一次有沒有資料
+void doorbell_disarm(mailbox_t *mailbox_ptr);
+int doorbell_fd(mailbox_t *mailbox_ptr);
+
+extern const transport_t msgq_transport;
+extern const transport_t shm_transport;
+extern const transport_t ring_transport;
+extern const transport_t fifo_transport;
+extern const transport_t mpmc_transport;
+extern const transport_t bcast_transport;
+#ifdef __linux__
+extern const transport_t unix_transport;
+extern const transport_t mq_transport;
+extern const transport_t efd_transport;
+#endif
+
+#endif
@@ -0,0 +1,222 @@
+#include "transport.h"
+#include "ring.h"
+
+/*
+    SHM_BCAST：一個 sender、多個 receiver 的 broadcast log (pub-sub)，整塊放在 shared memory
+    sender 每個 batch 只寫一次到 slot[tail % slots]，publish tail 之後所有 receiver 都看得到同一份資料
+    每個 receiver 在 reader[] 裡有自己的 cursor (各自獨立的 cache line)，讀完一個 batch 才把 cursor 往前推
+    sender 只會覆寫「每個 receiver 都讀過」的 slot：tail - min(cursor) < slots
+        min(cursor) 在 sender 本地有一份快取，看起來滿了才去掃一遍 reader[]
+    receiver 是 cursor 最慢的那個時，sender 會在 space_ev 上等它 (慢的 subscriber 會拖住 sender)
+    資料在 slot 裡直接讀，不會為每個 receiver 多複製一份
+
+    receiver 加入時從當下的 tail 開始收 (之前的訊息不補)；sender 可以用 subscribers 先等 N 個 receiver 到齊再開始寫
+    sender 建立 (shm_join)，receiver 等建好再掛載 (shm_wait)，最後離開的 receiver 移除區段
+*/
+#define BCAST_MAGIC 0x42434153u // "BCAS"
+#define BCAST_PROJ_ID 69        // ftok() 的編號，和 MPMC_PROJ_ID 68 分開
+#define BCAST_SLOTS 256         // 必須是 2 的次方
+#define BCAST_SLOT_DATA 8192    // 一個 batch 最多幾個 byte
+#define BCAST_READERS 32        // 最多幾個 receiver
+
+typedef struct {
+    uint32_t len; // data 裡 frame 的總長度
+    _Alignas(16) char data[BCAST_SLOT_DATA];
+} bcast_slot_t;
+
+struct bcast {
+    _Alignas(CACHE_LINE) _Atomic uint32_t magic;
+    uint32_t slots;
+    _Atomic uint32_t readers; // 目前登記了幾個 receiver
+
+    _Alignas(CACHE_LINE) _Atomic uint64_t tail; // sender 下一個要寫的位置，只有 sender 會寫
+
+    struct {
+        _Alignas(CACHE_LINE) _Atomic uint64_t cursor; // receiver 下一個要讀的位置 + 1；0 = 空位
+    } reader[BCAST_READERS];
+
+    _Alignas(CACHE_LINE) fevent_t data_ev;  // receiver 等「tail 往前了」
+    _Alignas(CACHE_LINE) fevent_t space_ev; // sender 等「最慢的 receiver 往前了」
+
+    _Alignas(CACHE_LINE) bcast_slot_t slot[];
+};
+
+#define BCAST_BYTES (sizeof(bcast_t) + BCAST_SLOTS * sizeof(bcast_slot_t))
+
+//目前登記的 receiver 裡最慢的 cursor；沒有 receiver 就是 tail (sender 不用等)
+static uint64_t bcast_min_cursor(bcast_t *log)
+{
+    uint64_t min = atomic_load(&log->tail);
+    for (int i = 0; i < BCAST_READERS; i++)
+    {
+        uint64_t c = atomic_load(&log->reader[i].cursor);
+        if (c != 0 && c - 1 < min)
+            min = c - 1;
+    }
+    return min;
+}
+
+typedef struct {
+    bcast_t *log;
+    uint64_t pos;
+    uint64_t *min;
+} bcast_wait_t;
+
+//sender：最慢的 receiver 已經讀完 pos - slots 那一格
+static int bcast_has_space(void *arg)
+{
+    bcast_wait_t *w = arg;
+    *w->min = bcast_min_cursor(w->log);
+    return w->pos - *w->min < w->log->slots;
+}
+
+//receiver：sender 已經 publish 過 pos
+static int bcast_has_data(void *arg)
+{
+    bcast_wait_t *w = arg;
+    return atomic_load_explicit(&w->log->tail, memory_order_acquire) > w->pos;
+}
+
+//receiver 登記一個 cursor，從當下的 tail 開始收
+//登記之後再看一次 tail：sender 在登記之前可能已經覆寫到 cursor 那一格，就換成新的 tail 重來
+static int bcast_subscribe(bcast_t *log, uint64_t *pos)
+{
+    for (int i = 0; i < BCAST_READERS; i++)
+    {
+        uint64_t empty = 0;
+        uint64_t t = atomic_load(&log->tail);
+        if (!atomic_compare_exchange_strong(&log->reader[i].cursor, &empty, t + 1))
+            continue;
+        while (atomic_load(&log->tail) - t >= log->slots)
+        {
+            t = atomic_load(&log->tail);
+            atomic_store(&log->reader[i].cursor, t + 1);
+        }
+        atomic_fetch_add(&log->readers, 1);
+        *pos = t;
+        return i;
+    }
+    return -1;
+}
+
+static void bcast_open(mailbox_t *mailbox_ptr)
+{
+    key_t key = mailbox_key(mailbox_ptr, BCAST_PROJ_ID);
+    mailbox_ptr->tx_cap = BCAST_SLOT_DATA;
+    mailbox_ptr->tx_nt_min = copy_nt_min(BCAST_BYTES);
+    if (mailbox_ptr->role == MAILBOX_RECEIVER)
+    {
+        bcast_t *log = shm_wait(key, BCAST_MAGIC);
+        mailbox_ptr->storage.bcast.log = log;
+        mailbox_ptr->storage.bcast.reader = bcast_subscribe(log, &mailbox_ptr->storage.bcast.pos);
+        if (mailbox_ptr->storage.bcast.reader == -1)
+        {
+            fprintf(stderr, "Too many receivers (max %d)\n", BCAST_READERS);
+            exit(1);
+        }
+        return;
+    }
+
+    //只有一個 sender：區段不是新的 (還有人掛著) 表示另一個 sender 正在用
+    int fresh;
+    bcast_t *log = shm_join(key, BCAST_BYTES, BCAST_MAGIC, &mailbox_ptr->place, &fresh);
+    if (!fresh)
+    {
+        fprintf(stderr, "Another sender is already using this broadcast log\n");
+        exit(1);
+    }
+    log->slots = BCAST_SLOTS;
+    atomic_store_explicit(&log->readers, 0, memory_order_relaxed);
+    atomic_store_explicit(&log->tail, 0, memory_order_relaxed);
+    for (int i = 0; i < BCAST_READERS; i++)
+        atomic_store_explicit(&log->reader[i].cursor, 0, memory_order_relaxed);
+    fevent_init(&log->data_ev);
+    fevent_init(&log->space_ev);
+    atomic_store_explicit(&log->magic, BCAST_MAGIC, memory_order_release);
+    mailbox_ptr->storage.bcast.log = log;
+    mailbox_ptr->storage.bcast.pos = 0;
+    mailbox_ptr->storage.bcast.min = 0;
+
+    //receiver 加入時只從當下的 tail 開始收：先等到齊再寫，前面的訊息才不會有人漏掉
+    while (atomic_load(&log->readers) < (mailbox_ptr->subscribers ? mailbox_ptr->subscribers : 1))
+        usleep(1000);
+}
+
+static void bcast_close(mailbox_t *mailbox_ptr)
+{
+    bcast_t *log = mailbox_ptr->storage.bcast.log;
+    int last = 0;
+    if (mailbox_ptr->role == MAILBOX_RECEIVER)
+    {
+        //cursor 清掉之後 sender 就不會再等這個 receiver
+        atomic_store(&log->reader[mailbox_ptr->storage.bcast.reader].cursor, 0);
+        last = atomic_fetch_sub(&log->readers, 1) == 1;
+        fevent_notify(&log->space_ev);
+    }
+    shmdt(log);
+    if (last)
+    {
+        int shmid = shmget(mailbox_key(mailbox_ptr, BCAST_PROJ_ID), 0, 0666);
+        if (shmid != -1)
+            shmctl(shmid, IPC_RMID, NULL);
+    }
+}
+
+//下一格要等最慢的 receiver 讀完上一圈才能寫
+static char *bcast_tx_begin(mailbox_t *mailbox_ptr)
+{
+    bcast_t *log = mailbox_ptr->storage.bcast.log;
+    uint64_t pos = mailbox_ptr->storage.bcast.pos;
+    if (pos - mailbox_ptr->storage.bcast.min >= log->slots)
+    {
+        bcast_wait_t w = {log, pos, &mailbox_ptr->storage.bcast.min};
+        fevent_await(&log->space_ev, &mailbox_ptr->spin, bcast_has_space, &w);
+    }
+    return log->slot[pos & (log->slots - 1)].data;
+}
+
+static void bcast_tx_end(mailbox_t *mailbox_ptr)
+{
+    bcast_t *log = mailbox_ptr->storage.bcast.log;
+    uint64_t pos = mailbox_ptr->storage.bcast.pos++;
+    log->slot[pos & (log->slots - 1)].len = (uint32_t)mailbox_ptr->tx_len;
+    atomic_store_explicit(&log->tail, pos + 1, memory_order_release);
+    fevent_notify(&log->data_ev);
+}
+
+//自己的 cursor 那一格 sender 寫好了就直接在 slot 裡讀
+static int bcast_rx_begin(mailbox_t *mailbox_ptr, int block)
+{
+    bcast_t *log = mailbox_ptr->storage.bcast.log;
+    bcast_wait_t w = {log, mailbox_ptr->storage.bcast.pos, NULL};
+    if (!bcast_has_data(&w))
+    {
+        if (!block)
+            return 0;
+        fevent_await(&log->data_ev, &mailbox_ptr->spin, bcast_has_data, &w);
+    }
+    bcast_slot_t *slot = &log->slot[w.pos & (log->slots - 1)];
+    mailbox_ptr->rx_data = slot->data;
+    mailbox_ptr->rx_len = slot->len;
+    return 1;
+}
+
+//這一格讀完了：推進自己的 cursor，sender 可能在等最慢的這個
+static void bcast_rx_end(mailbox_t *mailbox_ptr)
+{
+    bcast_t *log = mailbox_ptr->storage.bcast.log;
+    uint64_t pos = ++mailbox_ptr->storage.bcast.pos;
+    atomic_store_explicit(&log->reader[mailbox_ptr->storage.bcast.reader].cursor, pos + 1, memory_order_release);
+    fevent_notify(&log->space_ev);
+}
+
+const transport_t bcast_transport = {
+    .name = "Shared Memory Broadcast",
+    .open = bcast_open,
+    .close = bcast_close,
+    XFER_OPS,
+    .tx_begin = bcast_tx_begin,
+    .tx_end = bcast_tx_end,
+    .rx_begin = bcast_rx_begin,
+    .rx_end = bcast_rx_end,
+};
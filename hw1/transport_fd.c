@@ -0,0 +1,621 @@
+#define _GNU_SOURCE
+#include "transport.h"
+#include <errno.h>
+#include <poll.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+/*
+    用 file descriptor 傳資料的 transport：
+        FIFO_PIPE   named pipe，byte stream，每個 batch 前面加 4 byte 長度
+        UNIX_SOCKET AF_UNIX SOCK_SEQPACKET，kernel 保留訊息邊界，一個 batch 一次 send()
+        SHM_EVENTFD 資料在共享記憶體的 slot 裡，只用 eventfd 通知；共享記憶體 (memfd) 和 eventfd
+                    都由 sender 建立，經過 AF_UNIX socket 用 SCM_RIGHTS 傳給 receiver
+    anonymous pipe 只能在有親屬關係的 process 之間繼承，sender / receiver 是分開啟動的，所以用 named pipe
+    名字由 ftok() 的 key 產生 (見 mailbox_path())，放在 /tmp
+*/
+
+#define FD_XFER_MAX 65536 // FIFO / socket 一個 batch 最多幾個 byte
+
+static void write_all(int fd, const void *buf, size_t len)
+{
+    const char *p = buf;
+    while (len > 0)
+    {
+        ssize_t n = write(fd, p, len);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n == -1)
+        {
+            perror("write failed");
+            exit(1);
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+}
+
+//大部分情況一次 writev() 就寫完；寫不完 (pipe 滿了) 就從寫到的地方繼續
+static void writev_all(int fd, struct iovec *iov, int cnt)
+{
+    while (cnt > 0)
+    {
+        ssize_t n = writev(fd, iov, cnt);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n == -1)
+        {
+            perror("writev failed");
+            exit(1);
+        }
+        while (cnt > 0 && (size_t)n >= iov->iov_len)
+        {
+            n -= iov->iov_len;
+            iov++;
+            cnt--;
+        }
+        if (cnt > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= (size_t)n;
+        }
+    }
+}
+
+//對方關掉 (EOF) 時回傳 -1
+static int read_all(int fd, void *buf, size_t len)
+{
+    char *p = buf;
+    while (len > 0)
+    {
+        ssize_t n = read(fd, p, len);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n == -1)
+        {
+            perror("read failed");
+            exit(1);
+        }
+        if (n == 0)
+            return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+//block = 0 時先看看 fd 有沒有資料可以讀，沒有就不要去 read() 卡住
+//sender 已經關掉 (只有 POLLHUP，沒有 POLLIN) 也算沒有資料，讓 receive_batch() 把已經收到的交出去
+static int fd_ready(int fd, int block)
+{
+    if (block)
+        return 1;
+    struct pollfd pfd = {.fd = fd, .events = POLLIN};
+    return poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLIN);
+}
+
+//FIFO / socket / mq：資料本身就在 fd 上，可以直接 epoll
+int fd_poll_fd(mailbox_t *mailbox_ptr)
+{
+    return mailbox_ptr->storage.fd;
+}
+
+static void alloc_xbuf(mailbox_t *mailbox_ptr, size_t cap)
+{
+    mailbox_ptr->tx_cap = cap;
+    mailbox_ptr->xbuf = malloc(cap);
+    if (mailbox_ptr->xbuf == NULL)
+    {
+        perror("malloc failed");
+        exit(1);
+    }
+}
+
+/* ============================ FIFO_PIPE ============================ */
+
+static void fifo_open(mailbox_t *mailbox_ptr)
+{
+    char path[64];
+    mailbox_path(mailbox_ptr, "/tmp/mailbox-", ".fifo", path, sizeof(path));
+    //誰先啟動誰建立；open() 會等到另一端也打開才回來
+    if (mkfifo(path, 0666) == -1 && errno != EEXIST)
+    {
+        perror("mkfifo failed");
+        exit(1);
+    }
+    int fd = open(path, mailbox_ptr->role == MAILBOX_SENDER ? O_WRONLY : O_RDONLY);
+    if (fd == -1)
+    {
+        perror("open fifo failed");
+        exit(1);
+    }
+    mailbox_ptr->storage.fd = fd;
+    alloc_xbuf(mailbox_ptr, FD_XFER_MAX);
+}
+
+static void fd_close(mailbox_t *mailbox_ptr)
+{
+    close(mailbox_ptr->storage.fd);
+    free(mailbox_ptr->xbuf);
+}
+
+static void fifo_close(mailbox_t *mailbox_ptr)
+{
+    fd_close(mailbox_ptr);
+    if (mailbox_ptr->role == MAILBOX_RECEIVER)
+    {
+        char path[64];
+        mailbox_path(mailbox_ptr, "/tmp/mailbox-", ".fifo", path, sizeof(path));
+        unlink(path);
+    }
+}
+
+//batch 組在本地的 xbuf，送出時一次 write()
+static char *fd_tx_begin(mailbox_t *mailbox_ptr)
+{
+    return mailbox_ptr->xbuf;
+}
+
+//pipe 是 byte stream，沒有訊息邊界：[uint32_t 長度][batch]
+static void fifo_tx_end(mailbox_t *mailbox_ptr)
+{
+    struct timespec start;
+    uint32_t len = (uint32_t)mailbox_ptr->tx_len;
+    struct iovec iov[2] = {
+        {.iov_base = &len, .iov_len = sizeof(len)},
+        {.iov_base = mailbox_ptr->xbuf, .iov_len = mailbox_ptr->tx_len},
+    };
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    writev_all(mailbox_ptr->storage.fd, iov, 2);
+    mailbox_add_time(mailbox_ptr, &start);
+}
+
+static int fifo_rx_begin(mailbox_t *mailbox_ptr, int block)
+{
+    int fd = mailbox_ptr->storage.fd;
+    if (!fd_ready(fd, block))
+        return 0;
+
+    struct timespec start;
+    uint32_t len;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (read_all(fd, &len, sizeof(len)) == -1 || len > mailbox_ptr->tx_cap ||
+        read_all(fd, mailbox_ptr->xbuf, len) == -1)
+    {
+        fprintf(stderr, "fifo: sender closed the pipe\n");
+        exit(1);
+    }
+    mailbox_add_time(mailbox_ptr, &start);
+    mailbox_ptr->rx_data = mailbox_ptr->xbuf;
+    mailbox_ptr->rx_len = len;
+    return 1;
+}
+
+const transport_t fifo_transport = {
+    .name = "Named Pipe",
+    .open = fifo_open,
+    .close = fifo_close,
+    XFER_OPS,
+    .tx_begin = fd_tx_begin,
+    .tx_end = fifo_tx_end,
+    .rx_begin = fifo_rx_begin,
+    .poll_fd = fd_poll_fd,
+};
+
+#ifdef __linux__
+
+/* ======================= AF_UNIX 的連線建立 ======================= */
+
+//sender 端：在 path 上 listen，等 receiver 連進來；連上之後就把 path 刪掉，不會留下檔案
+static int sock_accept(const char *path, int type)
+{
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    int lfd = socket(AF_UNIX, type, 0);
+    if (lfd == -1)
+    {
+        perror("socket failed");
+        exit(1);
+    }
+    unlink(path);
+    if (bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(lfd, 1) == -1)
+    {
+        perror("bind/listen failed");
+        exit(1);
+    }
+    int fd;
+    while ((fd = accept(lfd, NULL, NULL)) == -1 && errno == EINTR)
+        ;
+    if (fd == -1)
+    {
+        perror("accept failed");
+        exit(1);
+    }
+    close(lfd);
+    unlink(path);
+    return fd;
+}
+
+//receiver 端：sender 還沒 listen 就一直重試 (和 ring_attach() 等 sender 一樣)
+static int sock_connect(const char *path, int type)
+{
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    for (;;)
+    {
+        int fd = socket(AF_UNIX, type, 0);
+        if (fd == -1)
+        {
+            perror("socket failed");
+            exit(1);
+        }
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+            return fd;
+        if (errno != ENOENT && errno != ECONNREFUSED)
+        {
+            perror("connect failed");
+            exit(1);
+        }
+        close(fd);
+        usleep(1000);
+    }
+}
+
+/* ============================ UNIX_SOCKET ============================ */
+
+static void unix_open(mailbox_t *mailbox_ptr)
+{
+    char path[64];
+    mailbox_path(mailbox_ptr, "/tmp/mailbox-", ".sock", path, sizeof(path));
+    if (mailbox_ptr->role == MAILBOX_SENDER)
+        mailbox_ptr->storage.fd = sock_accept(path, SOCK_SEQPACKET);
+    else
+        mailbox_ptr->storage.fd = sock_connect(path, SOCK_SEQPACKET);
+    alloc_xbuf(mailbox_ptr, FD_XFER_MAX);
+}
+
+//SOCK_SEQPACKET 保留邊界：一個 batch 就是一個 packet，不用自己加長度
+//用 write() 而不是 send()：sender.c 自己定義了 send()，會蓋掉 libc 的 send()
+static void unix_tx_end(mailbox_t *mailbox_ptr)
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ssize_t n;
+    while ((n = write(mailbox_ptr->storage.fd, mailbox_ptr->xbuf, mailbox_ptr->tx_len)) == -1 && errno == EINTR)
+        ;
+    if (n == -1)
+    {
+        perror("write failed");
+        exit(1);
+    }
+    mailbox_add_time(mailbox_ptr, &start);
+}
+
+static int unix_rx_begin(mailbox_t *mailbox_ptr, int block)
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ssize_t n;
+    while ((n = recv(mailbox_ptr->storage.fd, mailbox_ptr->xbuf, mailbox_ptr->tx_cap, block ? 0 : MSG_DONTWAIT)) == -1 &&
+           errno == EINTR)
+        ;
+    //沒有資料，或 sender 已經關掉 (還沒收到的都已經收完了)：non-blocking 時回傳 0
+    if (!block && (n == 0 || (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))))
+        return 0;
+    if (n <= 0)
+    {
+        fprintf(stderr, "unix socket: sender closed the connection\n");
+        exit(1);
+    }
+    mailbox_add_time(mailbox_ptr, &start);
+    mailbox_ptr->rx_data = mailbox_ptr->xbuf;
+    mailbox_ptr->rx_len = (size_t)n;
+    return 1;
+}
+
+const transport_t unix_transport = {
+    .name = "Unix Socket",
+    .open = unix_open,
+    .close = fd_close,
+    XFER_OPS,
+    .tx_begin = fd_tx_begin,
+    .tx_end = unix_tx_end,
+    .rx_begin = unix_rx_begin,
+    .poll_fd = fd_poll_fd,
+};
+
+/* ============================ SHM_EVENTFD ============================ */
+
+/*
+    EFD_SLOTS 個 slot 輪流使用，sender 最多可以領先 receiver EFD_SLOTS 個 batch
+    兩個 eventfd 都是 EFD_SEMAPHORE 模式，當作 counting semaphore：
+        space_fd 初始值 EFD_SLOTS：sender read() 一次拿一個空的 slot，receiver 讀完 write() 還回去
+        data_fd  初始值 0：sender 寫好一個 slot 就 write()，receiver read() 一次收一個
+    read()/write() 本身就是 system call，兩邊看到 slot 內容的順序由 kernel 保證
+*/
+#define EFD_SLOTS 8
+#define EFD_SLOT_BYTES 16384
+
+typedef struct {
+    uint32_t len;
+    uint32_t pad;   // data 從 offset 8 開始，frame header 保持對齊
+    char data[EFD_SLOT_BYTES - 8];
+} efd_slot_t;
+
+static efd_slot_t *efd_slot(mailbox_t *mailbox_ptr)
+{
+    return (efd_slot_t *)mailbox_ptr->storage.efd.slots + mailbox_ptr->storage.efd.next;
+}
+
+/*
+    sender 建立的 fd 經過 AF_UNIX socket (path 由 key + suffix 產生) 用 SCM_RIGHTS 傳給 receiver
+    sender: 等 receiver 連上，把 fds[0, n) 傳過去；receiver: 連上 sender，收到的 fd 放進 fds
+*/
+static void fd_exchange(mailbox_t *mailbox_ptr, const char *suffix, int *fds, int n)
+{
+    char path[64];
+    char byte = 0;
+    struct iovec iov = {.iov_base = &byte, .iov_len = 1};
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(sizeof(int) * 4)];
+    } ctrl;
+    struct msghdr msg = {.msg_iov = &iov, .msg_iovlen = 1, .msg_control = ctrl.buf,
+                         .msg_controllen = CMSG_SPACE(sizeof(int) * (size_t)n)};
+
+    mailbox_path(mailbox_ptr, "/tmp/mailbox-", suffix, path, sizeof(path));
+    if (mailbox_ptr->role == MAILBOX_SENDER)
+    {
+        int sock = sock_accept(path, SOCK_STREAM);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * (size_t)n);
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * (size_t)n);
+        if (sendmsg(sock, &msg, 0) == -1)
+        {
+            perror("sendmsg failed");
+            exit(1);
+        }
+        close(sock);
+    }
+    else
+    {
+        int sock = sock_connect(path, SOCK_STREAM);
+        struct cmsghdr *cmsg;
+        if (recvmsg(sock, &msg, 0) <= 0 || (cmsg = CMSG_FIRSTHDR(&msg)) == NULL || cmsg->cmsg_type != SCM_RIGHTS)
+        {
+            fprintf(stderr, "%s: did not receive descriptors from sender\n", suffix + 1);
+            exit(1);
+        }
+        memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * (size_t)n);
+        close(sock);
+    }
+}
+
+static void efd_open(mailbox_t *mailbox_ptr)
+{
+    int fds[3]; // memfd, data_fd, space_fd
+    if (mailbox_ptr->role == MAILBOX_SENDER)
+    {
+        size_t bytes = sizeof(efd_slot_t) * EFD_SLOTS;
+        fds[0] = place_memfd(&mailbox_ptr->place, "mailbox", &bytes); // huge page 時會補到 huge page 的倍數
+        fds[1] = eventfd(0, EFD_SEMAPHORE);
+        fds[2] = eventfd(EFD_SLOTS, EFD_SEMAPHORE);
+        if (fds[0] == -1 || fds[1] == -1 || fds[2] == -1)
+        {
+            perror("memfd/eventfd failed");
+            exit(1);
+        }
+    }
+    //等 receiver 連上，把三個 fd 一起傳過去
+    fd_exchange(mailbox_ptr, ".efd", fds, 3);
+
+    //memfd 的大小由 sender 決定 (可能是 huge page)，兩邊都照實際大小 map
+    struct stat st;
+    if (fstat(fds[0], &st) == -1)
+    {
+        perror("fstat failed");
+        exit(1);
+    }
+    char *slots = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+    if (slots == MAP_FAILED)
+    {
+        perror("mmap failed");
+        exit(1);
+    }
+    if (mailbox_ptr->role == MAILBOX_SENDER)
+        place_bind(&mailbox_ptr->place, slots, (size_t)st.st_size);
+    close(fds[0]); // mapping 還在，memfd 本身不需要了；兩邊都 munmap 之後記憶體自動釋放
+    mailbox_ptr->storage.efd.slots = slots;
+    mailbox_ptr->storage.efd.bytes = (size_t)st.st_size;
+    mailbox_ptr->storage.efd.data_fd = fds[1];
+    mailbox_ptr->storage.efd.space_fd = fds[2];
+    mailbox_ptr->storage.efd.next = 0;
+    mailbox_ptr->tx_cap = sizeof(((efd_slot_t *)0)->data);
+    mailbox_ptr->tx_nt_min = copy_nt_min(mailbox_ptr->storage.efd.bytes);
+}
+
+static void efd_close(mailbox_t *mailbox_ptr)
+{
+    munmap(mailbox_ptr->storage.efd.slots, mailbox_ptr->storage.efd.bytes);
+    close(mailbox_ptr->storage.efd.data_fd);
+    close(mailbox_ptr->storage.efd.space_fd);
+}
+
+static void efd_take(int fd)
+{
+    uint64_t v;
+    while (read(fd, &v, sizeof(v)) == -1)
+    {
+        if (errno != EINTR)
+        {
+            perror("eventfd read failed");
+            exit(1);
+        }
+    }
+}
+
+static void efd_give(int fd)
+{
+    uint64_t v = 1;
+    write_all(fd, &v, sizeof(v));
+}
+
+//等一個空的 slot (不計時)，frame 直接寫在共享記憶體裡
+static char *efd_tx_begin(mailbox_t *mailbox_ptr)
+{
+    efd_take(mailbox_ptr->storage.efd.space_fd);
+    return efd_slot(mailbox_ptr)->data;
+}
+
+static void efd_tx_end(mailbox_t *mailbox_ptr)
+{
+    efd_slot(mailbox_ptr)->len = (uint32_t)mailbox_ptr->tx_len;
+    mailbox_ptr->storage.efd.next = (mailbox_ptr->storage.efd.next + 1) % EFD_SLOTS;
+    efd_give(mailbox_ptr->storage.efd.data_fd); // 通知 receiver 可以收
+}
+
+static int efd_rx_begin(mailbox_t *mailbox_ptr, int block)
+{
+    if (!fd_ready(mailbox_ptr->storage.efd.data_fd, block))
+        return 0;
+    efd_take(mailbox_ptr->storage.efd.data_fd);
+    efd_slot_t *slot = efd_slot(mailbox_ptr);
+    mailbox_ptr->rx_data = slot->data;
+    mailbox_ptr->rx_len = slot->len;
+    return 1;
+}
+
+//slot 讀完了，還給 sender
+static void efd_rx_end(mailbox_t *mailbox_ptr)
+{
+    mailbox_ptr->storage.efd.next = (mailbox_ptr->storage.efd.next + 1) % EFD_SLOTS;
+    efd_give(mailbox_ptr->storage.efd.space_fd);
+}
+
+//data_fd 的值 > 0 (有 slot 可以收) 時可讀
+static int efd_poll_fd(mailbox_t *mailbox_ptr)
+{
+    return mailbox_ptr->storage.efd.data_fd;
+}
+
+const transport_t efd_transport = {
+    .name = "Shared Memory + eventfd",
+    .open = efd_open,
+    .close = efd_close,
+    XFER_OPS,
+    .tx_begin = efd_tx_begin,
+    .tx_end = efd_tx_end,
+    .rx_begin = efd_rx_begin,
+    .rx_end = efd_rx_end,
+    .poll_fd = efd_poll_fd,
+};
+
+/* ============================ doorbell ============================ */
+
+/*
+    sender 建立 eventfd 和一頁 memfd (裡面只有 armed)，用 fd_exchange() 傳給 receiver
+    receiver: doorbell_arm() 先 read() 把 eventfd 清成 0，再 armed = 1，接著呼叫端要再看一次 transport 有沒有資料
+    sender: 每次 flush (資料已經 publish) 之後 doorbell_ring()，armed 是 1 才搶成 0 並 write() eventfd
+    兩邊都是「先寫自己的、fence、再讀對方的」：receiver 看不到新資料的話，sender 一定看得到 armed，不會漏掉叫醒
+*/
+struct doorbell {
+    int fd;                  // eventfd；sender / receiver 的 fd 號碼各自不同
+    _Atomic uint32_t *armed; // memfd 的第一個 word，兩邊共用
+};
+
+void doorbell_open(mailbox_t *mailbox_ptr)
+{
+    int fds[2]; // eventfd, memfd
+    if (mailbox_ptr->role == MAILBOX_SENDER)
+    {
+        fds[0] = eventfd(0, 0);
+        fds[1] = memfd_create("doorbell", MFD_CLOEXEC);
+        if (fds[0] == -1 || fds[1] == -1 || ftruncate(fds[1], sizeof(uint32_t)) == -1)
+        {
+            perror("eventfd/memfd failed");
+            exit(1);
+        }
+    }
+    fd_exchange(mailbox_ptr, ".bell", fds, 2);
+
+    doorbell_t *bell = malloc(sizeof(*bell));
+    void *page = mmap(NULL, sizeof(uint32_t), PROT_READ | PROT_WRITE, MAP_SHARED, fds[1], 0);
+    if (bell == NULL || page == MAP_FAILED)
+    {
+        perror("doorbell setup failed");
+        exit(1);
+    }
+    close(fds[1]);
+    //receiver 那邊 epoll 和 drain 都不能卡在 read()
+    if (mailbox_ptr->role == MAILBOX_RECEIVER)
+        fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    bell->fd = fds[0];
+    bell->armed = page;
+    mailbox_ptr->bell = bell;
+}
+
+void doorbell_close(mailbox_t *mailbox_ptr)
+{
+    doorbell_t *bell = mailbox_ptr->bell;
+    munmap((void *)bell->armed, sizeof(uint32_t));
+    close(bell->fd);
+    free(bell);
+    mailbox_ptr->bell = NULL;
+}
+
+void doorbell_ring(mailbox_t *mailbox_ptr)
+{
+    doorbell_t *bell = mailbox_ptr->bell;
+    atomic_thread_fence(memory_order_seq_cst); // publish 資料之後才看 armed
+    if (atomic_load_explicit(bell->armed, memory_order_relaxed) && atomic_exchange(bell->armed, 0))
+        efd_give(bell->fd);
+}
+
+void doorbell_arm(mailbox_t *mailbox_ptr)
+{
+    doorbell_t *bell = mailbox_ptr->bell;
+    uint64_t v;
+    while (read(bell->fd, &v, sizeof(v)) == -1 && errno == EINTR)
+        ;
+    atomic_store(bell->armed, 1);
+    atomic_thread_fence(memory_order_seq_cst); // arm 之後才再看一次有沒有資料
+}
+
+void doorbell_disarm(mailbox_t *mailbox_ptr)
+{
+    atomic_store_explicit(mailbox_ptr->bell->armed, 0, memory_order_relaxed);
+}
+
+int doorbell_fd(mailbox_t *mailbox_ptr)
+{
+    return mailbox_ptr->bell->fd;
+}
+
+#else
+
+//eventfd / memfd 只有 Linux 有
+void doorbell_open(mailbox_t *mailbox_ptr)
+{
+    (void)mailbox_ptr;
+    fprintf(stderr, "Doorbell (eventfd) is only supported on Linux\n");
+    exit(1);
+}
+
+void doorbell_close(mailbox_t *mailbox_ptr) { (void)mailbox_ptr; }
+void doorbell_ring(mailbox_t *mailbox_ptr) { (void)mailbox_ptr; }
+void doorbell_arm(mailbox_t *mailbox_ptr) { (void)mailbox_ptr; }
+void doorbell_disarm(mailbox_t *mailbox_ptr) { (void)mailbox_ptr; }
+int doorbell_fd(mailbox_t *mailbox_ptr)
+{
+    (void)mailbox_ptr;
+    return -1;
+}
+
+#endif
@@ -0,0 +1,190 @@
+#include "transport.h"
+#include "ring.h"
+
+/*
+    SHM_MPMC：N 個 sender / M 個 receiver 共用的 bounded queue (Vyukov 的 MPMC ring)，整塊放在 shared memory
+    每個 cell 放一個 batch (和 SHARED_MEM 的 shm_box_t 一樣是一整塊 frame)，cell 上有一個 seq：
+        seq == pos          cell 是空的，輪到位置 pos 的 sender 寫
+        seq == pos + 1      cell 有資料，輪到位置 pos 的 receiver 讀
+        seq == pos + cells  receiver 讀完還回去，給下一圈位置 pos + cells 的 sender
+    sender / receiver 各用一次 CAS 搶 enq / deq 的下一個位置，搶到之後 cell 就是自己的，寫 / 讀都不用 lock
+    每個 batch 只會被一個 receiver 拿到，receiver 之間自動分攤工作 (shared work queue)，不看 routing key
+    等待 (ring 滿 / 空) 時先 spin，再用 futex 睡在 space_ev / data_ev 上 (見 sync.h)
+
+    第一個 sender 建立 (shm_join)，receiver 等建好再掛載 (shm_wait)，最後離開的 receiver 移除區段
+*/
+#define MPMC_MAGIC 0x4d504d43u // "MPMC"
+#define MPMC_PROJ_ID 68        // ftok() 的編號，和 SYNC_PROJ_ID 67 分開
+#define MPMC_CELLS 256         // 必須是 2 的次方 (位置用 & 取餘數)
+#define MPMC_CELL_DATA 8192    // 一個 batch 最多幾個 byte
+
+typedef struct {
+    _Alignas(CACHE_LINE) _Atomic uint64_t seq;
+    uint32_t len;              // data 裡 frame 的總長度
+    _Alignas(16) char data[MPMC_CELL_DATA];
+} mpmc_cell_t;
+
+struct mpmc {
+    _Alignas(CACHE_LINE) _Atomic uint32_t magic;
+    uint32_t cells;
+    peers_t peers;
+
+    _Alignas(CACHE_LINE) _Atomic uint64_t enq; // sender 下一個要搶的位置
+    _Alignas(CACHE_LINE) _Atomic uint64_t deq; // receiver 下一個要搶的位置
+
+    _Alignas(CACHE_LINE) fevent_t data_ev;  // receiver 等「cell 有資料」
+    _Alignas(CACHE_LINE) fevent_t space_ev; // sender 等「cell 空出來」
+
+    mpmc_cell_t cell[];
+};
+
+#define MPMC_BYTES (sizeof(mpmc_t) + MPMC_CELLS * sizeof(mpmc_cell_t))
+
+//fevent_await() 的條件：cell 的 seq 已經到 (或超過) want
+typedef struct {
+    _Atomic uint64_t *seq;
+    uint64_t want;
+} mpmc_wait_t;
+
+static int mpmc_reached(void *arg)
+{
+    mpmc_wait_t *w = arg;
+    return (int64_t)(atomic_load_explicit(w->seq, memory_order_acquire) - w->want) >= 0;
+}
+
+static void mpmc_open(mailbox_t *mailbox_ptr)
+{
+    key_t key = mailbox_key(mailbox_ptr, MPMC_PROJ_ID);
+    if (mailbox_ptr->role == MAILBOX_RECEIVER)
+    {
+        mailbox_ptr->storage.mpmc.q = shm_wait(key, MPMC_MAGIC);
+        mailbox_ptr->tx_cap = MPMC_CELL_DATA;
+        mailbox_ptr->peers = &mailbox_ptr->storage.mpmc.q->peers;
+        return;
+    }
+
+    int fresh;
+    mpmc_t *q = shm_join(key, MPMC_BYTES, MPMC_MAGIC, &mailbox_ptr->place, &fresh);
+    if (fresh)
+    {
+        q->cells = MPMC_CELLS;
+        peers_init(&q->peers);
+        atomic_store_explicit(&q->enq, 0, memory_order_relaxed);
+        atomic_store_explicit(&q->deq, 0, memory_order_relaxed);
+        for (uint32_t i = 0; i < MPMC_CELLS; i++)
+            atomic_store_explicit(&q->cell[i].seq, i, memory_order_relaxed);
+        fevent_init(&q->data_ev);
+        fevent_init(&q->space_ev);
+        // release: 其他人看到 magic 時，上面的初始化一定都已經可見
+        atomic_store_explicit(&q->magic, MPMC_MAGIC, memory_order_release);
+    }
+    mailbox_ptr->storage.mpmc.q = q;
+    mailbox_ptr->tx_cap = MPMC_CELL_DATA;
+    mailbox_ptr->tx_nt_min = copy_nt_min(MPMC_BYTES);
+    mailbox_ptr->peers = &q->peers;
+}
+
+static void mpmc_close(mailbox_t *mailbox_ptr)
+{
+    shmdt(mailbox_ptr->storage.mpmc.q);
+    if (mailbox_ptr->role == MAILBOX_RECEIVER && mailbox_ptr->last)
+    {
+        int shmid = shmget(mailbox_key(mailbox_ptr, MPMC_PROJ_ID), 0, 0666);
+        if (shmid != -1)
+            shmctl(shmid, IPC_RMID, NULL);
+    }
+}
+
+//搶下一個空的 cell，batch 直接寫在 cell 裡；ring 滿了就等 receiver 還 cell
+static char *mpmc_tx_begin(mailbox_t *mailbox_ptr)
+{
+    mpmc_t *q = mailbox_ptr->storage.mpmc.q;
+    uint64_t pos = atomic_load_explicit(&q->enq, memory_order_relaxed);
+    mpmc_cell_t *cell;
+    for (;;)
+    {
+        cell = &q->cell[pos & (q->cells - 1)];
+        int64_t diff = (int64_t)(atomic_load_explicit(&cell->seq, memory_order_acquire) - pos);
+        if (diff == 0)
+        {
+            //CAS 失敗時 pos 會被換成最新的 enq
+            if (atomic_compare_exchange_weak_explicit(&q->enq, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            //上一圈的 receiver 還沒讀完這個 cell：ring 滿了
+            mpmc_wait_t w = {&cell->seq, pos};
+            fevent_await(&q->space_ev, &mailbox_ptr->spin, mpmc_reached, &w);
+            pos = atomic_load_explicit(&q->enq, memory_order_relaxed);
+        }
+        else
+            pos = atomic_load_explicit(&q->enq, memory_order_relaxed); // 被別的 sender 搶走了
+    }
+    mailbox_ptr->storage.mpmc.pos = pos;
+    return cell->data;
+}
+
+static void mpmc_tx_end(mailbox_t *mailbox_ptr)
+{
+    mpmc_t *q = mailbox_ptr->storage.mpmc.q;
+    uint64_t pos = mailbox_ptr->storage.mpmc.pos;
+    mpmc_cell_t *cell = &q->cell[pos & (q->cells - 1)];
+    cell->len = (uint32_t)mailbox_ptr->tx_len;
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+    fevent_notify(&q->data_ev);
+}
+
+//搶下一個有資料的 cell；frame 直接在 cell 裡讀，整個 batch 讀完才還給 sender
+static int mpmc_rx_begin(mailbox_t *mailbox_ptr, int block)
+{
+    mpmc_t *q = mailbox_ptr->storage.mpmc.q;
+    uint64_t pos = atomic_load_explicit(&q->deq, memory_order_relaxed);
+    mpmc_cell_t *cell;
+    for (;;)
+    {
+        cell = &q->cell[pos & (q->cells - 1)];
+        int64_t diff = (int64_t)(atomic_load_explicit(&cell->seq, memory_order_acquire) - (pos + 1));
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&q->deq, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            //sender 還沒寫好這個 cell：ring 是空的
+            if (!block)
+                return 0;
+            mpmc_wait_t w = {&cell->seq, pos + 1};
+            fevent_await(&q->data_ev, &mailbox_ptr->spin, mpmc_reached, &w);
+            pos = atomic_load_explicit(&q->deq, memory_order_relaxed);
+        }
+        else
+            pos = atomic_load_explicit(&q->deq, memory_order_relaxed); // 被別的 receiver 搶走了
+    }
+    mailbox_ptr->storage.mpmc.pos = pos;
+    mailbox_ptr->rx_data = cell->data;
+    mailbox_ptr->rx_len = cell->len;
+    return 1;
+}
+
+static void mpmc_rx_end(mailbox_t *mailbox_ptr)
+{
+    mpmc_t *q = mailbox_ptr->storage.mpmc.q;
+    uint64_t pos = mailbox_ptr->storage.mpmc.pos;
+    atomic_store_explicit(&q->cell[pos & (q->cells - 1)].seq, pos + q->cells, memory_order_release);
+    fevent_notify(&q->space_ev);
+}
+
+const transport_t mpmc_transport = {
+    .name = "Shared Memory MPMC Ring",
+    .open = mpmc_open,
+    .close = mpmc_close,
+    XFER_OPS,
+    .tx_begin = mpmc_tx_begin,
+    .tx_end = mpmc_tx_end,
+    .rx_begin = mpmc_rx_begin,
+    .rx_end = mpmc_rx_end,
+};
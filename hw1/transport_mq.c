@@ -0,0 +1,113 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#include "transport.h"
+#include <errno.h>
+#include <mqueue.h>
+
+/*
+    POSIX_MQ：mq_open() / mq_send() / mq_receive()，一個 batch 就是一則 mq 訊息
+    queue 滿了 mq_send() 會自己等，空了 mq_receive() 會自己等，不需要 semaphore
+    一則訊息最大 MQ_MSG_SIZE byte，kernel 的上限是 /proc/sys/fs/mqueue/msgsize_max (預設 8192)
+    Linux 的 mqd_t 就是一個 fd，直接放在 storage.fd
+*/
+#define MQ_MSG_SIZE 8192
+#define MQ_DEPTH 10 // 預設的 /proc/sys/fs/mqueue/msg_max
+
+static void mq_open_box(mailbox_t *mailbox_ptr)
+{
+    char name[64];
+    mailbox_path(mailbox_ptr, "/mailbox-", "", name, sizeof(name));
+    struct mq_attr attr = {.mq_maxmsg = MQ_DEPTH, .mq_msgsize = MQ_MSG_SIZE};
+    //誰先啟動誰建立，兩邊給一樣的 attr
+    int oflag = (mailbox_ptr->role == MAILBOX_SENDER ? O_WRONLY : O_RDONLY) | O_CREAT;
+    mqd_t mq = mq_open(name, oflag, 0666, &attr);
+    if (mq == (mqd_t)-1)
+    {
+        perror("mq_open failed");
+        exit(1);
+    }
+    //queue 可能是之前用別的大小建立的，以實際的 mq_msgsize 為準
+    if (mq_getattr(mq, &attr) == -1)
+    {
+        perror("mq_getattr failed");
+        exit(1);
+    }
+    mailbox_ptr->storage.fd = (int)mq;
+    mailbox_ptr->tx_cap = (size_t)attr.mq_msgsize;
+    mailbox_ptr->xbuf = malloc(mailbox_ptr->tx_cap);
+    if (mailbox_ptr->xbuf == NULL)
+    {
+        perror("malloc failed");
+        exit(1);
+    }
+}
+
+static void mq_close_box(mailbox_t *mailbox_ptr)
+{
+    mq_close((mqd_t)mailbox_ptr->storage.fd);
+    free(mailbox_ptr->xbuf);
+    if (mailbox_ptr->role == MAILBOX_RECEIVER)
+    {
+        char name[64];
+        mailbox_path(mailbox_ptr, "/mailbox-", "", name, sizeof(name));
+        mq_unlink(name);
+    }
+}
+
+static char *mq_tx_begin(mailbox_t *mailbox_ptr)
+{
+    return mailbox_ptr->xbuf;
+}
+
+static void mq_tx_end(mailbox_t *mailbox_ptr)
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (mq_send((mqd_t)mailbox_ptr->storage.fd, mailbox_ptr->xbuf, mailbox_ptr->tx_len, 0) == -1)
+    {
+        if (errno != EINTR)
+        {
+            perror("mq_send failed");
+            exit(1);
+        }
+    }
+    mailbox_add_time(mailbox_ptr, &start);
+}
+
+static int mq_rx_begin(mailbox_t *mailbox_ptr, int block)
+{
+    mqd_t mq = (mqd_t)mailbox_ptr->storage.fd;
+    //只有一個 receiver：看得到有訊息，mq_receive() 就一定不會卡住
+    struct mq_attr attr;
+    if (!block && mq_getattr(mq, &attr) == 0 && attr.mq_curmsgs == 0)
+        return 0;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ssize_t n;
+    while ((n = mq_receive(mq, mailbox_ptr->xbuf, mailbox_ptr->tx_cap, NULL)) == -1)
+    {
+        if (errno != EINTR)
+        {
+            perror("mq_receive failed");
+            exit(1);
+        }
+    }
+    mailbox_add_time(mailbox_ptr, &start);
+    mailbox_ptr->rx_data = mailbox_ptr->xbuf;
+    mailbox_ptr->rx_len = (size_t)n;
+    return 1;
+}
+
+const transport_t mq_transport = {
+    .name = "POSIX Message Queue",
+    .open = mq_open_box,
+    .close = mq_close_box,
+    XFER_OPS,
+    .tx_begin = mq_tx_begin,
+    .tx_end = mq_tx_end,
+    .rx_begin = mq_rx_begin,
+    .poll_fd = fd_poll_fd,
+};
+
+#endif
@@ -0,0 +1,101 @@
+#include "transport.h"
+#include "ring.h"
+
+/*
+    SHM_RING：frame 直接寫進 ring (見 ring.h)，不經過 semaphore，也沒有 transfer 大小的限制
+    sender 的 batch 只是「還沒 publish tail 的 frame」，receiver 一次 receive 結束才 publish head
+    persist 時 receiver 離開不移除 ring，掛掉或重新啟動的 sender / receiver 直接掛回去接著做 (見 ring.h)
+*/
+
+static void ring_open(mailbox_t *mailbox_ptr)
+{
+    //ring 用另一個 key，因為大小和 mode 2 的區段不同
+    //sender: ring_create() 會建立並掛載區段、把 head/tail 歸零
+    //receiver: 等 sender 建好 ring 再掛載
+    //persist: sender 先試著掛回已經有的 ring (不重新初始化)，receiver 從上一個 receiver ack 的地方接著收
+    key_t ring_key = mailbox_key(mailbox_ptr, RING_PROJ_ID);
+    ring_t *ring;
+    if (mailbox_ptr->role == MAILBOX_SENDER)
+    {
+        ring = mailbox_ptr->persist ? ring_reattach(ring_key) : NULL;
+        if (ring)
+            mailbox_ptr->resumed = ring_resume_writer(ring, &mailbox_ptr->spin);
+        else
+            ring = ring_create(ring_key, mailbox_ptr->ring_bytes ? mailbox_ptr->ring_bytes : RING_BYTES,
+                               &mailbox_ptr->place);
+    }
+    else
+    {
+        ring = ring_attach(ring_key);
+        if (mailbox_ptr->persist)
+            mailbox_ptr->resumed = ring_resume_reader(ring);
+    }
+    mailbox_ptr->generation = atomic_load(&ring->generation);
+    mailbox_ptr->storage.ring = ring;
+}
+
+//persist 的 receiver 離開時不移除，下一個 receiver 從 head 接著收
+static void ring_close(mailbox_t *mailbox_ptr)
+{
+    if (mailbox_ptr->role == MAILBOX_RECEIVER && mailbox_ptr->persist)
+        ring_ack(mailbox_ptr->storage.ring);
+    ring_detach(mailbox_ptr->storage.ring);
+    if (mailbox_ptr->role == MAILBOX_RECEIVER && !mailbox_ptr->persist)
+        ring_destroy(mailbox_key(mailbox_ptr, RING_PROJ_ID));
+}
+
+static size_t ring_payload(mailbox_t *mailbox_ptr)
+{
+    return ring_max_payload(mailbox_ptr->storage.ring);
+}
+
+//frame 直接寫進 ring，mailbox_flush() 才 publish tail
+//ring 滿了會先 publish 再等 receiver 讀走
+static void ring_put(mailbox_t *mailbox_ptr, long mType, uint32_t flags, const char *data, size_t len)
+{
+    (void)mType; // 一個 ring 只有一個 receiver，不用 routing key
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ring_write(mailbox_ptr->storage.ring, &mailbox_ptr->spin, flags, data, len);
+    mailbox_add_time(mailbox_ptr, &start);
+}
+
+static void ring_flush(mailbox_t *mailbox_ptr)
+{
+    ring_publish_tail(mailbox_ptr->storage.ring);
+}
+
+//ring 是空的才會在 ring_peek() 裡面等 sender
+static frame_hdr_t *ring_next(mailbox_t *mailbox_ptr, int block)
+{
+    ring_t *ring = mailbox_ptr->storage.ring;
+    return block ? ring_peek(ring, &mailbox_ptr->spin) : ring_try_peek(ring);
+}
+
+static void ring_done(mailbox_t *mailbox_ptr, frame_hdr_t *hdr)
+{
+    ring_release(mailbox_ptr->storage.ring, hdr);
+}
+
+static void ring_publish(mailbox_t *mailbox_ptr)
+{
+    ring_publish_head(mailbox_ptr->storage.ring);
+}
+
+static void ring_processed(mailbox_t *mailbox_ptr)
+{
+    ring_ack(mailbox_ptr->storage.ring);
+}
+
+const transport_t ring_transport = {
+    .name = "Shared Memory Ring",
+    .open = ring_open,
+    .close = ring_close,
+    .max_payload = ring_payload,
+    .put = ring_put,
+    .flush = ring_flush,
+    .next = ring_next,
+    .release = ring_done,
+    .publish = ring_publish,
+    .ack = ring_processed,
+};
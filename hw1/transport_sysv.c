@@ -0,0 +1,267 @@
+#include "transport.h"
+#include <errno.h>
+
+/*
+    MSG_PASSING (System V message queue) 和 SHARED_MEM (一個 shm_box_t) 兩種 transport
+    兩個都用控制區段裡的 sender_sem 當 credit；SHARED_MEM 另外用 receiver_sem 通知 receiver (見 sync.h)
+    控制區段裡也登記了所有的 sender / receiver (peers)，兩種模式都可以 N 個 sender 對 M 個 receiver：
+        MSG_PASSING：receiver 用 msgrcv() 的 msgtyp 選 mType (routing key)，0 = 和其他 key 0 的 receiver 搶同一個 queue
+        SHARED_MEM：只有一格，誰搶到 semaphore 誰用 (shared work queue)，不看 routing key
+*/
+
+/*
+    sender_sem / receiver_sem 是放在 System V 控制區段裡的 futex semaphore (見 sync.h)
+    sender 建立控制區段：sender_sem = credits receiver_sem = 0
+    代表sender 一開始可以送訊息因為沒有東西要等，而receiver 要等待sender
+    sender 開始 actions: fsem_wait(sender_sem) 拿一個 credit（1->0）
+    sender 傳完訊息 actions : fsem_post(receiver_sem) ->receiver_sem = 1 (notify receiver；MSG_PASSING 由 msgrcv() 自己等)
+    receiver接收完訊息： fsem_post(sender_sem) -> 還 credit 給 sender （通知sender可以再送)
+    credits = 1 時雙方輪流執行；等待時先 spin，等不到才睡
+    多個 sender 共用同一份 credit，多個 receiver 共用 receiver_sem，semaphore 本身就處理了 N 對 M
+*/
+static void sysv_sync_open(mailbox_t *mailbox_ptr, unsigned credits)
+{
+    key_t sync_key = mailbox_key(mailbox_ptr, SYNC_PROJ_ID);
+    if (mailbox_ptr->role == MAILBOX_SENDER)
+    {
+        mailbox_ptr->ctl = sync_ctl_create(sync_key, credits);
+    }
+    else
+    {
+        //等 sender 建好控制區段 (裡面的 futex semaphore 設好初始值) 再開始
+        //credit 全部由 sender 建立時給，receiver 啟動時不再多 post 一次 (不然 window 會變成 credits + 1)
+        mailbox_ptr->ctl = sync_ctl_attach(sync_key);
+    }
+    mailbox_ptr->peers = &mailbox_ptr->ctl->peers;
+}
+
+static void sysv_sync_close(mailbox_t *mailbox_ptr)
+{
+    //最後一個 receiver 離開時還一個 credit，還在等的 sender 才不會卡住 (prevent sender stuck)
+    //其他 receiver 還在的話 credit 由它們還；每個離開的都 post 會讓 window 比 -w 還大
+    if (mailbox_ptr->role == MAILBOX_RECEIVER && mailbox_ptr->last)
+        fsem_post(&mailbox_ptr->ctl->sender_sem);
+    sync_ctl_detach(mailbox_ptr->ctl);
+    if (mailbox_ptr->role == MAILBOX_RECEIVER && mailbox_ptr->last)
+        sync_ctl_destroy(mailbox_key(mailbox_ptr, SYNC_PROJ_ID));
+}
+
+/* ============================ MSG_PASSING ============================ */
+
+static void msgq_open(mailbox_t *mailbox_ptr)
+{
+    //建立一個System V message queue
+    //key: 由ftok()產生唯一識別碼
+    //IPC_CREAT: 若queue 不存在就建立一個 (receiver 先啟動也沒關係)
+    //0666: 權限設定(read and write for everyone)
+    //這樣一來sender and receiver 就可以用相同的key 連線到同一個queue
+    int msqid = msgget(mailbox_key(mailbox_ptr, MAILBOX_PROJ_ID), IPC_CREAT | 0666);
+    if (msqid == -1)
+    {
+        perror("msgget failed");
+        exit(1);
+    }
+    //把queue ID 存到mailbox結構裡 之後 msgsnd() 或是 msgrcv() 都會用到它
+    mailbox_ptr->storage.msqid = msqid;
+    mailbox_ptr->qbuf = malloc(sizeof(msgq_buf_t));
+    if (mailbox_ptr->qbuf == NULL)
+    {
+        perror("malloc failed");
+        exit(1);
+    }
+    mailbox_ptr->tx_cap = MSGQ_MAX;
+    //credit window：sender 最多可以先丟 window 個 batch 到 queue 裡，不用等 receiver 一個一個收
+    //receiver 每 msgrcv() 一個就還一個 credit；receiver 跟不上時 sender 會在 fsem_wait() 等 (backpressure)
+    sysv_sync_open(mailbox_ptr, mailbox_ptr->window ? mailbox_ptr->window : 1);
+}
+
+static void msgq_close(mailbox_t *mailbox_ptr)
+{
+    sysv_sync_close(mailbox_ptr);
+    free(mailbox_ptr->qbuf);
+    if (mailbox_ptr->role == MAILBOX_RECEIVER && mailbox_ptr->last)
+        msgctl(mailbox_ptr->storage.msqid, IPC_RMID, NULL);
+}
+
+//MSG_PASSING 的 batch 直接組在本地的 qbuf，送出時一次 msgsnd()
+static char *msgq_tx_begin(mailbox_t *mailbox_ptr)
+{
+    mailbox_ptr->qbuf->mType = mailbox_ptr->tx_mType;
+    return mailbox_ptr->qbuf->mText;
+}
+
+static void msgq_tx_end(mailbox_t *mailbox_ptr)
+{
+    struct timespec start;
+    // 等待 receiver 訊號（不計時）
+    fsem_wait(&mailbox_ptr->ctl->sender_sem, &mailbox_ptr->spin);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    //msgsnd()參數
+    // mailbox_ptr->storage.msqid : QueueID （由msgget()建立）
+    // qbuf -> 要傳送的訊息 (mType + 一個或多個 frame)
+    // tx_len ->只送 batch 裡 frame 實際的長度，不再固定送 1024 byte
+    // 0 ->預設阻塞模式(會等queue 可用)
+    if (msgsnd(mailbox_ptr->storage.msqid, mailbox_ptr->qbuf, mailbox_ptr->tx_len, 0) == -1)
+    {
+        perror("msgsnd failed");
+        exit(1);
+    }
+    mailbox_add_time(mailbox_ptr, &start);
+}
+
+static int msgq_rx_begin(mailbox_t *mailbox_ptr, int block)
+{
+    //不再用 receiver_sem 等：receiver 有好幾個、各自收不同的 mType 時，semaphore 分不出是誰的 batch
+    //直接讓 msgrcv() 等，kernel 只會把符合 msgtyp 的訊息交給這個 receiver
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    /*
+        msgrcv():
+            mailbox->storage.msqid: QueueID
+            qbuf: 要存放結果的結構（mType + 一個或多個 frame）
+            MSGQ_MAX 最多讀取的大小，實際只會搬 sender 送的那麼多
+            route ->只讀取 mType = route 的訊息；0 = queue 裡最前面的訊息 (不管 mType)
+                prio 時用 -PRIO_MTYPE_MAX：mType 最小的先給 (control < urgent < bulk，見 PRIO_SPAN)，不分 route
+            0 ->預設阻塞模式（若queue 是空的則等待）；IPC_NOWAIT: 沒有訊息就回傳 ENOMSG
+    */
+    ssize_t n;
+    long msgtyp = mailbox_ptr->prio ? -PRIO_MTYPE_MAX : mailbox_ptr->route;
+    int flags = IPC_NOWAIT; // 先試一次：queue 裡已經有的直接拿，不算等待
+    uint64_t wait_start = 0;
+    while ((n = msgrcv(mailbox_ptr->storage.msqid, mailbox_ptr->qbuf, MSGQ_MAX, msgtyp, flags)) == -1)
+    {
+        if (errno == ENOMSG && block && flags == IPC_NOWAIT)
+        {
+            //queue 是空的：在 msgrcv() 裡睡著等 sender，這段是等待 (記在 stats)，不算進 total_time
+            flags = 0;
+            wait_start = spin_wait_begin(&mailbox_ptr->spin);
+            continue;
+        }
+        if (errno == ENOMSG)
+            return 0;
+        if (errno != EINTR)
+        {
+            perror("msgrcv failed");
+            exit(1);
+        }
+    }
+    if (flags == 0)
+        spin_wait_end(&mailbox_ptr->spin, wait_start);
+    else
+        mailbox_add_time(mailbox_ptr, &start);
+    mailbox_ptr->rx_mType = mailbox_ptr->qbuf->mType;
+    mailbox_ptr->rx_data = mailbox_ptr->qbuf->mText;
+    mailbox_ptr->rx_len = (size_t)n;
+    fsem_post(&mailbox_ptr->ctl->sender_sem); // batch 已經複製到本地，通知 sender 可以送下一個
+    return 1;
+}
+
+const transport_t msgq_transport = {
+    .name = "Message Passing",
+    .open = msgq_open,
+    .close = msgq_close,
+    XFER_OPS,
+    .tx_begin = msgq_tx_begin,
+    .tx_end = msgq_tx_end,
+    .rx_begin = msgq_rx_begin,
+};
+
+/* ============================ SHARED_MEM ============================ */
+
+static void shm_open_box(mailbox_t *mailbox_ptr)
+{
+    // 建立一個共同記憶體區段(Shared Memory Segment)
+    //key: generate by ftok() , 確保sender / receiver 共用同一塊記憶體
+    //SHM_SEG_SIZE: 區段大小(單位是byte)，放一個旗標、frame 總長度和 frame 資料區 (見 shm_box_t)
+    //要求 huge page 時改用 SHM_HUGETLB 建立 (見 place.h)；receiver 先啟動時由 receiver 用一般 page 建立
+    int shmid = place_shmget(&mailbox_ptr->place, mailbox_key(mailbox_ptr, MAILBOX_PROJ_ID), SHM_SEG_SIZE);
+    if (shmid == -1)
+    {
+        perror("shmget failed");
+        exit(1);
+    }
+    //shmat(): attach shared memory
+    //這會將剛剛建立的shared memory 區段「掛載」到這個process 的記憶體空間
+    //NULL : 讓OS 自動決定要掛在哪
+    //0: 預設模式（read and write）
+    char *shm = (char *)shmat(shmid, NULL, 0);
+    if (shm == (char *)-1)
+    {
+        perror("shmat failed");
+        exit(1);
+    }
+    mailbox_ptr->storage.shm_addr = shm;
+    place_bind(&mailbox_ptr->place, shm, SHM_SEG_SIZE);
+    //init shared memory 的狀態旗標
+    // 0 = emty (receiver can wait for new message) 1= there is new message(sender written)
+    if (mailbox_ptr->role == MAILBOX_SENDER)
+        ((shm_box_t *)shm)->flag = 0;
+    mailbox_ptr->tx_cap = SHM_DATA_SIZE;
+    mailbox_ptr->tx_nt_min = copy_nt_min(SHM_SEG_SIZE);
+    //SHARED_MEM 只有一個 frame 的空間，credit 只能是 1；再多給會讓 sender 覆寫還沒讀的 frame
+    sysv_sync_open(mailbox_ptr, 1);
+}
+
+static void shm_close_box(mailbox_t *mailbox_ptr)
+{
+    sysv_sync_close(mailbox_ptr);
+    shmdt(mailbox_ptr->storage.shm_addr);
+    //和控制區段、msgq 一樣，最後離開的 receiver 才移除：其他 receiver 還在用，之後加入的也要掛得上
+    if (mailbox_ptr->role == MAILBOX_RECEIVER && mailbox_ptr->last)
+    {
+        int shmid = shmget(mailbox_key(mailbox_ptr, MAILBOX_PROJ_ID), SHM_SEG_SIZE, 0666);
+        shmctl(shmid, IPC_RMID, NULL);
+    }
+}
+
+//frame 直接寫在共享記憶體裡，不用再複製一次
+static char *shm_tx_begin(mailbox_t *mailbox_ptr)
+{
+    // 等待 receiver 訊號（不計時）
+    //fsem_wait()會讓sender 在semaphore 值為0 導致stuck (先 spin 一下，再用 futex 睡)
+    //一開始sender initial value 為1 所以第一次會直接通過
+    //接下來要等receiver 讀完上一個 batch，fsem_post(sender_sem)通之後才能覆寫共享記憶體
+    fsem_wait(&mailbox_ptr->ctl->sender_sem, &mailbox_ptr->spin);
+    return ((shm_box_t *)mailbox_ptr->storage.shm_addr)->data;
+}
+
+static void shm_tx_end(mailbox_t *mailbox_ptr)
+{
+    //frame 已經直接寫在共享記憶體裡了，只要填總長度、設旗標
+    //flag =1 有新資料
+    shm_box_t *box = (shm_box_t *)mailbox_ptr->storage.shm_addr;
+    box->len = (uint32_t)mailbox_ptr->tx_len;
+    box->flag = 1;
+    fsem_post(&mailbox_ptr->ctl->receiver_sem); // 通知 receiver 可以收
+}
+
+static int shm_rx_begin(mailbox_t *mailbox_ptr, int block)
+{
+    if (block)
+        fsem_wait(&mailbox_ptr->ctl->receiver_sem, &mailbox_ptr->spin); // 等待 sender 通知（不計時）
+    else if (fsem_trywait(&mailbox_ptr->ctl->receiver_sem) == -1)
+        return 0;
+
+    //frame 直接在共享記憶體裡讀，整個 batch 讀完才把 flag 清掉還給 sender
+    shm_box_t *box = (shm_box_t *)mailbox_ptr->storage.shm_addr;
+    mailbox_ptr->rx_data = box->data;
+    mailbox_ptr->rx_len = box->len;
+    return 1;
+}
+
+static void shm_rx_end(mailbox_t *mailbox_ptr)
+{
+    ((shm_box_t *)mailbox_ptr->storage.shm_addr)->flag = 0;//表示現在這塊共享記憶體是空的
+    fsem_post(&mailbox_ptr->ctl->sender_sem); // 通知 sender 可以送下一個 batch
+}
+
+const transport_t shm_transport = {
+    .name = "Shared Memory",
+    .open = shm_open_box,
+    .close = shm_close_box,
+    XFER_OPS,
+    .tx_begin = shm_tx_begin,
+    .tx_end = shm_tx_end,
+    .rx_begin = shm_rx_begin,
+    .rx_end = shm_rx_end,
+};
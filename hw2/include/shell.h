@@ -1,8 +1,16 @@
 #ifndef SHELL_H
 #define SHELL_H
 
+#include <sys/types.h>
 #include "command.h"
 
+#define SPAWN_POSIX 0   // posix_spawnp() (vfork 式，不複製 page table)
+#define SPAWN_FORK  1   // fork() + execvp()
+
+extern int spawn_method;
+extern char **environ;
+
+pid_t start_proc(struct cmd_node *p, int method, int (*pipefd)[2], int npipe);
 int spawn_proc(struct cmd_node *);
 int fork_cmd_node(struct cmd *cmd);
 void redirection(struct cmd_node *cmd);
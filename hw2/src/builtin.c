@@ -6,7 +6,10 @@
 #include <sys/types.h>
 #include <dirent.h>
 #include <fcntl.h>
+#include <time.h>
+#include <sys/wait.h>
 #include "../include/builtin.h"
+#include "../include/shell.h"
 
 
 
@@ -113,6 +116,84 @@ int record(char **args)
 	return 1;
 }
 
+// ======================= spawn benchmark =======================
+/*
+ * bench [-n count] [-m resident_mb] cmd [args...]
+ * 用 fork() + execvp() 和 posix_spawnp() 各啟動 cmd count 次 (一次一個，等它結束才啟動下一個)，
+ * 印出每秒可以跑幾個指令；stdin / stdout 都接 /dev/null
+ * -m：先配置並寫過這麼多 MB 的記憶體，模擬 shell 常駐記憶體變大時 fork 要多複製的 page table
+ */
+int bench(char **args)
+{
+	int count = 1000, mb = 0, i = 1;
+	for (; args[i] && args[i + 1]; i += 2) {
+		if (strcmp(args[i], "-n") == 0 && atoi(args[i + 1]) > 0)
+			count = atoi(args[i + 1]);
+		else if (strcmp(args[i], "-m") == 0 && atoi(args[i + 1]) >= 0)
+			mb = atoi(args[i + 1]);
+		else
+			break;
+	}
+	if (args[i] == NULL || args[i][0] == '-') {
+		fprintf(stderr, "usage: bench [-n count] [-m resident_mb] cmd [args...]\n");
+		return 1;
+	}
+
+	char *ballast = NULL;
+	if (mb > 0) {
+		ballast = malloc((size_t)mb << 20);
+		if (ballast == NULL) {
+			perror("bench");
+			return 1;
+		}
+		memset(ballast, 1, (size_t)mb << 20);
+	}
+
+	struct cmd_node node = {0};
+	node.args = &args[i];
+	node.in_file = "/dev/null";
+	node.out_file = "/dev/null";
+	node.in = 0;
+	node.out = 1;
+
+	const char *name[] = {"posix_spawn", "fork"};
+	int method[] = {SPAWN_POSIX, SPAWN_FORK};
+	printf("%s x %d, %d MB resident ballast\n", args[i], count, mb);
+	for (int m = 0; m < 2; m++) {
+		struct timespec start, end;
+		int status, failed = 0, ran = 0;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (int k = 0; k < count; k++) {
+			pid_t pid = start_proc(&node, method[m], NULL, 0);
+			if (pid < 0) {
+				failed++;
+				break;
+			}
+			ran++;
+			if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+				failed++;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		// 第一次就啟動不了 (找不到指令之類的)：沒有速率可以算，另一個 method 也一樣啟動不了
+		if (ran == 0) {
+			printf("%-12s could not start %s\n", name[m], args[i]);
+			break;
+		}
+		// 速率只算真的啟動的次數
+		double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+		printf("%-12s %8.3f s %10.0f cmds/s %8.1f us/cmd", name[m], secs, ran / secs, secs * 1e6 / ran);
+		if (ran < count)
+			printf("  (stopped after %d of %d)", ran, count);
+		if (failed)
+			printf("  (%d failed)", failed);
+		printf("\n");
+	}
+	free(ballast);
+	return 1;
+}
+
+// ===============================================================
+
 const char *builtin_str[] = {
  	"help",
  	"cd",
@@ -120,6 +201,7 @@ const char *builtin_str[] = {
 	"echo",
  	"exit",
  	"record",
+	"bench",
 };
 
 int (*builtin_func[]) (char **) = {
@@ -129,6 +211,7 @@ int (*builtin_func[]) (char **) = {
 	&echo,
 	&exit_shell,
   	&record,
+	&bench,
 };
 
 int num_builtins() {
@@ -6,6 +6,8 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <fcntl.h>
+#include <spawn.h>
+#include "../include/shell.h"
 #include "../include/command.h"
 #include "../include/builtin.h"
 
@@ -70,24 +72,98 @@ void redirection(struct cmd_node *p)
 // ===============================================================
 
 // ======================= requirement 2.2 =======================
+/*
+ * 啟動外部指令有兩種方法：
+ * SPAWN_POSIX (預設)：posix_spawnp()，glibc 用 clone(CLONE_VM | CLONE_VFORK) 實作，
+ *     child 直接借用 shell 的 address space 到 exec 為止，不用複製 page table，
+ *     shell 佔的記憶體越大，省下的越多 (fork 要複製的 page table 跟著 RSS 一起長)
+ *     redirection() 的 open / dup2 / close 換成 spawn file actions，child 在 exec 之前照順序做
+ * SPAWN_FORK：原本的 fork() + redirection() + execvp()
+ *     環境變數 MY_SHELL_SPAWN=fork 時使用 (shell() 開始時讀一次)
+ */
+int spawn_method = SPAWN_POSIX;
+
 /**
  * @brief 
- * Execute external command
- * The external command is mainly divided into the following two steps:
- * 1. Call "fork()" to create child process
- * 2. Call "execvp()" to execute the corresponding executable file
+ * Translate redirection() into spawn file actions, in the same order:
+ * "<" / ">" files first, then the pipe ends, then close every pipe fd the child does not need
  * @param p cmd_node structure
+ * @param fa file actions to fill (already initialized)
+ * @param pipefd pipes of the pipeline (NULL if none)
+ * @param npipe number of pipes
  * @return int 
- * Return execution status
+ * 0 on success, otherwise an error number
  */
-int spawn_proc(struct cmd_node *p)
+static int spawn_actions(struct cmd_node *p, posix_spawn_file_actions_t *fa, int (*pipefd)[2], int npipe)
 {
+    int err;
+
+    // 1. < infile
+    if (p->in_file != NULL &&
+        (err = posix_spawn_file_actions_addopen(fa, STDIN_FILENO, p->in_file, O_RDONLY, 0)) != 0)
+        return err;
+
+    // 2. > outfile
+    if (p->out_file != NULL &&
+        (err = posix_spawn_file_actions_addopen(fa, STDOUT_FILENO, p->out_file, O_WRONLY | O_CREAT | O_TRUNC, 0644)) != 0)
+        return err;
+
+    // 3. pipe 的 in / out 接到 stdin / stdout
+    if (p->in != 0 && (err = posix_spawn_file_actions_adddup2(fa, p->in, STDIN_FILENO)) != 0)
+        return err;
+    if (p->out != 1 && (err = posix_spawn_file_actions_adddup2(fa, p->out, STDOUT_FILENO)) != 0)
+        return err;
+
+    // 4. 關掉 child 不需要的 pipe (已經 dup2 到 0 / 1 的不受影響)
+    for (int i = 0; i < npipe; i++) {
+        if ((err = posix_spawn_file_actions_addclose(fa, pipefd[i][0])) != 0 ||
+            (err = posix_spawn_file_actions_addclose(fa, pipefd[i][1])) != 0)
+            return err;
+    }
+    return 0;
+}
+
+/**
+ * @brief 
+ * Start one external command without waiting for it
+ * p->in / p->out are already set to the pipe ends this command uses
+ * @param p cmd_node structure
+ * @param method SPAWN_POSIX or SPAWN_FORK
+ * @param pipefd pipes of the pipeline; the child closes all of them (NULL if none)
+ * @param npipe number of pipes
+ * @return pid_t 
+ * pid of the child, or -1 if it could not be started
+ */
+pid_t start_proc(struct cmd_node *p, int method, int (*pipefd)[2], int npipe)
+{
+    if (method == SPAWN_POSIX) {
+        posix_spawn_file_actions_t fa;
+        pid_t pid;
+        int err = posix_spawn_file_actions_init(&fa);
+        if (err == 0) {
+            err = spawn_actions(p, &fa, pipefd, npipe);
+            // 找不到指令、< 的檔案打不開等錯誤，posix_spawnp() 都會直接回傳
+            if (err == 0)
+                err = posix_spawnp(&pid, p->args[0], &fa, NULL, p->args, environ);
+            posix_spawn_file_actions_destroy(&fa);
+        }
+        if (err != 0) {
+            // < 的檔案打不開時，訊息和 fork 那邊的 redirection() 一樣
+            if (p->in_file != NULL && access(p->in_file, R_OK) != 0)
+                perror("open infile");
+            else
+                fprintf(stderr, "%s: %s\n", p->args[0], strerror(err));
+            return -1;
+        }
+        return pid;
+    }
+
     pid_t pid = fork();
 
     // Fork failed
     if (pid < 0) {
         perror("fork");
-        return 1;
+        return -1;
     }
 
     // Child process
@@ -96,12 +172,35 @@ int spawn_proc(struct cmd_node *p)
         // 先做 redirection (< > 或 pipe)
         redirection(p);
 
-        // execvp：外部指令
-        if (execvp(p->args[0], p->args) == -1) {
-            perror("execvp");
-            exit(1);   // child 必須結束
+        // 關掉 child 不需要的 pipe
+        for (int i = 0; i < npipe; i++) {
+            close(pipefd[i][0]);
+            close(pipefd[i][1]);
         }
+
+        // execvp：外部指令
+        execvp(p->args[0], p->args);
+        perror("execvp");
+        exit(1);   // child 必須結束
     }
+    return pid;
+}
+
+/**
+ * @brief 
+ * Execute external command
+ * The external command is mainly divided into the following two steps:
+ * 1. Start the child with "start_proc()" (posix_spawnp, or fork + execvp)
+ * 2. Wait for the child to finish
+ * @param p cmd_node structure
+ * @return int 
+ * Return execution status
+ */
+int spawn_proc(struct cmd_node *p)
+{
+    pid_t pid = start_proc(p, spawn_method, NULL, 0);
+    if (pid < 0)
+        return 1;
 
     // Parent process 等 child 做完
     int status;
@@ -117,7 +216,7 @@ int spawn_proc(struct cmd_node *p)
 /**
  * @brief 
  * Use "pipe()" to create a communication bridge between processes
- * Call "spawn_proc()" in order according to the number of cmd_node
+ * Call "start_proc()" in order according to the number of cmd_node
  * @param cmd Command structure  
  * @return int
  * Return execution status 
@@ -137,44 +236,25 @@ int fork_cmd_node(struct cmd *cmd)
         }
     }
 
-    int pidx = 0;  // pipe index
+    int pidx = 0;      // pipe index
+    int started = 0;   // 成功啟動幾個 child
     while (cur != NULL) {
 
-        pid_t pid = fork();
-
-        if (pid < 0) {
-            perror("fork");
-            exit(1);
+        // 1. 若不是第一個 command → stdin 來自前一個 pipe
+        if (pidx != 0) {
+            cur->in = pipefd[pidx - 1][0];
         }
 
-        // Child process
-        if (pid == 0) {
-
-            // 1. 若不是第一個 command → stdin 來自前一個 pipe
-            if (pidx != 0) {
-                cur->in = pipefd[pidx - 1][0];
-            }
-
-            // 2. 若不是最後一個 command → stdout 指向下一個 pipe
-            if (pidx != (num - 1)) {
-                cur->out = pipefd[pidx][1];
-            }
-
-            // 3. 做 redirection: 同時處理 < > 與 pipe in/out
-            redirection(cur);
-
-            // 4. 關掉 child 不需要的 pipe
-            for (int i = 0; i < num - 1; i++) {
-                close(pipefd[i][0]);
-                close(pipefd[i][1]);
-            }
-
-            // 5. execvp 執行指令
-            execvp(cur->args[0], cur->args);
-            perror("execvp");
-            exit(1);
+        // 2. 若不是最後一個 command → stdout 指向下一個 pipe
+        if (pidx != (num - 1)) {
+            cur->out = pipefd[pidx][1];
         }
 
+        // 3. redirection 和關掉不需要的 pipe 都在 start_proc() 裡 (child 那邊) 做
+        //    啟動失敗的指令就當作馬上結束：它的 pipe 在下面關掉之後，前後的指令會看到 EOF / EPIPE
+        if (start_proc(cur, spawn_method, pipefd, num - 1) > 0)
+            started++;
+
         // Parent: 下一個 command
         cur = cur->next;
         pidx++;
@@ -188,7 +268,7 @@ int fork_cmd_node(struct cmd *cmd)
 
     // Step 3: Parent 等所有 children 收屍
     int status;
-    for (int i = 0; i < num; i++) {
+    for (int i = 0; i < started; i++) {
         wait(&status);
     }
 
@@ -200,6 +280,11 @@ int fork_cmd_node(struct cmd *cmd)
 
 void shell()
 {
+	// MY_SHELL_SPAWN=fork：外部指令改回 fork() + execvp()
+	char *method = getenv("MY_SHELL_SPAWN");
+	if (method != NULL && strcmp(method, "fork") == 0)
+		spawn_method = SPAWN_FORK;
+
 	while (1) {
 		printf(">>> $ ");
 		char *buffer = read_line();